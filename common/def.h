@@ -21,6 +21,9 @@
 #define likely(x)   __builtin_expect(!!(x), 1)
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
+// 软件预取，只是提示，地址无效也不会出错
+#define prefetch(x) __builtin_prefetch(x)
+
 // 标识入参和出参
 #define IN
 #define OUT
@@ -45,10 +48,26 @@ typedef enum
     /* hash_table模块错误码 */
     ERR_HASH_TABLE_START = 2000,
     ERR_HASH_TABLE_DATA_EXIST,
+    ERR_HASH_TABLE_DATA_NOT_EXIST,  // 数据不存在
+    ERR_HASH_TABLE_COMPUTE_FAIL,    // 按需生成数据失败
+    ERR_HASH_TABLE_FROZEN,          // 冻结的哈希表不能修改
 
     /* thread_pool模块 */
     ERR_THREAD_POOL_START = 3000,
     ERR_THREAD_POOL_TASK_QUEUE_FULL,
+    ERR_THREAD_POOL_SHUTDOWN,       // 线程池正在销毁
+    ERR_THREAD_POOL_TIMEOUT,        // 等待任务完成超时
+    ERR_THREAD_POOL_GRAPH_CYCLE,    // 任务图中有环
+    ERR_THREAD_POOL_GRAPH_RUNNING,  // 任务图正在运行，不能修改或再次运行
+
+    /* cache模块 */
+    ERR_CACHE_START = 4000,
+    ERR_CACHE_DATA_NOT_EXIST,       // 条目不存在
+
+    /* filter模块 */
+    ERR_FILTER_START = 5000,
+    ERR_FILTER_FULL,                // 过滤器已满
+    ERR_FILTER_DATA_NOT_EXIST,      // 指纹不存在
 }STATUS;
 
 /*
@@ -60,6 +79,8 @@ typedef enum
 #define STACK_TEST  (1)
 #define HASH_TABLE_TEST (1)
 #define THREAD_POOL_TEST    (1)
+#define CACHE_TEST  (1)
+#define FILTER_TEST (1)
 
 /*
     Cmocka测试框架宏
@@ -0,0 +1,952 @@
+/*
+    Include files
+*/
+
+#define _POSIX_C_SOURCE 200112L     // pthread_rwlock_t
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "cache.h"
+
+/*
+    Defines
+*/
+
+#define CACHE_CACHE_LINE    (64)        // 缓存行大小，分片按缓存行对齐
+#define CACHE_SHARD_MAX     (1024)      // 最大分片数量
+#define CACHE_BUCKET_INIT   (16)        // 分片内索引的初始桶数量，条目数量超过桶数量时翻倍，均为2的幂
+
+#define SHARD_RLOCK(sh)     pthread_rwlock_rdlock(&(sh)->lock)
+#define SHARD_WLOCK(sh)     pthread_rwlock_wrlock(&(sh)->lock)
+#define SHARD_UNLOCK(sh)    pthread_rwlock_unlock(&(sh)->lock)
+
+/*
+    typedefs
+*/
+
+// 条目，自带链表指针，移动和摘除都是O(1)
+typedef struct cache_entry
+{
+    struct cache_entry *prev;   // 链表中的前一个条目
+    struct cache_entry *next;   // 链表中的后一个条目，淘汰后用于串联待回调的条目
+    struct cache_entry *chain;  // 索引中同一个桶的下一个条目
+    void *key;                  // 键
+    unsigned int hash;          // 键的哈希值，比较前先比它，扩容时直接复用
+    void *value;                // 值
+    size_t charge;              // 开销
+    atomic_bool referenced;     // CLOCK策略的引用位，查找时在读锁内设置
+}cache_entry;
+
+// 分片，拥有独立的锁、索引和链表，分片锁是唯一的锁
+typedef struct
+{
+    _Alignas(CACHE_CACHE_LINE)
+    pthread_rwlock_t lock;      // 分片锁，CLOCK策略的查找共享，其余操作独占
+
+    cache_entry **buckets;      // 键到条目的索引，条目通过chain串成单链表，不另外加锁
+    unsigned int bucket_mask;   // 桶数量减1
+    cache_entry head;           // 循环链表的哨兵。LRU：head.next最近使用，head.prev最久未使用；CLOCK：时钟环
+    cache_entry *hand;          // CLOCK策略的指针，指向下一个检查的条目，环为空时为NULL
+    size_t capacity;            // 分片容量
+    size_t usage;               // 分片内条目开销之和
+    unsigned int count;         // 分片内条目数量
+    uint64_t evictions;         // 因容量淘汰的条目数量，写锁内修改
+    atomic_ullong hits;         // 命中次数
+    atomic_ullong misses;       // 未命中次数
+}cache_shard;
+
+// 缓存结构
+struct cache
+{
+    CACHE_POLICY policy;        // 淘汰策略
+    cache_shard *shards;        // 分片数组，与缓存结构位于同一块内存
+    unsigned int shard_count;   // 分片数量
+    unsigned int shard_shift;   // 选分片时哈希值右移的位数
+    hash_func hash;             // 键的哈希函数
+    cmp_func cmp;               // 键的比较函数
+    cache_evict_func evict;     // 条目离开缓存时的回调
+    void *evict_ctx;            // 回调的上下文
+};
+
+/*
+    Functions
+*/
+
+// 计算键的哈希值，再经过murmur3的fmix32混淆，每次操作只计算一次，选分片和选桶都用它
+static inline unsigned int cache_hash(
+    IN cache *c,
+    IN void *key
+)
+{
+    unsigned int h = c->hash(key);
+
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+// 根据哈希值选分片，使用乘法哈希的高位，与分片内索引用到的低位相互独立
+static inline cache_shard* cache_shard_of(
+    IN cache *c,
+    IN unsigned int hash_val
+)
+{
+    uint64_t h = (uint32_t)(hash_val * 0x9E3779B9u);
+    return &c->shards[h >> c->shard_shift];
+}
+
+// 申请count个空桶
+static cache_entry** cache_buckets_alloc(IN unsigned int count)
+{
+    cache_entry **buckets = (cache_entry**)malloc(sizeof(cache_entry*) * count);
+    if(likely(buckets))
+    {
+        memset(buckets, 0, sizeof(cache_entry*) * count);
+    }
+    return buckets;
+}
+
+// 在索引中查找，返回指向匹配条目的链接，不存在时返回桶尾的空链接，调用者持有分片锁
+static inline cache_entry** cache_index_find(
+    IN cache *c,
+    IN cache_shard *sh,
+    IN unsigned int hash_val,
+    IN void *key
+)
+{
+    cache_entry **link = &sh->buckets[hash_val & sh->bucket_mask];
+
+    while(*link && ((*link)->hash != hash_val || !c->cmp(key, (*link)->key)))
+    {
+        link = &(*link)->chain;
+    }
+
+    return link;
+}
+
+// 把条目从索引中摘除，调用者持有写锁
+static inline void cache_index_remove(
+    IN cache_shard *sh,
+    IN cache_entry *e
+)
+{
+    cache_entry **link = &sh->buckets[e->hash & sh->bucket_mask];
+
+    while(*link != e)
+    {
+        link = &(*link)->chain;
+    }
+    *link = e->chain;
+}
+
+// 条目数量超过桶数量时桶数量翻倍，一次迁移完成；申请失败时保持原样，只是桶变长，调用者持有写锁
+static void cache_index_grow(IN cache_shard *sh)
+{
+    unsigned int count = (sh->bucket_mask + 1) * 2;
+    cache_entry **buckets = NULL;
+    cache_entry *e = NULL;
+    cache_entry *next = NULL;
+    unsigned int i = 0;
+
+    if(sh->count <= sh->bucket_mask || count == 0)
+    {
+        return;
+    }
+
+    buckets = cache_buckets_alloc(count);
+    if(unlikely(!buckets))
+    {
+        DBG("malloc space of %u buckets fail", count);
+        return;
+    }
+
+    for(i = 0; i <= sh->bucket_mask; ++ i)
+    {
+        for(e = sh->buckets[i]; e; e = next)
+        {
+            next = e->chain;
+            e->chain = buckets[e->hash & (count - 1)];
+            buckets[e->hash & (count - 1)] = e;
+        }
+    }
+
+    free(sh->buckets);
+    sh->buckets = buckets;
+    sh->bucket_mask = count - 1;
+}
+
+// 把条目链接到pos之后
+static inline void cache_entry_link(
+    IN cache_entry *pos,
+    IN cache_entry *e
+)
+{
+    e->prev = pos;
+    e->next = pos->next;
+    pos->next->prev = e;
+    pos->next = e;
+}
+
+// 从链表中摘除条目
+static inline void cache_entry_unlink(IN cache_entry *e)
+{
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+}
+
+// 时钟环中e的下一个条目，跳过哨兵；环中只有e时返回e
+static inline cache_entry* cache_clock_next(
+    IN cache_shard *sh,
+    IN cache_entry *e
+)
+{
+    cache_entry *n = e->next;
+    return (n == &sh->head) ? sh->head.next : n;
+}
+
+// 把新条目加入分片，调用者持有写锁
+static void cache_shard_attach(
+    IN cache *c,
+    IN cache_shard *sh,
+    IN cache_entry *e
+)
+{
+    if(c->policy == CACHE_CLOCK && sh->hand)
+    {
+        // 放在指针之前，转一整圈后才会被检查
+        cache_entry_link(sh->hand->prev, e);
+    }
+    else
+    {
+        cache_entry_link(&sh->head, e);
+        if(c->policy == CACHE_CLOCK)
+        {
+            sh->hand = e;
+        }
+    }
+
+    sh->usage += e->charge;
+    ++ sh->count;
+}
+
+// 把条目从分片的链表中摘除，不修改索引，调用者持有写锁
+static void cache_shard_detach(
+    IN cache_shard *sh,
+    IN cache_entry *e
+)
+{
+    if(sh->hand == e)
+    {
+        sh->hand = cache_clock_next(sh, e);
+        if(sh->hand == e)
+        {
+            sh->hand = NULL;
+        }
+    }
+
+    cache_entry_unlink(e);
+    sh->usage -= e->charge;
+    -- sh->count;
+}
+
+// 选择淘汰的条目，分片为空时返回NULL，调用者持有写锁
+static cache_entry* cache_shard_victim(
+    IN cache *c,
+    IN cache_shard *sh
+)
+{
+    cache_entry *e = NULL;
+
+    if(c->policy == CACHE_LRU)
+    {
+        e = sh->head.prev;
+        return (e == &sh->head) ? NULL : e;
+    }
+
+    // 引用位为1的条目清零后跳过，写锁内引用位不会再被设置，最多转一圈即可找到
+    while(sh->hand)
+    {
+        e = sh->hand;
+        if(!atomic_load_explicit(&e->referenced, memory_order_relaxed))
+        {
+            return e;
+        }
+        atomic_store_explicit(&e->referenced, false, memory_order_relaxed);
+        sh->hand = cache_clock_next(sh, e);
+    }
+
+    return NULL;
+}
+
+// 条目离开缓存，在锁外调用回调后释放
+static void cache_entry_release(
+    IN cache *c,
+    IN cache_entry *e,
+    IN CACHE_EVICT_REASON reason
+)
+{
+    if(c->evict)
+    {
+        c->evict(e->key, e->value, reason, c->evict_ctx);
+    }
+    free(e);
+}
+
+// 创建缓存，缓存结构和分片数组一次申请
+static cache* _cache_create(IN const cache_attr *attr)
+{
+    cache *c = NULL;
+    cache_shard *sh = NULL;
+    unsigned int i = 0;
+    size_t size = 0;
+
+    if(unlikely(!attr || !attr->hash || !attr->cmp || attr->capacity == 0 ||
+                (attr->policy != CACHE_LRU && attr->policy != CACHE_CLOCK) ||
+                attr->shard_count == 0 || attr->shard_count > CACHE_SHARD_MAX ||
+                (attr->shard_count & (attr->shard_count - 1))))
+    {
+        DBG("bad in param for create cache");
+        return NULL;
+    }
+
+    // 多申请一个缓存行用于分片数组对齐
+    size = sizeof(cache) + CACHE_CACHE_LINE + sizeof(cache_shard) * attr->shard_count;
+    c = (cache*)malloc(size);
+    if(unlikely(!c))
+    {
+        DBG("malloc space of cache fail");
+        return NULL;
+    }
+    memset(c, 0, size);
+
+    c->policy = attr->policy;
+    c->hash = attr->hash;
+    c->cmp = attr->cmp;
+    c->evict = attr->evict;
+    c->evict_ctx = attr->evict_ctx;
+    c->shards = (cache_shard*)(((uintptr_t)(c + 1) + CACHE_CACHE_LINE - 1) &
+                               ~(uintptr_t)(CACHE_CACHE_LINE - 1));
+    c->shard_shift = 32;
+    for(i = attr->shard_count; i > 1; i >>= 1)
+    {
+        -- c->shard_shift;
+    }
+
+    for(i = 0; i < attr->shard_count; ++ i)
+    {
+        sh = &c->shards[i];
+
+        sh->buckets = cache_buckets_alloc(CACHE_BUCKET_INIT);
+        if(unlikely(!sh->buckets))
+        {
+            DBG("malloc buckets of shard %u fail", i);
+            goto error;
+        }
+        sh->bucket_mask = CACHE_BUCKET_INIT - 1;
+
+        if(0 != pthread_rwlock_init(&sh->lock, NULL))
+        {
+            DBG("init rwlock fail");
+            free(sh->buckets);
+            goto error;
+        }
+
+        sh->head.prev = &sh->head;
+        sh->head.next = &sh->head;
+        sh->capacity = (attr->capacity + attr->shard_count - 1) / attr->shard_count;
+        atomic_init(&sh->hits, 0);
+        atomic_init(&sh->misses, 0);
+        ++ c->shard_count;
+    }
+
+    return c;
+
+error:
+    for(i = 0; i < c->shard_count; ++ i)
+    {
+        free(c->shards[i].buckets);
+        pthread_rwlock_destroy(&c->shards[i].lock);
+    }
+    free(c);
+    return NULL;
+}
+
+// 销毁缓存
+static STATUS _cache_destroy(IN cache *c)
+{
+    cache_shard *sh = NULL;
+    cache_entry *e = NULL;
+    cache_entry *next = NULL;
+    unsigned int i = 0;
+
+    if(unlikely(!c))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    for(i = 0; i < c->shard_count; ++ i)
+    {
+        sh = &c->shards[i];
+        for(e = sh->head.next; e != &sh->head; e = next)
+        {
+            next = e->next;
+            cache_entry_release(c, e, CACHE_EVICT_DESTROY);
+        }
+        free(sh->buckets);
+        pthread_rwlock_destroy(&sh->lock);
+    }
+
+    free(c);
+
+    return OK;
+}
+
+// 加入或替换条目，先淘汰到放得下新条目再加入，被替换和被淘汰的条目在锁外回调
+static STATUS _cache_put(
+    IN cache *c,
+    IN void *key,
+    IN void *value,
+    IN size_t charge
+)
+{
+    cache_shard *sh = NULL;
+    cache_entry *e = NULL;
+    cache_entry *old = NULL;
+    cache_entry *victim = NULL;
+    cache_entry *victims = NULL;
+    cache_entry **link = NULL;
+    unsigned int hash_val = 0;
+
+    if(unlikely(!c || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    e = (cache_entry*)malloc(sizeof(cache_entry));
+    if(unlikely(!e))
+    {
+        DBG("malloc cache entry fail");
+        return ERR_NO_MEMORY;
+    }
+    hash_val = cache_hash(c, key);
+    e->prev = NULL;
+    e->next = NULL;
+    e->chain = NULL;
+    e->key = key;
+    e->hash = hash_val;
+    e->value = value;
+    e->charge = charge;
+    atomic_init(&e->referenced, false);
+
+    sh = cache_shard_of(c, hash_val);
+
+    SHARD_WLOCK(sh);
+
+    link = cache_index_find(c, sh, hash_val, key);
+    old = *link;
+
+    if(unlikely(charge > sh->capacity))
+    {
+        // 开销超过分片容量的条目不加入，也不挤出其他条目；同键的旧条目依然被替换
+        if(old)
+        {
+            *link = old->chain;
+            cache_shard_detach(sh, old);
+        }
+        ++ sh->evictions;
+        victims = e;
+    }
+    else
+    {
+        // 新条目占据旧条目在桶中的位置
+        if(old)
+        {
+            e->chain = old->chain;
+            cache_shard_detach(sh, old);
+        }
+        *link = e;
+
+        while(sh->usage + charge > sh->capacity && (victim = cache_shard_victim(c, sh)))
+        {
+            cache_index_remove(sh, victim);
+            cache_shard_detach(sh, victim);
+            victim->next = victims;
+            victims = victim;
+            ++ sh->evictions;
+        }
+
+        cache_shard_attach(c, sh, e);
+        cache_index_grow(sh);
+    }
+
+    SHARD_UNLOCK(sh);
+
+    if(old)
+    {
+        cache_entry_release(c, old, CACHE_EVICT_REPLACE);
+    }
+    for(; victims; victims = victim)
+    {
+        victim = victims->next;
+        cache_entry_release(c, victims, CACHE_EVICT_CAPACITY);
+    }
+
+    return OK;
+}
+
+// 查找键。LRU策略把命中的条目移到链表头；CLOCK策略只在引用位未设置时设置，命中已访问过的条目不写共享内存
+static void* _cache_get(
+    IN cache *c,
+    IN void *key
+)
+{
+    cache_shard *sh = NULL;
+    cache_entry *e = NULL;
+    unsigned int hash_val = 0;
+    void *value = NULL;
+
+    if(unlikely(!c || !key))
+    {
+        return NULL;
+    }
+
+    hash_val = cache_hash(c, key);
+    sh = cache_shard_of(c, hash_val);
+
+    if(c->policy == CACHE_CLOCK)
+    {
+        SHARD_RLOCK(sh);
+        e = *cache_index_find(c, sh, hash_val, key);
+        if(e)
+        {
+            if(!atomic_load_explicit(&e->referenced, memory_order_relaxed))
+            {
+                atomic_store_explicit(&e->referenced, true, memory_order_relaxed);
+            }
+            value = e->value;
+        }
+    }
+    else
+    {
+        SHARD_WLOCK(sh);
+        e = *cache_index_find(c, sh, hash_val, key);
+        if(e)
+        {
+            cache_entry_unlink(e);
+            cache_entry_link(&sh->head, e);
+            value = e->value;
+        }
+    }
+
+    SHARD_UNLOCK(sh);
+
+    atomic_fetch_add_explicit(e ? &sh->hits : &sh->misses, 1, memory_order_relaxed);
+
+    return value;
+}
+
+// 移除条目
+static STATUS _cache_remove(
+    IN cache *c,
+    IN void *key
+)
+{
+    cache_shard *sh = NULL;
+    cache_entry *e = NULL;
+    cache_entry **link = NULL;
+    unsigned int hash_val = 0;
+
+    if(unlikely(!c || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    hash_val = cache_hash(c, key);
+    sh = cache_shard_of(c, hash_val);
+
+    SHARD_WLOCK(sh);
+    link = cache_index_find(c, sh, hash_val, key);
+    e = *link;
+    if(e)
+    {
+        *link = e->chain;
+        cache_shard_detach(sh, e);
+    }
+    SHARD_UNLOCK(sh);
+
+    if(!e)
+    {
+        return ERR_CACHE_DATA_NOT_EXIST;
+    }
+
+    cache_entry_release(c, e, CACHE_EVICT_REMOVE);
+
+    return OK;
+}
+
+// 获取统计信息，依次持有各分片的读锁
+static STATUS _cache_get_stats(
+    IN cache *c,
+    OUT cache_stats *stats
+)
+{
+    cache_shard *sh = NULL;
+    unsigned int i = 0;
+
+    if(unlikely(!c || !stats))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    memset(stats, 0, sizeof(cache_stats));
+
+    for(i = 0; i < c->shard_count; ++ i)
+    {
+        sh = &c->shards[i];
+
+        SHARD_RLOCK(sh);
+        stats->usage += sh->usage;
+        stats->count += sh->count;
+        stats->evictions += sh->evictions;
+        SHARD_UNLOCK(sh);
+
+        stats->hits += atomic_load_explicit(&sh->hits, memory_order_relaxed);
+        stats->misses += atomic_load_explicit(&sh->misses, memory_order_relaxed);
+    }
+
+    return OK;
+}
+
+/*
+    Variables
+*/
+
+cache_ops cache_operations = {
+    .cache_create = _cache_create,
+    .cache_destroy = _cache_destroy,
+    .cache_put = _cache_put,
+    .cache_get = _cache_get,
+    .cache_remove = _cache_remove,
+    .cache_get_stats = _cache_get_stats,
+};
+
+/*
+    Test
+*/
+
+#if CACHE_TEST
+
+#define CACHE_TEST_THREADS  (8)
+#define CACHE_TEST_KEYS     (512)
+#define CACHE_TEST_OPS      (20000)
+
+// 记录回调
+typedef struct
+{
+    atomic_int calls[CACHE_EVICT_DESTROY + 1];  // 每种原因的回调次数
+    void *last_key;                             // 最近一次回调的键
+    void *last_value;                           // 最近一次回调的值
+}cache_test_record;
+
+static unsigned int cache_test_hash(void *data)
+{
+    return (unsigned int)*(int*)data;
+}
+
+static bool cache_test_cmp(void *d1, void *d2)
+{
+    return *(int*)d1 == *(int*)d2;
+}
+
+static void cache_test_evict(void *key, void *value, CACHE_EVICT_REASON reason, void *ctx)
+{
+    cache_test_record *rec = (cache_test_record*)ctx;
+
+    atomic_fetch_add(&rec->calls[reason], 1);
+    rec->last_key = key;
+    rec->last_value = value;
+}
+
+// 多线程测试只计数
+static void cache_test_count(void *key, void *value, CACHE_EVICT_REASON reason, void *ctx)
+{
+    (void)key;
+    (void)value;
+    atomic_fetch_add(&((cache_test_record*)ctx)->calls[reason], 1);
+}
+
+// 按条目数量淘汰，命中的条目不会被淘汰
+static void cache_lru_test()
+{
+#if CMOCKA_TEST
+    static int keys[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static int values[8];
+    static cache_test_record rec;
+    cache_attr attr = {CACHE_LRU, 3, 1, cache_test_hash, cache_test_cmp, cache_test_evict, &rec};
+    cache_stats stats;
+    cache *c = NULL;
+    int i = 0;
+
+    memset(&rec, 0, sizeof(rec));
+
+    assert_null(cache_create(NULL));
+    attr.shard_count = 3;
+    assert_null(cache_create(&attr));
+    attr.shard_count = 1;
+    attr.capacity = 0;
+    assert_null(cache_create(&attr));
+    attr.capacity = 3;
+
+    c = cache_create(&attr);
+    assert_non_null(c);
+    assert_int_not_equal(OK, cache_put(NULL, &keys[0], &values[0]));
+    assert_int_not_equal(OK, cache_put(c, NULL, &values[0]));
+    assert_null(cache_get(c, NULL));
+
+    for(i = 0; i < 3; ++ i)
+        assert_int_equal(OK, cache_put(c, &keys[i], &values[i]));
+
+    // 访问0之后，最久未使用的是1
+    assert_ptr_equal(&values[0], cache_get(c, &keys[0]));
+    assert_int_equal(OK, cache_put(c, &keys[3], &values[3]));
+    assert_int_equal(1, rec.calls[CACHE_EVICT_CAPACITY]);
+    assert_ptr_equal(&keys[1], rec.last_key);
+    assert_ptr_equal(&values[1], rec.last_value);
+    assert_null(cache_get(c, &keys[1]));
+    assert_ptr_equal(&values[2], cache_get(c, &keys[2]));
+
+    // 替换不改变条目数量，旧值交给回调
+    assert_int_equal(OK, cache_put(c, &keys[0], &values[5]));
+    assert_int_equal(1, rec.calls[CACHE_EVICT_REPLACE]);
+    assert_ptr_equal(&values[0], rec.last_value);
+    assert_ptr_equal(&values[5], cache_get(c, &keys[0]));
+
+    assert_int_equal(OK, cache_remove(c, &keys[2]));
+    assert_int_equal(1, rec.calls[CACHE_EVICT_REMOVE]);
+    assert_int_equal(ERR_CACHE_DATA_NOT_EXIST, cache_remove(c, &keys[2]));
+
+    assert_int_equal(OK, cache_get_stats(c, &stats));
+    assert_int_equal(2, stats.count);
+    assert_int_equal(2, stats.usage);
+    assert_int_equal(1, stats.evictions);
+    assert_int_equal(3, stats.hits);
+    assert_int_equal(1, stats.misses);
+
+    assert_return_code(OK, cache_destroy(c));
+    assert_int_equal(2, rec.calls[CACHE_EVICT_DESTROY]);
+#endif
+}
+
+// 按字节数淘汰，超过容量的条目不加入
+static void cache_charge_test()
+{
+#if CMOCKA_TEST
+    static int keys[4] = {0, 1, 2, 3};
+    static cache_test_record rec;
+    cache_attr attr = {CACHE_LRU, 100, 1, cache_test_hash, cache_test_cmp, cache_test_evict, &rec};
+    cache_stats stats;
+    cache *c = NULL;
+
+    memset(&rec, 0, sizeof(rec));
+
+    c = cache_create(&attr);
+    assert_non_null(c);
+
+    assert_int_equal(OK, cache_put_charge(c, &keys[0], NULL, 40));
+    assert_int_equal(OK, cache_put_charge(c, &keys[1], NULL, 40));
+    assert_int_equal(OK, cache_put_charge(c, &keys[2], NULL, 40));
+    assert_int_equal(1, rec.calls[CACHE_EVICT_CAPACITY]);
+    assert_ptr_equal(&keys[0], rec.last_key);
+
+    assert_int_equal(OK, cache_put_charge(c, &keys[3], NULL, 200));
+    assert_int_equal(2, rec.calls[CACHE_EVICT_CAPACITY]);
+    assert_ptr_equal(&keys[3], rec.last_key);
+
+    assert_int_equal(OK, cache_get_stats(c, &stats));
+    assert_int_equal(2, stats.count);
+    assert_int_equal(80, stats.usage);
+    assert_int_equal(2, stats.evictions);
+
+    assert_return_code(OK, cache_destroy(c));
+#endif
+}
+
+// CLOCK策略：引用位为1的条目获得第二次机会
+static void cache_clock_test()
+{
+#if CMOCKA_TEST
+    static int keys[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static cache_test_record rec;
+    cache_attr attr = {CACHE_CLOCK, 3, 1, cache_test_hash, cache_test_cmp, cache_test_evict, &rec};
+    cache *c = NULL;
+    int i = 0;
+
+    memset(&rec, 0, sizeof(rec));
+
+    c = cache_create(&attr);
+    assert_non_null(c);
+
+    for(i = 0; i < 3; ++ i)
+        assert_int_equal(OK, cache_put(c, &keys[i], &keys[i]));
+    assert_ptr_equal(&keys[0], cache_get(c, &keys[0]));
+    assert_ptr_equal(&keys[1], cache_get(c, &keys[1]));
+
+    assert_int_equal(OK, cache_put(c, &keys[3], &keys[3]));
+    assert_ptr_equal(&keys[2], rec.last_key);
+
+    // 0和1的引用位已被清除，新加入的3最后被检查
+    assert_int_equal(OK, cache_put(c, &keys[4], &keys[4]));
+    assert_ptr_equal(&keys[0], rec.last_key);
+    assert_int_equal(OK, cache_put(c, &keys[5], &keys[5]));
+    assert_ptr_equal(&keys[1], rec.last_key);
+    assert_int_equal(3, rec.calls[CACHE_EVICT_CAPACITY]);
+
+    for(i = 3; i < 6; ++ i)
+        assert_ptr_equal(&keys[i], cache_get(c, &keys[i]));
+
+    // 删除指针所在的条目
+    assert_int_equal(OK, cache_remove(c, &keys[3]));
+    assert_int_equal(OK, cache_remove(c, &keys[4]));
+    assert_int_equal(OK, cache_remove(c, &keys[5]));
+    assert_int_equal(OK, cache_put(c, &keys[6], &keys[6]));
+    assert_ptr_equal(&keys[6], cache_get(c, &keys[6]));
+
+    assert_return_code(OK, cache_destroy(c));
+    assert_int_equal(1, rec.calls[CACHE_EVICT_DESTROY]);
+#endif
+}
+
+// 分片内索引扩容：条目数量超过初始桶数量后依然能查找、替换和删除
+static void cache_grow_test()
+{
+#if CMOCKA_TEST
+    static int keys[200];
+    static int other;
+    static cache_test_record rec;
+    cache_attr attr = {CACHE_LRU, 200, 1, cache_test_hash, cache_test_cmp, cache_test_count, &rec};
+    cache_stats stats;
+    cache *c = NULL;
+    int i = 0;
+
+    memset(&rec, 0, sizeof(rec));
+    c = cache_create(&attr);
+    assert_non_null(c);
+
+    for(i = 0; i < 200; ++ i)
+    {
+        keys[i] = i;
+        assert_int_equal(OK, cache_put(c, &keys[i], &keys[i]));
+    }
+    for(i = 0; i < 200; ++ i)
+        assert_ptr_equal(&keys[i], cache_get(c, &keys[i]));
+
+    assert_int_equal(OK, cache_put(c, &keys[7], &other));
+    assert_ptr_equal(&other, cache_get(c, &keys[7]));
+    for(i = 0; i < 200; i += 2)
+        assert_int_equal(OK, cache_remove(c, &keys[i]));
+    for(i = 0; i < 200; ++ i)
+        assert_true((i % 2) == (NULL != cache_get(c, &keys[i])));
+
+    assert_int_equal(OK, cache_get_stats(c, &stats));
+    assert_int_equal(100, stats.count);
+    assert_int_equal(0, stats.evictions);
+    assert_int_equal(1, rec.calls[CACHE_EVICT_REPLACE]);
+    assert_int_equal(100, rec.calls[CACHE_EVICT_REMOVE]);
+
+    assert_return_code(OK, cache_destroy(c));
+    assert_int_equal(100, rec.calls[CACHE_EVICT_DESTROY]);
+#endif
+}
+
+typedef struct
+{
+    cache *c;
+    int *keys;
+    unsigned int seed;
+    int puts;
+}cache_test_arg;
+
+static void* cache_test_worker(void *param)
+{
+    cache_test_arg *arg = (cache_test_arg*)param;
+    int i = 0;
+    int k = 0;
+
+    for(i = 0; i < CACHE_TEST_OPS; ++ i)
+    {
+        arg->seed = arg->seed * 1103515245u + 12345u;
+        k = (arg->seed >> 16) % CACHE_TEST_KEYS;
+        if(!cache_get(arg->c, &arg->keys[k]) && OK == cache_put(arg->c, &arg->keys[k], &arg->keys[k]))
+        {
+            ++ arg->puts;
+        }
+    }
+
+    return NULL;
+}
+
+// 分片并发：每次加入的条目最终恰好离开缓存一次
+static void cache_concurrent_test(CACHE_POLICY policy)
+{
+#if CMOCKA_TEST
+    static int keys[CACHE_TEST_KEYS];
+    static cache_test_record rec;
+    cache_attr attr = {policy, 128, 8, cache_test_hash, cache_test_cmp, cache_test_count, &rec};
+    cache_test_arg args[CACHE_TEST_THREADS];
+    pthread_t threads[CACHE_TEST_THREADS];
+    cache_stats stats;
+    cache *c = NULL;
+    int puts = 0;
+    int i = 0;
+
+    memset(&rec, 0, sizeof(rec));
+    for(i = 0; i < CACHE_TEST_KEYS; ++ i)
+        keys[i] = i;
+
+    c = cache_create(&attr);
+    assert_non_null(c);
+
+    for(i = 0; i < CACHE_TEST_THREADS; ++ i)
+    {
+        args[i].c = c;
+        args[i].keys = keys;
+        args[i].seed = i + 1;
+        args[i].puts = 0;
+        assert_int_equal(0, pthread_create(&threads[i], NULL, cache_test_worker, &args[i]));
+    }
+    for(i = 0; i < CACHE_TEST_THREADS; ++ i)
+    {
+        pthread_join(threads[i], NULL);
+        puts += args[i].puts;
+    }
+
+    assert_int_equal(OK, cache_get_stats(c, &stats));
+    assert_int_equal(CACHE_TEST_THREADS * CACHE_TEST_OPS, stats.hits + stats.misses);
+    assert_true(stats.count <= 128);
+    assert_int_equal(stats.count, stats.usage);
+    assert_int_equal(stats.evictions, rec.calls[CACHE_EVICT_CAPACITY]);
+    assert_int_equal(puts, stats.count + rec.calls[CACHE_EVICT_CAPACITY] + rec.calls[CACHE_EVICT_REPLACE]);
+
+    assert_return_code(OK, cache_destroy(c));
+    assert_int_equal(stats.count, rec.calls[CACHE_EVICT_DESTROY]);
+#endif
+}
+
+void cache_test()
+{
+#if CMOCKA_TEST
+    cache_lru_test();
+    cache_charge_test();
+    cache_clock_test();
+    cache_grow_test();
+    cache_concurrent_test(CACHE_LRU);
+    cache_concurrent_test(CACHE_CLOCK);
+#endif
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+/*
+    Include files
+*/
+
+#include <stdint.h>
+#include "hash_table/hash_table.h"
+
+/*
+    typedefs
+*/
+
+// 缓存声明，隐藏成员
+typedef struct cache cache;
+// 淘汰策略
+typedef enum
+{
+    CACHE_LRU,      // 最近最少使用，命中时把条目移到链表头，需要写锁
+    CACHE_CLOCK,    // 时钟近似LRU，命中时只设置引用位，查找只需读锁
+}CACHE_POLICY;
+// 条目离开缓存的原因
+typedef enum
+{
+    CACHE_EVICT_CAPACITY,   // 超出容量被淘汰
+    CACHE_EVICT_REPLACE,    // 被相同键的新条目替换
+    CACHE_EVICT_REMOVE,     // 被cache_remove移除
+    CACHE_EVICT_DESTROY,    // 缓存销毁
+}CACHE_EVICT_REASON;
+// 条目离开缓存时的回调，在锁外调用，通常用于释放键和值
+typedef void (*cache_evict_func)(void *key, void *value, CACHE_EVICT_REASON reason, void *ctx);
+// 创建属性
+typedef struct
+{
+    CACHE_POLICY policy;        // 淘汰策略
+    size_t capacity;            // 容量，条目开销之和的上限；每个条目开销为1时即条目数量，开销为字节数时即字节数
+    unsigned int shard_count;   // 分片数量，2的幂，每个分片独立加锁，容量在分片间平分；1表示单锁
+    hash_func hash;             // 键的哈希函数
+    cmp_func cmp;               // 键的比较函数
+    cache_evict_func evict;     // 条目离开缓存时的回调，可以为NULL
+    void *evict_ctx;            // 回调的上下文
+}cache_attr;
+// 统计信息
+typedef struct
+{
+    uint64_t hits;              // 命中次数
+    uint64_t misses;            // 未命中次数
+    uint64_t evictions;         // 因容量淘汰的条目数量
+    size_t usage;               // 当前条目开销之和
+    unsigned int count;         // 当前条目数量
+}cache_stats;
+// 缓存操作集合
+typedef struct cache_ops
+{
+    // 创建缓存
+    cache* (*cache_create)(const cache_attr*);
+    // 销毁缓存
+    STATUS (*cache_destroy)(cache*);
+    // 加入或替换条目
+    STATUS (*cache_put)(cache*, void*, void*, size_t);
+    // 查找键，返回对应的值
+    void* (*cache_get)(cache*, void*);
+    // 移除条目
+    STATUS (*cache_remove)(cache*, void*);
+    // 获取统计信息
+    STATUS (*cache_get_stats)(cache*, cache_stats*);
+}cache_ops;
+
+/*
+    Extern symbols
+*/
+
+extern cache_ops cache_operations;
+
+/*
+    Functions
+*/
+
+// 创建缓存
+static inline cache* cache_create(IN const cache_attr *attr)
+{
+    return cache_operations.cache_create(attr);
+}
+
+// 销毁缓存，对剩余条目以CACHE_EVICT_DESTROY调用回调
+static inline STATUS cache_destroy(IN cache *c)
+{
+    return cache_operations.cache_destroy(c);
+}
+
+// 加入条目，开销为1。键已存在时替换，旧条目以CACHE_EVICT_REPLACE调用回调；
+// 加入后超出容量时淘汰最久未使用的条目，以CACHE_EVICT_CAPACITY调用回调
+static inline STATUS cache_put(
+    IN cache *c,
+    IN void *key,
+    IN void *value
+)
+{
+    return cache_operations.cache_put(c, key, value, 1);
+}
+
+// 加入条目并指定开销，例如值占用的字节数。开销超过分片容量的条目加入后立即被淘汰
+static inline STATUS cache_put_charge(
+    IN cache *c,
+    IN void *key,
+    IN void *value,
+    IN size_t charge
+)
+{
+    return cache_operations.cache_put(c, key, value, charge);
+}
+
+// 查找键，返回对应的值，不存在时返回NULL。
+// 返回的值可能随后被其他线程的put淘汰，多线程共享时值的生命周期需要由回调配合引用计数管理
+static inline void* cache_get(
+    IN cache *c,
+    IN void *key
+)
+{
+    return cache_operations.cache_get(c, key);
+}
+
+// 移除条目，以CACHE_EVICT_REMOVE调用回调
+static inline STATUS cache_remove(
+    IN cache *c,
+    IN void *key
+)
+{
+    return cache_operations.cache_remove(c, key);
+}
+
+// 获取统计信息，各分片的计数直接累加，并发修改时是近似值
+static inline STATUS cache_get_stats(
+    IN cache *c,
+    OUT cache_stats *stats
+)
+{
+    return cache_operations.cache_get_stats(c, stats);
+}
+
+// 测试接口
+#if CACHE_TEST
+void cache_test();
+#endif
+
+#endif
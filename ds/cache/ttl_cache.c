@@ -0,0 +1,786 @@
+/*
+    Include files
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include "ttl_cache.h"
+
+/*
+    Defines
+*/
+
+#define TTL_WHEEL_BITS      (6)                             // 每层时间轮的位数
+#define TTL_WHEEL_SIZE      (1u << TTL_WHEEL_BITS)          // 每层的槽数量
+#define TTL_WHEEL_MASK      (TTL_WHEEL_SIZE - 1)
+#define TTL_WHEEL_LEVELS    (5)                             // 层数
+#define TTL_WHEEL_RANGE     (1ull << (TTL_WHEEL_BITS * TTL_WHEEL_LEVELS))  // 时间轮能表示的最大间隔
+#define TTL_TABLE_INIT      (64)                            // 哈希表的初始桶数量，随条目增加自动扩容
+
+/*
+    typedefs
+*/
+
+// 槽内的双向链表节点，槽本身是循环链表的哨兵
+typedef struct ttl_link
+{
+    struct ttl_link *prev;
+    struct ttl_link *next;
+}ttl_link;
+
+// 条目
+typedef struct
+{
+    ttl_link link;              // 所在槽的链表节点，必须是第一个成员
+    void *key;                  // 键
+    void *value;                // 值
+    uint64_t expire;            // 到期时间
+}ttl_entry;
+
+// 过期缓存结构：哈希表按键查找条目，分层时间轮按到期时间组织条目
+struct ttl_cache
+{
+    pthread_mutex_t lock;       // 保护时间轮和计数
+    hash_table *table;          // 键到条目的映射
+    uint64_t next;              // 下一个待处理的滴答，当前时间为next - 1
+    unsigned int count;         // 条目数量
+    ttl_cache_evict_func evict; // 条目离开缓存时的回调
+    void *evict_ctx;            // 回调的上下文
+    uint64_t occupied[TTL_WHEEL_LEVELS];            // 每层非空槽的位图
+    ttl_link wheel[TTL_WHEEL_LEVELS * TTL_WHEEL_SIZE];  // 第level层第idx个槽位于level * TTL_WHEEL_SIZE + idx
+};
+
+/*
+    Functions
+*/
+
+// 把条目挂到时间轮上：间隔小于64的放在第0层，小于64^2的放在第1层，以此类推；
+// 高层的槽在低层转完一圈时整体下放，每个条目最多下放TTL_WHEEL_LEVELS - 1次
+static void ttl_wheel_add(
+    IN ttl_cache *tc,
+    IN ttl_entry *e
+)
+{
+    uint64_t when = (e->expire < tc->next) ? tc->next : e->expire;
+    uint64_t delta = when - tc->next;
+    unsigned int level = 0;
+    unsigned int idx = 0;
+    ttl_link *slot = NULL;
+
+    // 超出范围的条目先放在最高层的最远处，下放时按真实的到期时间重新放置
+    if(delta >= TTL_WHEEL_RANGE)
+    {
+        delta = TTL_WHEEL_RANGE - 1;
+        when = tc->next + delta;
+    }
+
+    while(level < TTL_WHEEL_LEVELS - 1 && delta >= (1ull << (TTL_WHEEL_BITS * (level + 1))))
+    {
+        ++ level;
+    }
+
+    idx = (when >> (TTL_WHEEL_BITS * level)) & TTL_WHEEL_MASK;
+    slot = &tc->wheel[level * TTL_WHEEL_SIZE + idx];
+
+    e->link.prev = slot->prev;
+    e->link.next = slot;
+    slot->prev->next = &e->link;
+    slot->prev = &e->link;
+    tc->occupied[level] |= 1ull << idx;
+}
+
+// 把条目从时间轮上摘除，槽变为空时清除位图
+static void ttl_wheel_del(
+    IN ttl_cache *tc,
+    IN ttl_entry *e
+)
+{
+    ttl_link *prev = e->link.prev;
+    ttl_link *next = e->link.next;
+    unsigned int off = 0;
+
+    prev->next = next;
+    next->prev = prev;
+
+    // 前后相同说明只剩哨兵
+    if(prev == next)
+    {
+        off = (unsigned int)(prev - tc->wheel);
+        tc->occupied[off / TTL_WHEEL_SIZE] &= ~(1ull << (off % TTL_WHEEL_SIZE));
+    }
+}
+
+// 取下整个槽的链表，返回第一个节点，链表以槽的哨兵结尾
+static ttl_link* ttl_wheel_take(
+    IN ttl_cache *tc,
+    IN unsigned int level,
+    IN unsigned int idx
+)
+{
+    ttl_link *slot = &tc->wheel[level * TTL_WHEEL_SIZE + idx];
+    ttl_link *first = slot->next;
+
+    if(first == slot)
+    {
+        return NULL;
+    }
+
+    slot->prev->next = NULL;
+    slot->prev = slot;
+    slot->next = slot;
+    tc->occupied[level] &= ~(1ull << idx);
+
+    return first;
+}
+
+// 把高层一个槽的条目按到期时间重新放置到低层
+static void ttl_wheel_cascade(
+    IN ttl_cache *tc,
+    IN unsigned int level,
+    IN unsigned int idx
+)
+{
+    ttl_link *node = ttl_wheel_take(tc, level, idx);
+    ttl_link *next = NULL;
+
+    for(; node; node = next)
+    {
+        next = node->next;
+        ttl_wheel_add(tc, (ttl_entry*)node);
+    }
+}
+
+// 从tc->next开始下一个需要处理的滴答：第0层非空槽到期，或高层非空槽下放。第level层的槽只在
+// 64^level的整数倍处访问，按位图循环右移后找第一个非空槽即可算出；之间的滴答只会访问空槽，
+// 可以直接跳过。时间轮为空或溢出时返回UINT64_MAX
+static uint64_t ttl_wheel_next(IN ttl_cache *tc)
+{
+    uint64_t t = tc->next;
+    uint64_t best = UINT64_MAX;
+    uint64_t base = 0;
+    uint64_t bits = 0;
+    uint64_t when = 0;
+    unsigned int level = 0;
+    unsigned int shift = 0;
+    unsigned int idx = 0;
+    unsigned int k = 0;
+
+    for(level = 0; level < TTL_WHEEL_LEVELS; ++ level)
+    {
+        bits = tc->occupied[level];
+        if(0 == bits)
+        {
+            continue;
+        }
+
+        // 本层在t之后第一次被访问的滴答，溢出时跳过
+        shift = TTL_WHEEL_BITS * level;
+        base = (t + (1ull << shift) - 1) & ~((1ull << shift) - 1);
+        if(base < t)
+        {
+            continue;
+        }
+
+        // 从base对应的槽开始循环查找
+        idx = (base >> shift) & TTL_WHEEL_MASK;
+        if(idx)
+        {
+            bits = (bits >> idx) | (bits << (TTL_WHEEL_SIZE - idx));
+        }
+        k = (unsigned int)__builtin_ctzll(bits);
+        if((uint64_t)k > ((UINT64_MAX - base) >> shift))
+        {
+            continue;
+        }
+
+        when = base + ((uint64_t)k << shift);
+        if(when < best)
+        {
+            best = when;
+        }
+    }
+
+    return best;
+}
+
+// 从当前时间开始计算到期时间，溢出时取最大值
+static inline uint64_t ttl_expire_of(
+    IN ttl_cache *tc,
+    IN uint64_t ttl
+)
+{
+    uint64_t now = tc->next - 1;
+    return (ttl > UINT64_MAX - now) ? UINT64_MAX : now + ttl;
+}
+
+// 条目离开缓存，在锁外调用回调后释放
+static void ttl_entry_release(
+    IN ttl_cache *tc,
+    IN ttl_entry *e,
+    IN TTL_CACHE_EVICT_REASON reason
+)
+{
+    if(tc->evict)
+    {
+        tc->evict(e->key, e->value, reason, tc->evict_ctx);
+    }
+    free(e);
+}
+
+// 创建过期缓存
+static ttl_cache* _ttl_cache_create(
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN ttl_cache_evict_func evict,
+    IN void *ctx,
+    IN uint64_t now
+)
+{
+    ttl_cache *tc = NULL;
+    unsigned int i = 0;
+
+    if(unlikely(!hash || !cmp || now == UINT64_MAX))
+    {
+        DBG("bad in param for create ttl cache");
+        return NULL;
+    }
+
+    tc = (ttl_cache*)malloc(sizeof(ttl_cache));
+    if(unlikely(!tc))
+    {
+        DBG("malloc space of ttl cache fail");
+        return NULL;
+    }
+    memset(tc, 0, sizeof(ttl_cache));
+
+    tc->table = hash_table_create_ex(HASH_TABLE_CHAIN, TTL_TABLE_INIT, hash, cmp, NULL);
+    if(unlikely(!tc->table))
+    {
+        DBG("create hash table fail");
+        free(tc);
+        return NULL;
+    }
+
+    if(0 != pthread_mutex_init(&tc->lock, NULL))
+    {
+        DBG("init mutex fail");
+        hash_table_destroy(tc->table);
+        free(tc);
+        return NULL;
+    }
+
+    for(i = 0; i < TTL_WHEEL_LEVELS * TTL_WHEEL_SIZE; ++ i)
+    {
+        tc->wheel[i].prev = &tc->wheel[i];
+        tc->wheel[i].next = &tc->wheel[i];
+    }
+
+    tc->next = now + 1;
+    tc->evict = evict;
+    tc->evict_ctx = ctx;
+
+    return tc;
+}
+
+// 销毁过期缓存
+static STATUS _ttl_cache_destroy(IN ttl_cache *tc)
+{
+    ttl_link *node = NULL;
+    ttl_link *next = NULL;
+    unsigned int i = 0;
+
+    if(unlikely(!tc))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    for(i = 0; i < TTL_WHEEL_LEVELS * TTL_WHEEL_SIZE; ++ i)
+    {
+        for(node = ttl_wheel_take(tc, i / TTL_WHEEL_SIZE, i % TTL_WHEEL_SIZE); node; node = next)
+        {
+            next = node->next;
+            ttl_entry_release(tc, (ttl_entry*)node, TTL_CACHE_DESTROY);
+        }
+    }
+
+    hash_table_destroy(tc->table);
+    pthread_mutex_destroy(&tc->lock);
+    free(tc);
+
+    return OK;
+}
+
+// 加入或替换条目
+static STATUS _ttl_cache_put(
+    IN ttl_cache *tc,
+    IN void *key,
+    IN void *value,
+    IN uint64_t ttl
+)
+{
+    ttl_entry *e = NULL;
+    ttl_entry *old = NULL;
+    STATUS ret = OK;
+
+    if(unlikely(!tc || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    e = (ttl_entry*)malloc(sizeof(ttl_entry));
+    if(unlikely(!e))
+    {
+        DBG("malloc ttl entry fail");
+        return ERR_NO_MEMORY;
+    }
+    e->key = key;
+    e->value = value;
+
+    pthread_mutex_lock(&tc->lock);
+
+    ret = hash_table_put(tc->table, key, e, (void**)&old);
+    if(unlikely(OK != ret))
+    {
+        pthread_mutex_unlock(&tc->lock);
+        free(e);
+        return ret;
+    }
+
+    if(old)
+    {
+        ttl_wheel_del(tc, old);
+        -- tc->count;
+    }
+
+    e->expire = ttl_expire_of(tc, ttl);
+    ttl_wheel_add(tc, e);
+    ++ tc->count;
+
+    pthread_mutex_unlock(&tc->lock);
+
+    if(old)
+    {
+        ttl_entry_release(tc, old, TTL_CACHE_REPLACE);
+    }
+
+    return OK;
+}
+
+// 查找键
+static void* _ttl_cache_get(
+    IN ttl_cache *tc,
+    IN void *key
+)
+{
+    ttl_entry *e = NULL;
+    void *value = NULL;
+
+    if(unlikely(!tc || !key))
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&tc->lock);
+    e = (ttl_entry*)hash_table_get(tc->table, key);
+    if(e)
+    {
+        value = e->value;
+    }
+    pthread_mutex_unlock(&tc->lock);
+
+    return value;
+}
+
+// 重新设置存活时间，从时间轮上摘下再挂到新的槽，O(1)
+static STATUS _ttl_cache_refresh(
+    IN ttl_cache *tc,
+    IN void *key,
+    IN uint64_t ttl
+)
+{
+    ttl_entry *e = NULL;
+
+    if(unlikely(!tc || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    pthread_mutex_lock(&tc->lock);
+    e = (ttl_entry*)hash_table_get(tc->table, key);
+    if(e)
+    {
+        ttl_wheel_del(tc, e);
+        e->expire = ttl_expire_of(tc, ttl);
+        ttl_wheel_add(tc, e);
+    }
+    pthread_mutex_unlock(&tc->lock);
+
+    return e ? OK : ERR_CACHE_DATA_NOT_EXIST;
+}
+
+// 移除条目
+static STATUS _ttl_cache_remove(
+    IN ttl_cache *tc,
+    IN void *key
+)
+{
+    ttl_entry *e = NULL;
+
+    if(unlikely(!tc || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    pthread_mutex_lock(&tc->lock);
+    if(OK == hash_table_pop(tc->table, key, (void**)&e))
+    {
+        ttl_wheel_del(tc, e);
+        -- tc->count;
+    }
+    pthread_mutex_unlock(&tc->lock);
+
+    if(!e)
+    {
+        return ERR_CACHE_DATA_NOT_EXIST;
+    }
+
+    ttl_entry_release(tc, e, TTL_CACHE_REMOVE);
+
+    return OK;
+}
+
+// 推进时间。每个滴答先在低层转完一圈时下放高层的槽，再移除第0层当前槽的全部条目；
+// 根据各层位图直接跳到下一个访问非空槽的滴答，开销与下放和到期的条目数量成正比，与经过的时间无关
+static STATUS _ttl_cache_tick(
+    IN ttl_cache *tc,
+    IN uint64_t now,
+    OUT unsigned int *expired
+)
+{
+    ttl_link *node = NULL;
+    ttl_link *next = NULL;
+    ttl_link *list = NULL;
+    uint64_t t = 0;
+    unsigned int level = 0;
+    unsigned int idx = 0;
+    unsigned int n = 0;
+
+    if(unlikely(!tc || now == UINT64_MAX))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    pthread_mutex_lock(&tc->lock);
+
+    while(tc->next <= now)
+    {
+        if(0 == tc->count)
+        {
+            tc->next = now + 1;
+            break;
+        }
+
+        t = ttl_wheel_next(tc);
+        if(t > now)
+        {
+            tc->next = now + 1;
+            break;
+        }
+
+        // 下放以t为基准重新放置
+        tc->next = t;
+        idx = t & TTL_WHEEL_MASK;
+        for(level = 1; 0 == idx && level < TTL_WHEEL_LEVELS; ++ level)
+        {
+            idx = (t >> (TTL_WHEEL_BITS * level)) & TTL_WHEEL_MASK;
+            ttl_wheel_cascade(tc, level, idx);
+        }
+
+        // 到期的条目串到list上，在锁外回调
+        for(node = ttl_wheel_take(tc, 0, t & TTL_WHEEL_MASK); node; node = next)
+        {
+            next = node->next;
+            hash_table_pop(tc->table, ((ttl_entry*)node)->key, NULL);
+            -- tc->count;
+            node->next = list;
+            list = node;
+            ++ n;
+        }
+
+        tc->next = t + 1;
+    }
+
+    pthread_mutex_unlock(&tc->lock);
+
+    for(; list; list = next)
+    {
+        next = list->next;
+        ttl_entry_release(tc, (ttl_entry*)list, TTL_CACHE_EXPIRE);
+    }
+
+    if(expired)
+    {
+        *expired = n;
+    }
+
+    return OK;
+}
+
+// 获取条目数量
+static STATUS _ttl_cache_get_size(
+    IN ttl_cache *tc,
+    OUT unsigned int *size
+)
+{
+    if(unlikely(!tc || !size))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    pthread_mutex_lock(&tc->lock);
+    *size = tc->count;
+    pthread_mutex_unlock(&tc->lock);
+
+    return OK;
+}
+
+/*
+    Variables
+*/
+
+ttl_cache_ops ttl_cache_operations = {
+    .ttl_cache_create = _ttl_cache_create,
+    .ttl_cache_destroy = _ttl_cache_destroy,
+    .ttl_cache_put = _ttl_cache_put,
+    .ttl_cache_get = _ttl_cache_get,
+    .ttl_cache_refresh = _ttl_cache_refresh,
+    .ttl_cache_remove = _ttl_cache_remove,
+    .ttl_cache_tick = _ttl_cache_tick,
+    .ttl_cache_get_size = _ttl_cache_get_size,
+};
+
+/*
+    Test
+*/
+
+#if CACHE_TEST
+
+#define TTL_TEST_KEYS   (2000)
+
+// 记录回调
+typedef struct
+{
+    int calls[TTL_CACHE_DESTROY + 1];   // 每种原因的回调次数
+    void *last_key;                     // 最近一次回调的键
+    void *last_value;                   // 最近一次回调的值
+}ttl_test_record;
+
+static unsigned int ttl_test_hash(void *data)
+{
+    return (unsigned int)*(int*)data;
+}
+
+static bool ttl_test_cmp(void *d1, void *d2)
+{
+    return *(int*)d1 == *(int*)d2;
+}
+
+static void ttl_test_evict(void *key, void *value, TTL_CACHE_EVICT_REASON reason, void *ctx)
+{
+    ttl_test_record *rec = (ttl_test_record*)ctx;
+
+    ++ rec->calls[reason];
+    rec->last_key = key;
+    rec->last_value = value;
+}
+
+// 检查推进到now时恰好到期expect个条目
+static void ttl_test_tick(ttl_cache *tc, uint64_t now, unsigned int expect)
+{
+#if CMOCKA_TEST
+    unsigned int n = 0;
+
+    assert_int_equal(OK, ttl_cache_tick(tc, now, &n));
+    assert_int_equal(expect, n);
+#endif
+}
+
+// 各层的条目按时到期，续期和替换后按新的时间到期
+static void ttl_cache_basic_test()
+{
+#if CMOCKA_TEST
+    static int keys[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static int values[8];
+    static ttl_test_record rec;
+    ttl_cache *tc = NULL;
+    unsigned int size = 0;
+
+    memset(&rec, 0, sizeof(rec));
+
+    assert_null(ttl_cache_create(NULL, ttl_test_cmp, NULL, NULL, 0));
+    tc = ttl_cache_create(ttl_test_hash, ttl_test_cmp, ttl_test_evict, &rec, 0);
+    assert_non_null(tc);
+
+    assert_int_not_equal(OK, ttl_cache_put(NULL, &keys[0], &values[0], 1));
+    assert_int_not_equal(OK, ttl_cache_put(tc, NULL, &values[0], 1));
+    assert_int_equal(ERR_CACHE_DATA_NOT_EXIST, ttl_cache_refresh(tc, &keys[0], 1));
+
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[0], &values[0], 5));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[1], &values[1], 10));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[2], &values[2], 100));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[3], &values[3], 5000));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[4], &values[4], TTL_WHEEL_RANGE + 12345));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[5], &values[5], 5));
+    assert_int_equal(OK, ttl_cache_remove(tc, &keys[5]));
+    assert_int_equal(1, rec.calls[TTL_CACHE_REMOVE]);
+    assert_int_equal(ERR_CACHE_DATA_NOT_EXIST, ttl_cache_remove(tc, &keys[5]));
+    assert_int_equal(OK, ttl_cache_get_size(tc, &size));
+    assert_int_equal(5, size);
+
+    ttl_test_tick(tc, 4, 0);
+    assert_ptr_equal(&values[0], ttl_cache_get(tc, &keys[0]));
+    ttl_test_tick(tc, 5, 1);
+    assert_ptr_equal(&keys[0], rec.last_key);
+    assert_ptr_equal(&values[0], rec.last_value);
+    assert_null(ttl_cache_get(tc, &keys[0]));
+
+    // 续期从当前时间开始计算
+    assert_int_equal(OK, ttl_cache_refresh(tc, &keys[1], 10));
+    ttl_test_tick(tc, 14, 0);
+    ttl_test_tick(tc, 15, 1);
+    assert_ptr_equal(&keys[1], rec.last_key);
+
+    // 替换时旧条目交给回调，按新条目的时间到期
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[1], &values[1], 3));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[1], &values[6], 50));
+    assert_int_equal(1, rec.calls[TTL_CACHE_REPLACE]);
+    assert_ptr_equal(&values[1], rec.last_value);
+    ttl_test_tick(tc, 20, 0);
+    ttl_test_tick(tc, 64, 0);
+    ttl_test_tick(tc, 65, 1);
+    assert_ptr_equal(&values[6], rec.last_value);
+
+    // 高层的条目经过下放后按时到期
+    ttl_test_tick(tc, 99, 0);
+    ttl_test_tick(tc, 100, 1);
+    ttl_test_tick(tc, 4999, 0);
+    ttl_test_tick(tc, 5000, 1);
+    assert_ptr_equal(&keys[3], rec.last_key);
+
+    // 超出时间轮范围的条目
+    ttl_test_tick(tc, TTL_WHEEL_RANGE + 12344, 0);
+    assert_ptr_equal(&values[4], ttl_cache_get(tc, &keys[4]));
+    ttl_test_tick(tc, TTL_WHEEL_RANGE + 12345, 1);
+    assert_int_equal(6, rec.calls[TTL_CACHE_EXPIRE]);
+
+    // 表为空时时间直接推进，时间不会倒退
+    ttl_test_tick(tc, TTL_WHEEL_RANGE * 4, 0);
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[7], &values[7], 0));
+    ttl_test_tick(tc, 100, 0);
+    ttl_test_tick(tc, TTL_WHEEL_RANGE * 4 + 1, 1);
+
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[0], &values[0], 1000));
+    assert_return_code(OK, ttl_cache_destroy(tc));
+    assert_int_equal(1, rec.calls[TTL_CACHE_DESTROY]);
+#endif
+}
+
+// 大量随机存活时间的条目，每个条目恰好在到期时间被移除
+static void ttl_cache_random_test()
+{
+#if CMOCKA_TEST
+    static int keys[TTL_TEST_KEYS];
+    static uint64_t expire[TTL_TEST_KEYS];
+    static ttl_test_record rec;
+    ttl_cache *tc = NULL;
+    unsigned int seed = 7;
+    unsigned int n = 0;
+    unsigned int size = 0;
+    uint64_t now = 1000;
+    uint64_t ttl = 0;
+    int expect = 0;
+    int i = 0;
+
+    memset(&rec, 0, sizeof(rec));
+
+    tc = ttl_cache_create(ttl_test_hash, ttl_test_cmp, ttl_test_evict, &rec, now);
+    assert_non_null(tc);
+
+    for(i = 0; i < TTL_TEST_KEYS; ++ i)
+    {
+        keys[i] = i;
+        seed = seed * 1103515245u + 12345u;
+        ttl = (seed >> 8) % (1u << (3 * (i % 7)));
+        expire[i] = now + (ttl ? ttl : 1);
+        assert_int_equal(OK, ttl_cache_put(tc, &keys[i], &keys[i], ttl));
+    }
+
+    // 以不同的步长推进，每次到期的数量与预期相同
+    while(now < 1000 + (1u << 18))
+    {
+        seed = seed * 1103515245u + 12345u;
+        now += (seed >> 8) % 300;
+
+        expect = 0;
+        for(i = 0; i < TTL_TEST_KEYS; ++ i)
+        {
+            if(expire[i] && expire[i] <= now)
+            {
+                ++ expect;
+                expire[i] = 0;
+            }
+        }
+
+        assert_int_equal(OK, ttl_cache_tick(tc, now, &n));
+        assert_int_equal(expect, n);
+    }
+
+    assert_int_equal(OK, ttl_cache_get_size(tc, &size));
+    assert_int_equal(0, size);
+    assert_int_equal(TTL_TEST_KEYS, rec.calls[TTL_CACHE_EXPIRE]);
+
+    assert_return_code(OK, ttl_cache_destroy(tc));
+#endif
+}
+
+// 相距很远的条目之间不逐个访问空槽，一次推进跨过很长的时间
+static void ttl_cache_gap_test()
+{
+#if CMOCKA_TEST
+    static int keys[3] = {0, 1, 2};
+    static ttl_test_record rec;
+    ttl_cache *tc = NULL;
+    uint64_t now = 12345;
+
+    memset(&rec, 0, sizeof(rec));
+
+    tc = ttl_cache_create(ttl_test_hash, ttl_test_cmp, ttl_test_evict, &rec, now);
+    assert_non_null(tc);
+
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[0], &keys[0], 1ull << 30));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[1], &keys[1], (1ull << 30) + 70));
+    assert_int_equal(OK, ttl_cache_put(tc, &keys[2], &keys[2], 3ull << 40));
+
+    ttl_test_tick(tc, now + (1ull << 30) - 1, 0);
+    ttl_test_tick(tc, now + (1ull << 30), 1);
+    assert_ptr_equal(&keys[0], rec.last_key);
+    ttl_test_tick(tc, now + (1ull << 30) + 69, 0);
+    ttl_test_tick(tc, now + (1ull << 30) + 70, 1);
+    ttl_test_tick(tc, now + (3ull << 40) - 1, 0);
+    ttl_test_tick(tc, UINT64_MAX - 1, 1);
+    assert_ptr_equal(&keys[2], rec.last_key);
+
+    assert_return_code(OK, ttl_cache_destroy(tc));
+#endif
+}
+
+void ttl_cache_test()
+{
+#if CMOCKA_TEST
+    ttl_cache_basic_test();
+    ttl_cache_random_test();
+    ttl_cache_gap_test();
+#endif
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef _TTL_CACHE_H
+#define _TTL_CACHE_H
+
+/*
+    Include files
+*/
+
+#include <stdint.h>
+#include "hash_table/hash_table.h"
+
+/*
+    typedefs
+*/
+
+// 过期缓存声明，隐藏成员
+typedef struct ttl_cache ttl_cache;
+// 条目离开缓存的原因
+typedef enum
+{
+    TTL_CACHE_EXPIRE,       // 到期，由ttl_cache_tick移除
+    TTL_CACHE_REPLACE,      // 被相同键的新条目替换
+    TTL_CACHE_REMOVE,       // 被ttl_cache_remove移除
+    TTL_CACHE_DESTROY,      // 缓存销毁
+}TTL_CACHE_EVICT_REASON;
+// 条目离开缓存时的回调，在锁外调用，通常用于释放键和值
+typedef void (*ttl_cache_evict_func)(void *key, void *value, TTL_CACHE_EVICT_REASON reason, void *ctx);
+// 过期缓存操作集合
+typedef struct ttl_cache_ops
+{
+    // 创建过期缓存
+    ttl_cache* (*ttl_cache_create)(hash_func, cmp_func, ttl_cache_evict_func, void*, uint64_t);
+    // 销毁过期缓存
+    STATUS (*ttl_cache_destroy)(ttl_cache*);
+    // 加入或替换条目并设置存活时间
+    STATUS (*ttl_cache_put)(ttl_cache*, void*, void*, uint64_t);
+    // 查找键，返回对应的值
+    void* (*ttl_cache_get)(ttl_cache*, void*);
+    // 重新设置存活时间
+    STATUS (*ttl_cache_refresh)(ttl_cache*, void*, uint64_t);
+    // 移除条目
+    STATUS (*ttl_cache_remove)(ttl_cache*, void*);
+    // 推进时间并移除到期的条目
+    STATUS (*ttl_cache_tick)(ttl_cache*, uint64_t, unsigned int*);
+    // 获取条目数量
+    STATUS (*ttl_cache_get_size)(ttl_cache*, unsigned int*);
+}ttl_cache_ops;
+
+/*
+    Extern symbols
+*/
+
+extern ttl_cache_ops ttl_cache_operations;
+
+/*
+    Functions
+*/
+
+// 创建过期缓存。时间以滴答为单位，含义由调用者决定（例如毫秒或秒），now为当前时间
+static inline ttl_cache* ttl_cache_create(
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN ttl_cache_evict_func evict,
+    IN void *ctx,
+    IN uint64_t now
+)
+{
+    return ttl_cache_operations.ttl_cache_create(hash, cmp, evict, ctx, now);
+}
+
+// 销毁过期缓存，对剩余条目以TTL_CACHE_DESTROY调用回调
+static inline STATUS ttl_cache_destroy(IN ttl_cache *tc)
+{
+    return ttl_cache_operations.ttl_cache_destroy(tc);
+}
+
+// 加入条目，在当前时间之后ttl个滴答到期；键已存在时替换，旧条目以TTL_CACHE_REPLACE调用回调
+static inline STATUS ttl_cache_put(
+    IN ttl_cache *tc,
+    IN void *key,
+    IN void *value,
+    IN uint64_t ttl
+)
+{
+    return ttl_cache_operations.ttl_cache_put(tc, key, value, ttl);
+}
+
+// 查找键，返回对应的值，不存在时返回NULL
+static inline void* ttl_cache_get(
+    IN ttl_cache *tc,
+    IN void *key
+)
+{
+    return ttl_cache_operations.ttl_cache_get(tc, key);
+}
+
+// 重新设置存活时间，从当前时间开始计算，例如会话有新请求时续期
+static inline STATUS ttl_cache_refresh(
+    IN ttl_cache *tc,
+    IN void *key,
+    IN uint64_t ttl
+)
+{
+    return ttl_cache_operations.ttl_cache_refresh(tc, key, ttl);
+}
+
+// 移除条目，以TTL_CACHE_REMOVE调用回调
+static inline STATUS ttl_cache_remove(
+    IN ttl_cache *tc,
+    IN void *key
+)
+{
+    return ttl_cache_operations.ttl_cache_remove(tc, key);
+}
+
+// 把时间推进到now，到期的条目以TTL_CACHE_EXPIRE调用回调，expired返回到期的数量，可为NULL。
+// 每个滴答的开销为常数加上到期条目的数量，与条目总数无关，需要定期调用
+static inline STATUS ttl_cache_tick(
+    IN ttl_cache *tc,
+    IN uint64_t now,
+    OUT unsigned int *expired
+)
+{
+    return ttl_cache_operations.ttl_cache_tick(tc, now, expired);
+}
+
+// 获取条目数量
+static inline STATUS ttl_cache_get_size(
+    IN ttl_cache *tc,
+    OUT unsigned int *size
+)
+{
+    return ttl_cache_operations.ttl_cache_get_size(tc, size);
+}
+
+// 测试接口
+#if CACHE_TEST
+void ttl_cache_test();
+#endif
+
+#endif
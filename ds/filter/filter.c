@@ -0,0 +1,1475 @@
+/*
+    Include files
+*/
+
+#define _POSIX_C_SOURCE 200112L     // sched_yield
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "filter.h"
+#include "hash_table/hash_table_engine.h"
+
+/*
+    Defines
+*/
+
+#define FILTER_CACHE_LINE   (64)        // 缓存行大小
+#define BLOOM_BLOCK_WORDS   (8)         // 每块8个64位字，共64字节，恰好一个缓存行
+#define CUCKOO_SLOTS        (4)         // 每个字的指纹数量
+#define CUCKOO_BLOCK_WORDS  (7)         // 每块存放指纹的字数，加上一个元数据字共64字节，恰好一个缓存行
+#define CUCKOO_BLOCK_SLOTS  (CUCKOO_BLOCK_WORDS * CUCKOO_SLOTS)
+#define CUCKOO_LOAD         (80)        // 创建时按该负载百分比计算块数量
+#define CUCKOO_BALANCE      (22)        // 第一个候选块的指纹达到该数量后，放入两块中较空的一块
+#define CUCKOO_BLOCK_MAX    (0x4000000u)    // 最大块数量
+#define CUCKOO_OVERFLOW_MAX (0xFu)      // 每组记录的溢出数量上限
+#define CUCKOO_LANE_LOW     (0x0001000100010001ull)     // 字内每个指纹的最低位
+#define CUCKOO_LANE_HIGH    (0x8000800080008000ull)     // 字内每个指纹的最高位
+#define FILTER_STRIPES      (32)        // 挂在哈希表前时写者的条带锁数量，2的幂
+#define FILTER_REBUILD_MAX  (8)         // 重建时容量超过元素数量的该倍数仍放不下，说明哈希值大量相同，不再扩大
+
+// 元数据字：低32位为序号，奇数表示正在修改；高32位按指纹分为8组，每组4位，记录该组溢出到溢出块的指纹数量
+#define CUCKOO_META_OVERFLOW(m, i)  ((unsigned int)((m) >> (32 + 4 * (i))) & CUCKOO_OVERFLOW_MAX)
+#define CUCKOO_META_OVERFLOW_ONE(i) (1ull << (32 + 4 * (i)))
+
+/*
+    typedefs
+*/
+
+// 分块布隆过滤器：一个元素的所有位都落在同一个64字节的块中，查找只访问一个缓存行
+struct bloom_filter
+{
+    _Atomic uint64_t *blocks;   // 块数组，按缓存行对齐，第i块为blocks[i * BLOOM_BLOCK_WORDS]
+    unsigned int block_count;   // 块数量
+    void *mem;                  // 块数组的原始内存
+};
+
+// 布谷鸟过滤器的块，正好一个缓存行：指纹可以放在块内任意空位，查找通常只访问一个缓存行。
+// 元数据字兼作块的顺序锁，修改时加锁，查找不加锁，读到修改中的块时重试
+typedef struct
+{
+    _Atomic uint64_t fps[CUCKOO_BLOCK_WORDS];   // 每个字4个16位指纹，0表示空位
+    _Atomic uint64_t meta;      // 元数据字
+}cuckoo_block;
+
+// 布谷鸟过滤器：每个元素保存16位指纹，可以放在两个候选块之一，支持删除
+struct cuckoo_filter
+{
+    cuckoo_block *blocks;       // 块数组，按缓存行对齐
+    unsigned int block_mask;    // 块数量减1，块数量为2的幂
+    atomic_uint count;          // 已加入的数量
+    void *mem;                  // 块数组的原始内存
+    struct cuckoo_filter *retired;  // 挂在哈希表前时，重建之前的过滤器串成链表
+};
+
+// 条带锁，按缓存行对齐
+typedef struct
+{
+    _Alignas(FILTER_CACHE_LINE)
+    pthread_mutex_t lock;
+}filter_stripe;
+
+// 挂在哈希表前的过滤器
+struct hash_table_filter
+{
+    filter_stripe stripes[FILTER_STRIPES];  // 写者按键的哈希值加条带锁，同一个键的修改互斥，保证过滤器与哈希表一致
+    hash_table *hs;             // 哈希表
+    _Atomic(cuckoo_filter*) cf; // 当前的过滤器，读者不加锁
+    cuckoo_filter *retired;     // 重建后被替换的过滤器，读者可能仍在访问，取下时释放
+    cuckoo_filter *building;    // 重建中的过滤器
+    bool building_full;         // 重建中的过滤器放不下
+    void *mem;                  // 结构的原始内存
+};
+
+/*
+    Functions
+*/
+
+// 申请按缓存行对齐的内存并清零，raw返回原始指针用于释放
+static void* filter_alloc_aligned(
+    IN size_t size,
+    OUT void **raw
+)
+{
+    void *mem = malloc(size + FILTER_CACHE_LINE);
+
+    *raw = mem;
+    if(unlikely(!mem))
+    {
+        return NULL;
+    }
+    memset(mem, 0, size + FILTER_CACHE_LINE);
+
+    return (void*)(((uintptr_t)mem + FILTER_CACHE_LINE - 1) & ~(uintptr_t)(FILTER_CACHE_LINE - 1));
+}
+
+// 哈希值高32位选块，低32位与8个奇数常数相乘，每个字取乘积的高6位作为位下标；
+// 8个字的计算互不依赖，编译器可以向量化
+static inline _Atomic uint64_t* bloom_block_mask(
+    IN bloom_filter *bf,
+    IN uint64_t hash,
+    OUT uint64_t mask[BLOOM_BLOCK_WORDS]
+)
+{
+    static const uint32_t salt[BLOOM_BLOCK_WORDS] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+        0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+    };
+    uint32_t low = (uint32_t)hash;
+    uint64_t block = ((hash >> 32) * bf->block_count) >> 32;
+    unsigned int i = 0;
+
+    for(i = 0; i < BLOOM_BLOCK_WORDS; ++ i)
+    {
+        mask[i] = 1ull << ((uint32_t)(low * salt[i]) >> 26);
+    }
+
+    return &bf->blocks[block * BLOOM_BLOCK_WORDS];
+}
+
+// 创建布隆过滤器
+static bloom_filter* _bloom_filter_create(
+    IN unsigned int expected,
+    IN unsigned int bits_per_key
+)
+{
+    bloom_filter *bf = NULL;
+    uint64_t bits = (uint64_t)expected * bits_per_key;
+    uint64_t blocks = (bits + BLOOM_BLOCK_WORDS * 64 - 1) / (BLOOM_BLOCK_WORDS * 64);
+    unsigned int i = 0;
+
+    if(unlikely(expected == 0 || bits_per_key == 0 || blocks > UINT32_MAX))
+    {
+        DBG("bad in param for create bloom filter");
+        return NULL;
+    }
+
+    bf = (bloom_filter*)malloc(sizeof(bloom_filter));
+    if(unlikely(!bf))
+    {
+        DBG("malloc space of bloom filter fail");
+        return NULL;
+    }
+
+    bf->block_count = (unsigned int)blocks;
+    bf->blocks = (_Atomic uint64_t*)filter_alloc_aligned(sizeof(uint64_t) * BLOOM_BLOCK_WORDS * blocks, &bf->mem);
+    if(unlikely(!bf->blocks))
+    {
+        DBG("malloc space of %u blocks fail", bf->block_count);
+        free(bf);
+        return NULL;
+    }
+
+    for(i = 0; i < bf->block_count * BLOOM_BLOCK_WORDS; ++ i)
+    {
+        atomic_init(&bf->blocks[i], 0);
+    }
+
+    return bf;
+}
+
+// 销毁布隆过滤器
+static STATUS _bloom_filter_destroy(IN bloom_filter *bf)
+{
+    if(unlikely(!bf))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    free(bf->mem);
+    free(bf);
+
+    return OK;
+}
+
+// 加入哈希值，用原子或设置位，多个线程可以同时加入和查找
+static STATUS _bloom_filter_add(
+    IN bloom_filter *bf,
+    IN uint64_t hash
+)
+{
+    uint64_t mask[BLOOM_BLOCK_WORDS];
+    _Atomic uint64_t *block = NULL;
+    unsigned int i = 0;
+
+    if(unlikely(!bf))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    block = bloom_block_mask(bf, hash, mask);
+    for(i = 0; i < BLOOM_BLOCK_WORDS; ++ i)
+    {
+        if((atomic_load_explicit(&block[i], memory_order_relaxed) & mask[i]) != mask[i])
+        {
+            atomic_fetch_or_explicit(&block[i], mask[i], memory_order_relaxed);
+        }
+    }
+
+    return OK;
+}
+
+// 检查哈希值是否可能存在，8个字都包含对应的位才可能存在
+static bool _bloom_filter_contain(
+    IN bloom_filter *bf,
+    IN uint64_t hash
+)
+{
+    uint64_t mask[BLOOM_BLOCK_WORDS];
+    _Atomic uint64_t *block = NULL;
+    uint64_t miss = 0;
+    unsigned int i = 0;
+
+    if(unlikely(!bf))
+    {
+        return false;
+    }
+
+    block = bloom_block_mask(bf, hash, mask);
+    for(i = 0; i < BLOOM_BLOCK_WORDS; ++ i)
+    {
+        miss |= ~atomic_load_explicit(&block[i], memory_order_relaxed) & mask[i];
+    }
+
+    return 0 == miss;
+}
+
+// 指纹取哈希值低16位，0表示空位，因此映射为1
+static inline uint16_t cuckoo_fingerprint(IN uint64_t hash)
+{
+    uint16_t fp = (uint16_t)hash;
+    return fp ? fp : 1;
+}
+
+// 第一个候选块取哈希值高32位
+static inline cuckoo_block* cuckoo_block_of(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    return &cf->blocks[(hash >> 32) & cf->block_mask];
+}
+
+// 溢出分组取指纹高3位，块按分组记录溢出的指纹数量，查找时只有本组有溢出才访问溢出块。
+// 分组只依赖指纹，同一块中指纹相同的元素无法区分，删除其中任何一个都要减少同一个计数
+static inline unsigned int cuckoo_group_of(IN uint16_t fp)
+{
+    return fp >> 13;
+}
+
+// 溢出块，第一个候选块较满时可以放在这里。只依赖第一个候选块和指纹，同一块中指纹相同的元素
+// 溢出到同一块，删除时互相替代不会造成漏判。只有一块时返回b本身
+static inline cuckoo_block* cuckoo_overflow_of(
+    IN cuckoo_filter *cf,
+    IN cuckoo_block *b,
+    IN uint16_t fp
+)
+{
+    unsigned int x = ((uint32_t)(fp * 0x9E3779B1u) >> 8) & cf->block_mask;
+    return &cf->blocks[(unsigned int)(b - cf->blocks) ^ (x ? x : (1 & cf->block_mask))];
+}
+
+// 在一个字的4个指纹中查找，返回位置，不存在时返回-1；fp为0时查找空位。
+// 4个指纹同时比较，最低的命中位置不受借位影响，结果准确
+static inline int cuckoo_word_find(
+    IN uint64_t word,
+    IN uint16_t fp
+)
+{
+    uint64_t x = word ^ (CUCKOO_LANE_LOW * fp);
+    uint64_t hit = (x - CUCKOO_LANE_LOW) & ~x & CUCKOO_LANE_HIGH;
+
+    return hit ? (int)(__builtin_ctzll(hit) >> 4) : -1;
+}
+
+// 设置字中第pos个指纹
+static inline uint64_t cuckoo_word_set(
+    IN uint64_t word,
+    IN unsigned int pos,
+    IN uint16_t fp
+)
+{
+    return (word & ~(0xFFFFull << (16 * pos))) | ((uint64_t)fp << (16 * pos));
+}
+
+// 自旋等待，多次之后让出CPU，持有者可能被调度出去
+static inline void cuckoo_backoff(IN OUT unsigned int *spins)
+{
+    if(++ *spins > 64)
+    {
+        sched_yield();
+    }
+}
+
+// 不加锁在块中查找指纹：序号为奇数或前后不同时重试，返回读到的元数据
+static uint64_t cuckoo_block_find(
+    IN cuckoo_block *b,
+    IN uint16_t fp,
+    OUT bool *found
+)
+{
+    unsigned int spins = 0;
+    unsigned int i = 0;
+    uint64_t m1 = 0;
+    uint64_t m2 = 0;
+    bool hit = false;
+
+    for(;;)
+    {
+        m1 = atomic_load_explicit(&b->meta, memory_order_acquire);
+        if(!(m1 & 1))
+        {
+            hit = false;
+            for(i = 0; i < CUCKOO_BLOCK_WORDS; ++ i)
+            {
+                hit |= cuckoo_word_find(atomic_load_explicit(&b->fps[i], memory_order_relaxed), fp) >= 0;
+            }
+            atomic_thread_fence(memory_order_acquire);
+            m2 = atomic_load_explicit(&b->meta, memory_order_relaxed);
+            if(m1 == m2)
+            {
+                *found = hit;
+                return m1;
+            }
+        }
+        cuckoo_backoff(&spins);
+    }
+}
+
+// 修改块前加锁：把序号从偶数改为奇数，返回加锁后的元数据
+static uint64_t cuckoo_block_lock(IN cuckoo_block *b)
+{
+    unsigned int spins = 0;
+    uint64_t m = atomic_load_explicit(&b->meta, memory_order_relaxed);
+
+    for(;;)
+    {
+        if(m & 1)
+        {
+            cuckoo_backoff(&spins);
+            m = atomic_load_explicit(&b->meta, memory_order_relaxed);
+        }
+        else if(atomic_compare_exchange_weak_explicit(&b->meta, &m, m + 1,
+                                                      memory_order_acquire, memory_order_relaxed))
+        {
+            // 读者看到之后的修改时，一定也看到奇数序号
+            atomic_thread_fence(memory_order_release);
+            return m + 1;
+        }
+    }
+}
+
+// 解锁，m为加锁时返回的元数据，期间可能修改了溢出数量
+static inline void cuckoo_block_unlock(
+    IN cuckoo_block *b,
+    IN uint64_t m
+)
+{
+    atomic_store_explicit(&b->meta, m + 1, memory_order_release);
+}
+
+// 按地址顺序给两个不同的块加锁
+static void cuckoo_block_lock2(
+    IN cuckoo_block *b1,
+    IN cuckoo_block *b2,
+    OUT uint64_t *m1,
+    OUT uint64_t *m2
+)
+{
+    if(b1 < b2)
+    {
+        *m1 = cuckoo_block_lock(b1);
+        *m2 = cuckoo_block_lock(b2);
+    }
+    else
+    {
+        *m2 = cuckoo_block_lock(b2);
+        *m1 = cuckoo_block_lock(b1);
+    }
+}
+
+// 持有块锁时统计块中的指纹数量
+static unsigned int cuckoo_block_used(IN cuckoo_block *b)
+{
+    unsigned int i = 0;
+    unsigned int n = 0;
+    uint64_t w = 0;
+
+    for(i = 0; i < CUCKOO_BLOCK_WORDS; ++ i)
+    {
+        w = atomic_load_explicit(&b->fps[i], memory_order_relaxed);
+        // 非0的指纹在最高位留下1
+        n += (unsigned int)__builtin_popcountll((((w & ~CUCKOO_LANE_HIGH) + ~CUCKOO_LANE_HIGH) | w) & CUCKOO_LANE_HIGH);
+    }
+
+    return n;
+}
+
+// 持有块锁时把指纹放入第一个空位，块已满时返回false
+static bool cuckoo_block_add(
+    IN cuckoo_block *b,
+    IN uint16_t fp
+)
+{
+    unsigned int i = 0;
+    uint64_t w = 0;
+    int pos = 0;
+
+    for(i = 0; i < CUCKOO_BLOCK_WORDS; ++ i)
+    {
+        w = atomic_load_explicit(&b->fps[i], memory_order_relaxed);
+        pos = cuckoo_word_find(w, 0);
+        if(pos >= 0)
+        {
+            atomic_store_explicit(&b->fps[i], cuckoo_word_set(w, (unsigned int)pos, fp), memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// 持有块锁时删除一个指纹
+static bool cuckoo_block_del(
+    IN cuckoo_block *b,
+    IN uint16_t fp
+)
+{
+    unsigned int i = 0;
+    uint64_t w = 0;
+    int pos = 0;
+
+    for(i = 0; i < CUCKOO_BLOCK_WORDS; ++ i)
+    {
+        w = atomic_load_explicit(&b->fps[i], memory_order_relaxed);
+        pos = cuckoo_word_find(w, fp);
+        if(pos >= 0)
+        {
+            atomic_store_explicit(&b->fps[i], cuckoo_word_set(w, (unsigned int)pos, 0), memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// 检查指纹是否存在：通常只读第一个候选块；本组有溢出的指纹时再读溢出块
+static bool cuckoo_find(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    uint16_t fp = cuckoo_fingerprint(hash);
+    cuckoo_block *b1 = cuckoo_block_of(cf, hash);
+    cuckoo_block *b2 = NULL;
+    bool found = false;
+    uint64_t m = cuckoo_block_find(b1, fp, &found);
+
+    if(found || 0 == CUCKOO_META_OVERFLOW(m, cuckoo_group_of(fp)))
+    {
+        return found;
+    }
+
+    b2 = cuckoo_overflow_of(cf, b1, fp);
+    if(b2 != b1)
+    {
+        cuckoo_block_find(b2, fp, &found);
+    }
+
+    return found;
+}
+
+// 加入指纹：第一个候选块不太满时直接放入；否则两块一起加锁，放入较空的一块，放入溢出块时在第一个候选块记录溢出数量。
+// 两块都放不下时返回ERR_FILTER_FULL
+static STATUS cuckoo_insert(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    uint16_t fp = cuckoo_fingerprint(hash);
+    unsigned int g = cuckoo_group_of(fp);
+    cuckoo_block *b1 = cuckoo_block_of(cf, hash);
+    cuckoo_block *b2 = cuckoo_overflow_of(cf, b1, fp);
+    uint64_t m1 = cuckoo_block_lock(b1);
+    uint64_t m2 = 0;
+    unsigned int used1 = 0;
+    STATUS ret = ERR_FILTER_FULL;
+
+    if((b2 == b1 || cuckoo_block_used(b1) < CUCKOO_BALANCE) && cuckoo_block_add(b1, fp))
+    {
+        cuckoo_block_unlock(b1, m1);
+        goto done;
+    }
+    cuckoo_block_unlock(b1, m1);
+
+    if(b2 == b1)
+    {
+        return ERR_FILTER_FULL;
+    }
+
+    // 放开后两块一起加锁，期间第一个候选块可能已经腾出空位
+    cuckoo_block_lock2(b1, b2, &m1, &m2);
+    used1 = cuckoo_block_used(b1);
+    if((used1 < CUCKOO_BALANCE || used1 <= cuckoo_block_used(b2)) && cuckoo_block_add(b1, fp))
+    {
+        ret = OK;
+    }
+    else if(CUCKOO_META_OVERFLOW(m1, g) < CUCKOO_OVERFLOW_MAX && cuckoo_block_add(b2, fp))
+    {
+        m1 += CUCKOO_META_OVERFLOW_ONE(g);
+        ret = OK;
+    }
+    else if(cuckoo_block_add(b1, fp))
+    {
+        ret = OK;
+    }
+    cuckoo_block_unlock(b2, m2);
+    cuckoo_block_unlock(b1, m1);
+
+    if(OK != ret)
+    {
+        return ret;
+    }
+
+done:
+    atomic_fetch_add_explicit(&cf->count, 1, memory_order_relaxed);
+    return OK;
+}
+
+// 删除指纹：先在第一个候选块中删除，没有时到溢出块中删除并减少溢出数量
+static STATUS cuckoo_delete(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    uint16_t fp = cuckoo_fingerprint(hash);
+    unsigned int g = cuckoo_group_of(fp);
+    cuckoo_block *b1 = cuckoo_block_of(cf, hash);
+    cuckoo_block *b2 = cuckoo_overflow_of(cf, b1, fp);
+    uint64_t m1 = cuckoo_block_lock(b1);
+    uint64_t m2 = 0;
+    STATUS ret = ERR_FILTER_DATA_NOT_EXIST;
+
+    if(cuckoo_block_del(b1, fp))
+    {
+        cuckoo_block_unlock(b1, m1);
+        goto done;
+    }
+    cuckoo_block_unlock(b1, m1);
+
+    if(b2 == b1 || 0 == CUCKOO_META_OVERFLOW(m1, g))
+    {
+        return ERR_FILTER_DATA_NOT_EXIST;
+    }
+
+    cuckoo_block_lock2(b1, b2, &m1, &m2);
+    if(cuckoo_block_del(b1, fp))
+    {
+        ret = OK;
+    }
+    else if(CUCKOO_META_OVERFLOW(m1, g) && cuckoo_block_del(b2, fp))
+    {
+        m1 -= CUCKOO_META_OVERFLOW_ONE(g);
+        ret = OK;
+    }
+    cuckoo_block_unlock(b2, m2);
+    cuckoo_block_unlock(b1, m1);
+
+    if(OK != ret)
+    {
+        return ret;
+    }
+
+done:
+    atomic_fetch_sub_explicit(&cf->count, 1, memory_order_relaxed);
+    return OK;
+}
+
+// 创建布谷鸟过滤器，块数量按80%的负载向上取2的幂
+static cuckoo_filter* _cuckoo_filter_create(IN unsigned int capacity)
+{
+    cuckoo_filter *cf = NULL;
+    uint64_t need = ((uint64_t)capacity * 100 / CUCKOO_LOAD + CUCKOO_BLOCK_SLOTS - 1) / CUCKOO_BLOCK_SLOTS;
+    unsigned int blocks = 1;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    if(unlikely(capacity == 0 || need > CUCKOO_BLOCK_MAX))
+    {
+        DBG("bad in param for create cuckoo filter");
+        return NULL;
+    }
+
+    while(blocks < need)
+    {
+        blocks <<= 1;
+    }
+
+    cf = (cuckoo_filter*)malloc(sizeof(cuckoo_filter));
+    if(unlikely(!cf))
+    {
+        DBG("malloc space of cuckoo filter fail");
+        return NULL;
+    }
+    memset(cf, 0, sizeof(cuckoo_filter));
+
+    cf->blocks = (cuckoo_block*)filter_alloc_aligned(sizeof(cuckoo_block) * (size_t)blocks, &cf->mem);
+    if(unlikely(!cf->blocks))
+    {
+        DBG("malloc space of %u blocks fail", blocks);
+        free(cf);
+        return NULL;
+    }
+
+    for(i = 0; i < blocks; ++ i)
+    {
+        for(j = 0; j < CUCKOO_BLOCK_WORDS; ++ j)
+        {
+            atomic_init(&cf->blocks[i].fps[j], 0);
+        }
+        atomic_init(&cf->blocks[i].meta, 0);
+    }
+
+    cf->block_mask = blocks - 1;
+    atomic_init(&cf->count, 0);
+
+    return cf;
+}
+
+// 销毁布谷鸟过滤器
+static STATUS _cuckoo_filter_destroy(IN cuckoo_filter *cf)
+{
+    if(unlikely(!cf))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    free(cf->mem);
+    free(cf);
+
+    return OK;
+}
+
+// 加入哈希值
+static STATUS _cuckoo_filter_add(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    if(unlikely(!cf))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return cuckoo_insert(cf, hash);
+}
+
+// 删除哈希值
+static STATUS _cuckoo_filter_remove(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    if(unlikely(!cf))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return cuckoo_delete(cf, hash);
+}
+
+// 检查哈希值是否可能存在
+static bool _cuckoo_filter_contain(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    if(unlikely(!cf))
+    {
+        return false;
+    }
+
+    return cuckoo_find(cf, hash);
+}
+
+// 获取已加入的数量
+static STATUS _cuckoo_filter_get_size(
+    IN cuckoo_filter *cf,
+    OUT unsigned int *size
+)
+{
+    if(unlikely(!cf || !size))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    *size = atomic_load_explicit(&cf->count, memory_order_relaxed);
+
+    return OK;
+}
+
+// 计算键的64位哈希值：带种子的哈希函数直接使用，32位哈希函数的结果再扩展到64位
+static inline uint64_t hash_table_filter_hash(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    if(hs->seeded_hash)
+    {
+        return hs->seeded_hash(key, hs->seed);
+    }
+
+    return hash_table_hash_u64(hs->hash(key), 0);
+}
+
+// 键所在的条带锁
+static inline pthread_mutex_t* hash_table_filter_stripe(
+    IN hash_table_filter *hf,
+    IN uint64_t h
+)
+{
+    return &hf->stripes[(h >> 32) & (FILTER_STRIPES - 1)].lock;
+}
+
+// 把表中的键加入新的过滤器
+static bool hash_table_filter_fill(
+    IN void *key,
+    IN void *value,
+    IN void *param
+)
+{
+    hash_table_filter *hf = (hash_table_filter*)param;
+
+    (void)value;
+    hf->building_full = (OK != cuckoo_insert(hf->building, hash_table_filter_hash(hf->hs, key)));
+
+    return !hf->building_full;
+}
+
+// 按容量从哈希表重建过滤器，放不下时容量翻倍，翻倍也放不下时返回ERR_FILTER_FULL，当前过滤器不变。
+// 旧过滤器可能仍有读者在访问，挂到retired上，取下时释放。调用者持有全部条带锁或尚未发布hf
+static STATUS hash_table_filter_rebuild(
+    IN hash_table_filter *hf,
+    IN unsigned int capacity
+)
+{
+    cuckoo_filter *old = atomic_load_explicit(&hf->cf, memory_order_relaxed);
+    unsigned int size = 0;
+
+    hash_table_get_size(hf->hs, &size);
+    if(capacity < size)
+    {
+        capacity = size;
+    }
+
+    for(;;)
+    {
+        hf->building = _cuckoo_filter_create(capacity);
+        if(unlikely(!hf->building))
+        {
+            return ERR_NO_MEMORY;
+        }
+
+        hf->building_full = false;
+        if(OK == hash_table_foreach(hf->hs, hash_table_filter_fill, hf) && !hf->building_full)
+        {
+            break;
+        }
+
+        _cuckoo_filter_destroy(hf->building);
+        hf->building = NULL;
+        if(capacity > UINT32_MAX / 2 || capacity / FILTER_REBUILD_MAX > size)
+        {
+            DBG("rebuild filter of %u keys fail", size);
+            return ERR_FILTER_FULL;
+        }
+        capacity *= 2;
+    }
+
+    atomic_store_explicit(&hf->cf, hf->building, memory_order_release);
+    hf->building = NULL;
+
+    if(old)
+    {
+        old->retired = hf->retired;
+        hf->retired = old;
+    }
+
+    return OK;
+}
+
+// 过滤器放不下新键时扩容：放开条带锁后按顺序持有全部条带锁，过滤器没有被其他线程重建时按两倍容量重建。
+// 容量已远超元素数量仍放不下时，是新键与大量已有的键哈希值相同，扩容也无济于事，返回ERR_FILTER_FULL
+static STATUS hash_table_filter_grow(
+    IN hash_table_filter *hf,
+    IN cuckoo_filter *cf
+)
+{
+    uint64_t capacity = (uint64_t)(cf->block_mask + 1) * CUCKOO_BLOCK_SLOTS * CUCKOO_LOAD / 100;
+    unsigned int size = 0;
+    STATUS ret = OK;
+    unsigned int i = 0;
+
+    for(i = 0; i < FILTER_STRIPES; ++ i)
+    {
+        pthread_mutex_lock(&hf->stripes[i].lock);
+    }
+
+    if(cf == atomic_load_explicit(&hf->cf, memory_order_relaxed))
+    {
+        hash_table_get_size(hf->hs, &size);
+        ret = (capacity / FILTER_REBUILD_MAX > size) ? ERR_FILTER_FULL :
+              hash_table_filter_rebuild(hf, (unsigned int)(capacity * 2));
+    }
+
+    for(i = FILTER_STRIPES; i > 0; -- i)
+    {
+        pthread_mutex_unlock(&hf->stripes[i - 1].lock);
+    }
+
+    return ret;
+}
+
+// 在哈希表前挂上过滤器
+static hash_table_filter* _hash_table_filter_attach(
+    IN hash_table *hs,
+    IN unsigned int capacity
+)
+{
+    hash_table_filter *hf = NULL;
+    void *mem = NULL;
+    unsigned int i = 0;
+
+    if(unlikely(!hs || capacity == 0))
+    {
+        DBG("bad in param for attach filter");
+        return NULL;
+    }
+
+    // 条带锁按缓存行对齐
+    hf = (hash_table_filter*)filter_alloc_aligned(sizeof(hash_table_filter), &mem);
+    if(unlikely(!hf))
+    {
+        DBG("malloc space of hash table filter fail");
+        free(mem);
+        return NULL;
+    }
+    hf->mem = mem;
+    hf->hs = hs;
+    atomic_init(&hf->cf, NULL);
+
+    if(OK != hash_table_filter_rebuild(hf, capacity))
+    {
+        free(mem);
+        return NULL;
+    }
+
+    for(i = 0; i < FILTER_STRIPES; ++ i)
+    {
+        if(0 != pthread_mutex_init(&hf->stripes[i].lock, NULL))
+        {
+            DBG("init mutex fail");
+            while(i > 0)
+            {
+                pthread_mutex_destroy(&hf->stripes[-- i].lock);
+            }
+            _cuckoo_filter_destroy(atomic_load_explicit(&hf->cf, memory_order_relaxed));
+            free(mem);
+            return NULL;
+        }
+    }
+
+    return hf;
+}
+
+// 取下过滤器，一并释放重建时替换下来的旧过滤器
+static STATUS _hash_table_filter_detach(IN hash_table_filter *hf)
+{
+    cuckoo_filter *cf = NULL;
+    cuckoo_filter *next = NULL;
+    unsigned int i = 0;
+
+    if(unlikely(!hf))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    _cuckoo_filter_destroy(atomic_load_explicit(&hf->cf, memory_order_relaxed));
+    for(cf = hf->retired; cf; cf = next)
+    {
+        next = cf->retired;
+        _cuckoo_filter_destroy(cf);
+    }
+    for(i = 0; i < FILTER_STRIPES; ++ i)
+    {
+        pthread_mutex_destroy(&hf->stripes[i].lock);
+    }
+    free(hf->mem);
+
+    return OK;
+}
+
+// 检查键是否存在，不加过滤器的锁
+static bool _hash_table_filter_contain(
+    IN hash_table_filter *hf,
+    IN void *key
+)
+{
+    if(unlikely(!hf || !key))
+    {
+        return false;
+    }
+
+    return cuckoo_find(atomic_load_explicit(&hf->cf, memory_order_acquire), hash_table_filter_hash(hf->hs, key)) &&
+           hash_table_contain(hf->hs, key);
+}
+
+// 查找键，不加过滤器的锁
+static void* _hash_table_filter_get(
+    IN hash_table_filter *hf,
+    IN void *key
+)
+{
+    if(unlikely(!hf || !key))
+    {
+        return NULL;
+    }
+
+    if(!cuckoo_find(atomic_load_explicit(&hf->cf, memory_order_acquire), hash_table_filter_hash(hf->hs, key)))
+    {
+        return NULL;
+    }
+
+    return hash_table_get(hf->hs, key);
+}
+
+// 加入或替换键值对。过滤器判定不存在的键一定是新键，不需要再查哈希表。
+// 过滤器放不下新键时，在条带锁内把新键移出哈希表，扩容成功后重试，扩容失败时表和过滤器都保持原样
+static STATUS _hash_table_filter_put(
+    IN hash_table_filter *hf,
+    IN void *key,
+    IN void *value,
+    OUT void **old_value
+)
+{
+    pthread_mutex_t *lock = NULL;
+    cuckoo_filter *cf = NULL;
+    uint64_t h = 0;
+    bool exist = false;
+    STATUS ret = OK;
+
+    if(unlikely(!hf || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    h = hash_table_filter_hash(hf->hs, key);
+    lock = hash_table_filter_stripe(hf, h);
+
+    for(;;)
+    {
+        pthread_mutex_lock(lock);
+
+        cf = atomic_load_explicit(&hf->cf, memory_order_relaxed);
+        exist = cuckoo_find(cf, h) && hash_table_contain(hf->hs, key);
+        ret = hash_table_put(hf->hs, key, value, old_value);
+        if(OK == ret && !exist)
+        {
+            ret = cuckoo_insert(cf, h);
+            if(ERR_FILTER_FULL == ret)
+            {
+                // 新键的旧值本就是NULL，移出时不覆盖old_value
+                hash_table_pop(hf->hs, key, NULL);
+            }
+        }
+
+        pthread_mutex_unlock(lock);
+
+        if(ERR_FILTER_FULL != ret)
+        {
+            return ret;
+        }
+        ret = hash_table_filter_grow(hf, cf);
+        if(OK != ret)
+        {
+            return ret;
+        }
+    }
+}
+
+// 加入数据，过滤器放不下时与put一样先移出再扩容重试
+static STATUS _hash_table_filter_insert(
+    IN hash_table_filter *hf,
+    IN void *data
+)
+{
+    pthread_mutex_t *lock = NULL;
+    cuckoo_filter *cf = NULL;
+    uint64_t h = 0;
+    STATUS ret = OK;
+
+    if(unlikely(!hf || !data))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    h = hash_table_filter_hash(hf->hs, data);
+    lock = hash_table_filter_stripe(hf, h);
+
+    for(;;)
+    {
+        pthread_mutex_lock(lock);
+
+        cf = atomic_load_explicit(&hf->cf, memory_order_relaxed);
+        ret = hash_table_insert(hf->hs, data);
+        if(OK == ret)
+        {
+            ret = cuckoo_insert(cf, h);
+            if(ERR_FILTER_FULL == ret)
+            {
+                hash_table_remove(hf->hs, data);
+            }
+        }
+
+        pthread_mutex_unlock(lock);
+
+        if(ERR_FILTER_FULL != ret)
+        {
+            return ret;
+        }
+        ret = hash_table_filter_grow(hf, cf);
+        if(OK != ret)
+        {
+            return ret;
+        }
+    }
+}
+
+// 移除键，成功后从过滤器删除指纹
+static STATUS _hash_table_filter_pop(
+    IN hash_table_filter *hf,
+    IN void *key,
+    OUT void **old_value
+)
+{
+    pthread_mutex_t *lock = NULL;
+    cuckoo_filter *cf = NULL;
+    uint64_t h = 0;
+    STATUS ret = ERR_HASH_TABLE_DATA_NOT_EXIST;
+
+    if(unlikely(!hf || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    h = hash_table_filter_hash(hf->hs, key);
+    lock = hash_table_filter_stripe(hf, h);
+
+    pthread_mutex_lock(lock);
+
+    cf = atomic_load_explicit(&hf->cf, memory_order_relaxed);
+    if(cuckoo_find(cf, h))
+    {
+        ret = hash_table_pop(hf->hs, key, old_value);
+        if(OK == ret)
+        {
+            cuckoo_delete(cf, h);
+        }
+    }
+    else if(old_value)
+    {
+        *old_value = NULL;
+    }
+
+    pthread_mutex_unlock(lock);
+
+    return ret;
+}
+
+/*
+    Variables
+*/
+
+filter_ops filter_operations = {
+    .bloom_filter_create = _bloom_filter_create,
+    .bloom_filter_destroy = _bloom_filter_destroy,
+    .bloom_filter_add = _bloom_filter_add,
+    .bloom_filter_contain = _bloom_filter_contain,
+
+    .cuckoo_filter_create = _cuckoo_filter_create,
+    .cuckoo_filter_destroy = _cuckoo_filter_destroy,
+    .cuckoo_filter_add = _cuckoo_filter_add,
+    .cuckoo_filter_remove = _cuckoo_filter_remove,
+    .cuckoo_filter_contain = _cuckoo_filter_contain,
+    .cuckoo_filter_get_size = _cuckoo_filter_get_size,
+
+    .hash_table_filter_attach = _hash_table_filter_attach,
+    .hash_table_filter_detach = _hash_table_filter_detach,
+    .hash_table_filter_contain = _hash_table_filter_contain,
+    .hash_table_filter_get = _hash_table_filter_get,
+    .hash_table_filter_put = _hash_table_filter_put,
+    .hash_table_filter_insert = _hash_table_filter_insert,
+    .hash_table_filter_pop = _hash_table_filter_pop,
+};
+
+/*
+    Test
+*/
+
+#if FILTER_TEST
+
+#define FILTER_TEST_KEYS    (4000)
+#define FILTER_TEST_STABLE  (1000)      // 并发测试中预先加入、不会被修改的键数量
+#define FILTER_TEST_RANGE   (1000)      // 并发测试中每个写者反复加入、移除的键数量
+#define FILTER_TEST_WRITERS (2)
+#define FILTER_TEST_READERS (2)
+#define FILTER_TEST_ROUNDS  (3)
+
+// 布隆过滤器：加入的哈希值一定存在，未加入的误判率较低
+static void bloom_filter_test()
+{
+#if CMOCKA_TEST
+    bloom_filter *bf = NULL;
+    unsigned int fp = 0;
+    unsigned int i = 0;
+
+    assert_null(bloom_filter_create(0, 10));
+    assert_null(bloom_filter_create(10, 0));
+    assert_int_not_equal(OK, bloom_filter_add(NULL, 1));
+    assert_false(bloom_filter_contain(NULL, 1));
+
+    bf = bloom_filter_create(FILTER_TEST_KEYS, 12);
+    assert_non_null(bf);
+    assert_int_equal(0, (uintptr_t)bf->blocks % FILTER_CACHE_LINE);
+
+    for(i = 0; i < FILTER_TEST_KEYS; ++ i)
+        assert_int_equal(OK, bloom_filter_add(bf, hash_table_hash_u64(i, 1)));
+    for(i = 0; i < FILTER_TEST_KEYS; ++ i)
+        assert_true(bloom_filter_contain(bf, hash_table_hash_u64(i, 1)));
+
+    for(i = FILTER_TEST_KEYS; i < FILTER_TEST_KEYS * 11; ++ i)
+    {
+        if(bloom_filter_contain(bf, hash_table_hash_u64(i, 1)))
+            ++ fp;
+    }
+    assert_true(fp < FILTER_TEST_KEYS * 10 / 50);
+
+    assert_return_code(OK, bloom_filter_destroy(bf));
+#endif
+}
+
+// 布谷鸟过滤器：删除后不再存在，放满后已加入的指纹都不丢失
+static void cuckoo_filter_test()
+{
+#if CMOCKA_TEST
+    cuckoo_filter *cf = NULL;
+    unsigned int size = 0;
+    unsigned int fp = 0;
+    unsigned int i = 0;
+    unsigned int n = 0;
+
+    assert_null(cuckoo_filter_create(0));
+    assert_int_not_equal(OK, cuckoo_filter_add(NULL, 1));
+
+    cf = cuckoo_filter_create(FILTER_TEST_KEYS);
+    assert_non_null(cf);
+
+    for(i = 0; i < FILTER_TEST_KEYS; ++ i)
+        assert_int_equal(OK, cuckoo_filter_add(cf, hash_table_hash_u64(i, 2)));
+    for(i = 0; i < FILTER_TEST_KEYS; ++ i)
+        assert_true(cuckoo_filter_contain(cf, hash_table_hash_u64(i, 2)));
+    assert_int_equal(OK, cuckoo_filter_get_size(cf, &size));
+    assert_int_equal(FILTER_TEST_KEYS, size);
+
+    for(i = 0; i < FILTER_TEST_KEYS; i += 2)
+        assert_int_equal(OK, cuckoo_filter_remove(cf, hash_table_hash_u64(i, 2)));
+    for(i = 1; i < FILTER_TEST_KEYS; i += 2)
+        assert_true(cuckoo_filter_contain(cf, hash_table_hash_u64(i, 2)));
+    for(i = 0; i < FILTER_TEST_KEYS; i += 2)
+    {
+        if(cuckoo_filter_contain(cf, hash_table_hash_u64(i, 2)))
+            ++ fp;
+    }
+    assert_true(fp < 10);
+    assert_int_equal(OK, cuckoo_filter_get_size(cf, &size));
+    assert_int_equal(FILTER_TEST_KEYS / 2, size);
+
+    assert_return_code(OK, cuckoo_filter_destroy(cf));
+
+    // 一直加入直到放满
+    cf = cuckoo_filter_create(64);
+    assert_non_null(cf);
+    for(n = 0; OK == cuckoo_filter_add(cf, hash_table_hash_u64(n, 3)); ++ n)
+        ;
+    assert_true(n >= 64);
+    for(i = 0; i < n; ++ i)
+        assert_true(cuckoo_filter_contain(cf, hash_table_hash_u64(i, 3)));
+
+    // 放满时不丢失已加入的指纹，删除后其余指纹仍在
+    assert_int_equal(OK, cuckoo_filter_remove(cf, hash_table_hash_u64(0, 3)));
+    for(i = 1; i < n; ++ i)
+        assert_true(cuckoo_filter_contain(cf, hash_table_hash_u64(i, 3)));
+    assert_int_equal(OK, cuckoo_filter_get_size(cf, &size));
+    assert_int_equal(n - 1, size);
+
+    assert_return_code(OK, cuckoo_filter_destroy(cf));
+
+    // 第一个候选块和指纹都相同的元素无法区分，部分溢出到溢出块，按任意顺序删除都不漏判
+    cf = cuckoo_filter_create(64);
+    assert_non_null(cf);
+    for(i = 0; i < 40; ++ i)
+        assert_int_equal(OK, cuckoo_filter_add(cf, ((uint64_t)i << 16) | 0x1234));
+    for(i = 0; i < 40; ++ i)
+    {
+        assert_true(cuckoo_filter_contain(cf, ((uint64_t)(39 - i) << 16) | 0x1234));
+        assert_int_equal(OK, cuckoo_filter_remove(cf, ((uint64_t)i << 16) | 0x1234));
+    }
+    assert_false(cuckoo_filter_contain(cf, 0x1234));
+    assert_int_equal(ERR_FILTER_DATA_NOT_EXIST, cuckoo_filter_remove(cf, 0x1234));
+
+    assert_return_code(OK, cuckoo_filter_destroy(cf));
+#endif
+}
+
+static unsigned int filter_test_hash(void *data)
+{
+    return (unsigned int)*(int*)data;
+}
+
+static bool filter_test_cmp(void *d1, void *d2)
+{
+    return *(int*)d1 == *(int*)d2;
+}
+
+// 挂在哈希表前：结果与哈希表一致，超出容量时自动重建
+static void hash_table_filter_test()
+{
+#if CMOCKA_TEST
+    static int keys[FILTER_TEST_KEYS];
+    hash_table *hs = NULL;
+    hash_table_filter *hf = NULL;
+    void *old = NULL;
+    int key = 0;
+    int i = 0;
+
+    for(i = 0; i < FILTER_TEST_KEYS; ++ i)
+        keys[i] = i;
+
+    hs = hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 16, filter_test_hash, filter_test_cmp, NULL);
+    assert_non_null(hs);
+    for(i = 0; i < 100; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &keys[i]));
+
+    assert_null(hash_table_filter_attach(NULL, 16));
+    hf = hash_table_filter_attach(hs, 16);
+    assert_non_null(hf);
+
+    // 已有的键在挂上时加入过滤器
+    for(i = 0; i < 100; ++ i)
+        assert_true(hash_table_filter_contain(hf, &keys[i]));
+
+    for(i = 100; i < FILTER_TEST_KEYS; ++ i)
+        assert_int_equal(OK, hash_table_filter_insert(hf, &keys[i]));
+    assert_int_equal(ERR_HASH_TABLE_DATA_EXIST, hash_table_filter_insert(hf, &keys[5]));
+    for(i = 0; i < FILTER_TEST_KEYS; ++ i)
+        assert_ptr_equal(&keys[i], hash_table_filter_get(hf, &keys[i]));
+
+    key = FILTER_TEST_KEYS;
+    assert_false(hash_table_filter_contain(hf, &key));
+    assert_null(hash_table_filter_get(hf, &key));
+
+    // 替换已有的键
+    assert_int_equal(OK, hash_table_filter_put(hf, &keys[7], NULL, &old));
+    assert_ptr_equal(&keys[7], old);
+    assert_true(hash_table_filter_contain(hf, &keys[7]));
+    assert_null(hash_table_filter_get(hf, &keys[7]));
+
+    for(i = 0; i < FILTER_TEST_KEYS; i += 2)
+        assert_int_equal(OK, hash_table_filter_remove(hf, &keys[i]));
+    assert_int_equal(ERR_HASH_TABLE_DATA_NOT_EXIST, hash_table_filter_remove(hf, &keys[0]));
+    assert_int_equal(ERR_HASH_TABLE_DATA_NOT_EXIST, hash_table_filter_pop(hf, &key, &old));
+    assert_null(old);
+    for(i = 0; i < FILTER_TEST_KEYS; ++ i)
+        assert_int_equal(i % 2 == 1, hash_table_filter_contain(hf, &keys[i]));
+
+    assert_return_code(OK, hash_table_filter_detach(hf));
+    assert_true(hash_table_contain(hs, &keys[1]));
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+// 所有键的哈希值相同，过滤器扩容也放不下
+static unsigned int filter_test_same_hash(void *data)
+{
+    (void)data;
+    return 7;
+}
+
+// 过滤器无法扩容时，新键不留在表中，表和过滤器保持一致
+static void hash_table_filter_full_test()
+{
+#if CMOCKA_TEST
+    static int keys[200];
+    hash_table *hs = NULL;
+    hash_table_filter *hf = NULL;
+    void *old = NULL;
+    unsigned int size = 0;
+    STATUS ret = OK;
+    int n = 0;
+    int i = 0;
+
+    for(i = 0; i < 200; ++ i)
+        keys[i] = i;
+
+    hs = hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 16, filter_test_same_hash, filter_test_cmp, NULL);
+    assert_non_null(hs);
+    hf = hash_table_filter_attach(hs, 16);
+    assert_non_null(hf);
+
+    for(n = 0; n < 200 && OK == (ret = hash_table_filter_insert(hf, &keys[n])); ++ n)
+        ;
+    assert_int_equal(ERR_FILTER_FULL, ret);
+    assert_true(n >= CUCKOO_BLOCK_SLOTS);
+    assert_false(hash_table_contain(hs, &keys[n]));
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(n, size);
+
+    // put新键失败时旧值为NULL，替换已有的键不受影响
+    old = &keys[0];
+    assert_int_equal(ERR_FILTER_FULL, hash_table_filter_put(hf, &keys[n], &keys[n], &old));
+    assert_null(old);
+    assert_false(hash_table_contain(hs, &keys[n]));
+    assert_int_equal(OK, hash_table_filter_put(hf, &keys[1], NULL, &old));
+    assert_ptr_equal(&keys[1], old);
+
+    for(i = 0; i < n; ++ i)
+        assert_true(hash_table_filter_contain(hf, &keys[i]));
+    assert_false(hash_table_filter_contain(hf, &keys[n]));
+
+    // 移除一个键后空出位置，之前失败的键可以加入
+    assert_int_equal(OK, hash_table_filter_remove(hf, &keys[0]));
+    assert_int_equal(OK, hash_table_filter_insert(hf, &keys[n]));
+    assert_true(hash_table_filter_contain(hf, &keys[n]));
+    assert_false(hash_table_filter_contain(hf, &keys[0]));
+
+    assert_return_code(OK, hash_table_filter_detach(hf));
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+typedef struct
+{
+    hash_table_filter *hf;
+    int *keys;                  // 写者为自己的键，读者为预先加入的键
+    atomic_bool *stop;
+    unsigned int misses;        // 读者判定不存在的次数
+    bool ok;                    // 写者的操作全部成功
+}filter_test_arg;
+
+// 写者反复加入、移除自己的键，过滤器多次重建
+static void* filter_test_writer(void *param)
+{
+    filter_test_arg *arg = (filter_test_arg*)param;
+    int r = 0;
+    int i = 0;
+
+    for(r = 0; r < FILTER_TEST_ROUNDS; ++ r)
+    {
+        for(i = 0; i < FILTER_TEST_RANGE; ++ i)
+            arg->ok &= (OK == hash_table_filter_insert(arg->hf, &arg->keys[i]));
+        for(i = 0; i < FILTER_TEST_RANGE; ++ i)
+            arg->ok &= (OK == hash_table_filter_remove(arg->hf, &arg->keys[i]));
+    }
+
+    return NULL;
+}
+
+// 读者不加锁反复查找预先加入的键，直到写者结束
+static void* filter_test_reader(void *param)
+{
+    filter_test_arg *arg = (filter_test_arg*)param;
+    int i = 0;
+
+    do
+    {
+        for(i = 0; i < FILTER_TEST_STABLE; ++ i)
+        {
+            if(!hash_table_filter_contain(arg->hf, &arg->keys[i]))
+                ++ arg->misses;
+        }
+    }while(!atomic_load(arg->stop));
+
+    return NULL;
+}
+
+// 并发：写者加入、移除并触发重建时，读者始终能查到预先加入的键
+static void hash_table_filter_concurrent_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    static int keys[FILTER_TEST_STABLE + FILTER_TEST_WRITERS * FILTER_TEST_RANGE];
+    filter_test_arg args[FILTER_TEST_WRITERS + FILTER_TEST_READERS];
+    pthread_t threads[FILTER_TEST_WRITERS + FILTER_TEST_READERS];
+    hash_table *hs = NULL;
+    hash_table_filter *hf = NULL;
+    atomic_bool stop;
+    unsigned int size = 0;
+    int i = 0;
+
+    for(i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); ++ i)
+        keys[i] = i;
+
+    hs = hash_table_create_ex(type, 16, filter_test_hash, filter_test_cmp, NULL);
+    assert_non_null(hs);
+    for(i = 0; i < FILTER_TEST_STABLE; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &keys[i]));
+    hf = hash_table_filter_attach(hs, 16);
+    assert_non_null(hf);
+
+    atomic_init(&stop, false);
+    for(i = 0; i < FILTER_TEST_WRITERS + FILTER_TEST_READERS; ++ i)
+    {
+        args[i].hf = hf;
+        args[i].keys = (i < FILTER_TEST_WRITERS) ? &keys[FILTER_TEST_STABLE + i * FILTER_TEST_RANGE] : keys;
+        args[i].stop = &stop;
+        args[i].misses = 0;
+        args[i].ok = true;
+        assert_int_equal(0, pthread_create(&threads[i], NULL,
+                                           (i < FILTER_TEST_WRITERS) ? filter_test_writer : filter_test_reader,
+                                           &args[i]));
+    }
+    for(i = 0; i < FILTER_TEST_WRITERS; ++ i)
+    {
+        pthread_join(threads[i], NULL);
+        assert_true(args[i].ok);
+    }
+    atomic_store(&stop, true);
+    for(; i < FILTER_TEST_WRITERS + FILTER_TEST_READERS; ++ i)
+    {
+        pthread_join(threads[i], NULL);
+        assert_int_equal(0, args[i].misses);
+    }
+
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(FILTER_TEST_STABLE, size);
+    for(i = 0; i < (int)(sizeof(keys) / sizeof(keys[0])); ++ i)
+        assert_int_equal(i < FILTER_TEST_STABLE, hash_table_filter_contain(hf, &keys[i]));
+
+    assert_return_code(OK, hash_table_filter_detach(hf));
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+void filter_test()
+{
+#if CMOCKA_TEST
+    bloom_filter_test();
+    cuckoo_filter_test();
+    hash_table_filter_test();
+    hash_table_filter_full_test();
+    hash_table_filter_concurrent_test(HASH_TABLE_CHAIN);
+    hash_table_filter_concurrent_test(HASH_TABLE_OPEN_ADDR);
+#endif
+}
+
+#endif
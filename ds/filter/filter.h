@@ -0,0 +1,232 @@
+#ifndef _FILTER_H
+#define _FILTER_H
+
+/*
+    Include files
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hash_table/hash_table.h"
+
+/*
+    typedefs
+*/
+
+// 分块布隆过滤器声明，隐藏成员
+typedef struct bloom_filter bloom_filter;
+// 布谷鸟过滤器声明，隐藏成员
+typedef struct cuckoo_filter cuckoo_filter;
+// 挂在哈希表前的过滤器声明，隐藏成员
+typedef struct hash_table_filter hash_table_filter;
+// 过滤器操作集合
+typedef struct filter_ops
+{
+    // 创建布隆过滤器
+    bloom_filter* (*bloom_filter_create)(unsigned int, unsigned int);
+    // 销毁布隆过滤器
+    STATUS (*bloom_filter_destroy)(bloom_filter*);
+    // 加入哈希值
+    STATUS (*bloom_filter_add)(bloom_filter*, uint64_t);
+    // 检查哈希值是否可能存在
+    bool (*bloom_filter_contain)(bloom_filter*, uint64_t);
+
+    // 创建布谷鸟过滤器
+    cuckoo_filter* (*cuckoo_filter_create)(unsigned int);
+    // 销毁布谷鸟过滤器
+    STATUS (*cuckoo_filter_destroy)(cuckoo_filter*);
+    // 加入哈希值
+    STATUS (*cuckoo_filter_add)(cuckoo_filter*, uint64_t);
+    // 删除哈希值
+    STATUS (*cuckoo_filter_remove)(cuckoo_filter*, uint64_t);
+    // 检查哈希值是否可能存在
+    bool (*cuckoo_filter_contain)(cuckoo_filter*, uint64_t);
+    // 获取已加入的数量
+    STATUS (*cuckoo_filter_get_size)(cuckoo_filter*, unsigned int*);
+
+    // 在哈希表前挂上过滤器
+    hash_table_filter* (*hash_table_filter_attach)(hash_table*, unsigned int);
+    // 取下过滤器，哈希表保留
+    STATUS (*hash_table_filter_detach)(hash_table_filter*);
+    // 检查键是否存在
+    bool (*hash_table_filter_contain)(hash_table_filter*, void*);
+    // 查找键，返回对应的值
+    void* (*hash_table_filter_get)(hash_table_filter*, void*);
+    // 加入或替换键值对
+    STATUS (*hash_table_filter_put)(hash_table_filter*, void*, void*, void**);
+    // 加入数据
+    STATUS (*hash_table_filter_insert)(hash_table_filter*, void*);
+    // 移除键，返回被移除的值
+    STATUS (*hash_table_filter_pop)(hash_table_filter*, void*, void**);
+}filter_ops;
+
+/*
+    Extern symbols
+*/
+
+extern filter_ops filter_operations;
+
+/*
+    Functions
+*/
+
+// 创建布隆过滤器，expected为预期元素数量，bits_per_key为每个元素占用的位数，越大误判率越低
+static inline bloom_filter* bloom_filter_create(
+    IN unsigned int expected,
+    IN unsigned int bits_per_key
+)
+{
+    return filter_operations.bloom_filter_create(expected, bits_per_key);
+}
+
+// 销毁布隆过滤器
+static inline STATUS bloom_filter_destroy(IN bloom_filter *bf)
+{
+    return filter_operations.bloom_filter_destroy(bf);
+}
+
+// 加入哈希值，可以与查找并发，不加锁
+static inline STATUS bloom_filter_add(
+    IN bloom_filter *bf,
+    IN uint64_t hash
+)
+{
+    return filter_operations.bloom_filter_add(bf, hash);
+}
+
+// 检查哈希值是否可能存在：false表示一定不存在，true表示可能存在
+static inline bool bloom_filter_contain(
+    IN bloom_filter *bf,
+    IN uint64_t hash
+)
+{
+    return filter_operations.bloom_filter_contain(bf, hash);
+}
+
+// 创建布谷鸟过滤器，capacity为预期元素数量
+static inline cuckoo_filter* cuckoo_filter_create(IN unsigned int capacity)
+{
+    return filter_operations.cuckoo_filter_create(capacity);
+}
+
+// 销毁布谷鸟过滤器
+static inline STATUS cuckoo_filter_destroy(IN cuckoo_filter *cf)
+{
+    return filter_operations.cuckoo_filter_destroy(cf);
+}
+
+// 加入哈希值，过滤器已满时返回ERR_FILTER_FULL
+static inline STATUS cuckoo_filter_add(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    return filter_operations.cuckoo_filter_add(cf, hash);
+}
+
+// 删除哈希值，只能删除加入过的哈希值，否则可能删掉其他元素的指纹
+static inline STATUS cuckoo_filter_remove(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    return filter_operations.cuckoo_filter_remove(cf, hash);
+}
+
+// 检查哈希值是否可能存在：false表示一定不存在，true表示可能存在
+static inline bool cuckoo_filter_contain(
+    IN cuckoo_filter *cf,
+    IN uint64_t hash
+)
+{
+    return filter_operations.cuckoo_filter_contain(cf, hash);
+}
+
+// 获取已加入的数量
+static inline STATUS cuckoo_filter_get_size(
+    IN cuckoo_filter *cf,
+    OUT unsigned int *size
+)
+{
+    return filter_operations.cuckoo_filter_get_size(cf, size);
+}
+
+// 在哈希表前挂上布谷鸟过滤器，capacity为预期元素数量，表中已有的键会加入过滤器；
+// 挂上之后只能通过hash_table_filter_*修改该表，直接修改哈希表会让过滤器漏掉键
+static inline hash_table_filter* hash_table_filter_attach(
+    IN hash_table *hs,
+    IN unsigned int capacity
+)
+{
+    return filter_operations.hash_table_filter_attach(hs, capacity);
+}
+
+// 取下过滤器，哈希表保留，之后可以直接使用
+static inline STATUS hash_table_filter_detach(IN hash_table_filter *hf)
+{
+    return filter_operations.hash_table_filter_detach(hf);
+}
+
+// 检查键是否存在，过滤器判定不存在时不访问哈希表
+static inline bool hash_table_filter_contain(
+    IN hash_table_filter *hf,
+    IN void *key
+)
+{
+    return filter_operations.hash_table_filter_contain(hf, key);
+}
+
+// 查找键，返回对应的值，过滤器判定不存在时不访问哈希表
+static inline void* hash_table_filter_get(
+    IN hash_table_filter *hf,
+    IN void *key
+)
+{
+    return filter_operations.hash_table_filter_get(hf, key);
+}
+
+// 加入或替换键值对，语义同hash_table_put。过滤器无法扩容时返回ERR_FILTER_FULL，新键不加入哈希表
+static inline STATUS hash_table_filter_put(
+    IN hash_table_filter *hf,
+    IN void *key,
+    IN void *value,
+    OUT void **old_value
+)
+{
+    return filter_operations.hash_table_filter_put(hf, key, value, old_value);
+}
+
+// 加入数据，数据同时作为键和值，语义同hash_table_insert。过滤器无法扩容时返回ERR_FILTER_FULL，数据不加入哈希表
+static inline STATUS hash_table_filter_insert(
+    IN hash_table_filter *hf,
+    IN void *data
+)
+{
+    return filter_operations.hash_table_filter_insert(hf, data);
+}
+
+// 移除键，返回被移除的值，语义同hash_table_pop
+static inline STATUS hash_table_filter_pop(
+    IN hash_table_filter *hf,
+    IN void *key,
+    OUT void **old_value
+)
+{
+    return filter_operations.hash_table_filter_pop(hf, key, old_value);
+}
+
+// 移除数据，语义同hash_table_remove
+static inline STATUS hash_table_filter_remove(
+    IN hash_table_filter *hf,
+    IN void *data
+)
+{
+    return filter_operations.hash_table_filter_pop(hf, data, NULL);
+}
+
+// 测试接口
+#if FILTER_TEST
+void filter_test();
+#endif
+
+#endif
@@ -2,146 +2,124 @@
     Include files
 */
 
-#include "hash_table.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include "hash_table_engine.h"
+#include "thread_pool/thread_pool.h"
 
 /*
     typedefs
 */
 
-// 哈希表结构
-struct hash_table
+// 并行遍历的共享状态，位于调用线程的栈上，thread_pool_parallel_for在所有分片结束后才返回
+typedef struct
 {
-    void** bucket_list;         // 桶链表
-    
-    pthread_mutex_t *mtx;       // 粗粒度锁
-    
-    unsigned int bucket_count;  // 桶的数量
-    hash_func hash; // 哈希函数
+    hash_table *hs;
+    hash_table_visit_func visit;    // 用户回调
+    void *ctx;                      // 用户回调的上下文
 
-};
-
-/*
-    Defines
-*/
-
-#define HS_LOCK(hs)     pthread_mutex_lock(hs->mtx)
-#define HS_UNLOCK(hs)   pthread_mutex_unlock(hs->mtx)
+    atomic_bool stop;               // 有回调返回false，停止其余分片
+}parallel_foreach_ctx;
 
 /*
     Functions
 */
 
-// 创建哈希表
-hash_table* _hash_table_create(
+// 根据引擎类型获取操作集合
+static inline const hash_table_ops* hash_table_engine_get(IN HASH_TABLE_TYPE type)
+{
+    switch(type)
+    {
+        case HASH_TABLE_CHAIN:
+            return &hash_table_chain_operations;
+        case HASH_TABLE_OPEN_ADDR:
+            return &hash_table_oa_operations;
+        case HASH_TABLE_STRIPED:
+            return &hash_table_striped_operations;
+        default:
+            return NULL;
+    }
+}
+
+// 创建指定引擎的哈希表
+static hash_table* _hash_table_create_ex(
+    IN HASH_TABLE_TYPE type,
     IN unsigned int bucket_size,
     IN hash_func hash,
     IN cmp_func cmp,
     IN hash_table_show_func show
 )
 {
-    hash_table *ht = NULL;
-    unsigned int i = 0;
-    dlist *dl = NULL;
+    const hash_table_ops *ops = hash_table_engine_get(type);
 
-    if(unlikely(bucket_size == 0 || NULL == hash || NULL == cmp))
+    if(unlikely(!ops || !hash))
     {
-        DBG("bad in param for create hash table");
+        DBG("bad in param, hash table type %d", type);
         return NULL;
     }
 
-    // 申请hash_table空间
-    ht = (hash_table*)malloc(sizeof(hash_table));
-    if(unlikely(NULL == ht))
-    {
-        DBG("malloc space of hash table fail");
-        goto error;
-    }
-    memset(ht, 0, sizeof(hash_table));
+    return ops->hash_table_create(bucket_size, hash, cmp, show);
+}
 
-    // 申请桶数组
-    ht->bucket_list = (void**)malloc(sizeof(void*)*bucket_size);
-    if(unlikely(NULL == ht->bucket_list))
-    {
-        DBG("malloc space of bucket lists fail");
-        goto error;
-    }
+// 创建使用带种子哈希函数的哈希表
+static hash_table* _hash_table_create_seeded(
+    IN HASH_TABLE_TYPE type,
+    IN unsigned int bucket_size,
+    IN hash_table_seeded_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    const hash_table_ops *ops = hash_table_engine_get(type);
+    hash_table *hs = NULL;
 
-    // 每个桶创建一个链表指向
-    for(i = 0; i < bucket_size; ++ i)
+    if(unlikely(!ops || !hash))
     {
-        dl = (void*)dlist_create(show, cmp);
-        if(unlikely(NULL == dl))
-        {
-            DBG("malloc dlist of bucket [%lu] fail", i);
-            goto error;
-        }
-
-        ht->bucket_list[i] = (void*)dl;
+        DBG("bad in param, hash table type %d", type);
+        return NULL;
     }
 
-    // 初始化锁
-    ht->mtx = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
-    if(unlikely(!ht->mtx))
-    {
-        DBG("malloc space of mutex fail");
-        goto error;
-    }
-    if(0 != pthread_mutex_init(ht->mtx, NULL))
+    // 引擎只通过hash_table_hash计算哈希值，创建后再切换哈希函数
+    hs = ops->hash_table_create(bucket_size, NULL, cmp, show);
+    if(likely(hs))
     {
-        DBG("init mutex fail");
-        goto error;
+        hash_table_base_seed(hs, hash, hash_table_random_seed());
     }
 
-    ht->bucket_count = bucket_size;
-    ht->hash = hash;
+    return hs;
+}
 
-    return ht;
+// 创建哈希表，默认使用链地址法引擎
+static hash_table* _hash_table_create(
+    IN unsigned int bucket_size,
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    return _hash_table_create_ex(HASH_TABLE_CHAIN, bucket_size, hash, cmp, show);
+}
 
-error:
-    for(i = 0; ht && ht->bucket_list && i < bucket_size; ++ i)
+// 转换为只读的完美哈希表，由冻结引擎从原表构建
+static hash_table* _hash_table_freeze(IN hash_table *hs)
+{
+    if(unlikely(!hs))
     {
-        if(ht->bucket_list[i])
-        {
-            free(ht->bucket_list[i]);
-        }
-        else
-        {
-            break;
-        }
+        return NULL;
     }
-    if(ht && ht->bucket_list) free(ht->bucket_list);
-    if(ht->mtx)   free(ht->mtx);
-    if(ht)  free(ht);
-    return NULL;
+
+    return hash_table_frozen_operations.hash_table_freeze(hs);
 }
 
 // 销毁哈希表
 static STATUS _hash_table_destroy(IN hash_table *hs)
 {
-    unsigned int i = 0;
-    STATUS rv = 0;
-
     if(unlikely(!hs))
     {
         return ERR_BAD_PARAM;
     }
 
-    // 逐个销毁桶
-    for(i = 0; i < hs->bucket_count; ++ i)
-    {
-        rv = dlist_destroy((dlist*)(hs->bucket_list)[i]);
-        if(unlikely(rv != OK))
-        {
-            DBG("destroy bucket [%lu] fail", i);
-            return ERROR;
-        }
-    }
-
-    free(hs->bucket_list);
-    free(hs->mtx);
-    free(hs);
-
-    return OK;
+    return hs->ops->hash_table_destroy(hs);
 }
 
 // 检查数据是否存在表中
@@ -150,54 +128,132 @@ static bool _hash_table_contain(
     IN void *data
 )
 {
-    int hs_val = 0;
-    dlist *bucket = NULL;
-
-    if(unlikely(!hs || !data))
+    if(unlikely(!hs))
     {
         return false;
     }
 
-    // 计算哈希值
-    hs_val = (hs->hash(data) % hs->bucket_count);
-    bucket = (dlist*)hs->bucket_list[hs_val];
+    return hs->ops->hash_table_contain(hs, data);
+}
+
+// 批量检查键是否存在
+static STATUS _hash_table_contain_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found
+)
+{
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
 
-    return dlist_contain(bucket, data);
+    return hs->ops->hash_table_contain_batch(hs, keys, count, found);
 }
 
-// 加入哈希表
-static STATUS _hash_table_insert(
+// 批量查找键对应的值
+static STATUS _hash_table_get_batch(
     IN hash_table *hs,
-    IN void *data
+    IN void **keys,
+    IN unsigned int count,
+    OUT void **values
 )
 {
-    unsigned int hash_val = 0;
-    dlist *bucket = NULL;
-    STATUS ret = OK;
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return hs->ops->hash_table_get_batch(hs, keys, count, values);
+}
+
+// 批量加入
+static STATUS _hash_table_insert_batch(
+    IN hash_table *hs,
+    IN void **data,
+    IN unsigned int count,
+    OUT unsigned int *inserted
+)
+{
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return hs->ops->hash_table_insert_batch(hs, data, count, inserted);
+}
 
-    if(unlikely(!hs || !data))
+// 加入或替换键值对
+static STATUS _hash_table_put(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **old_value
+)
+{
+    if(unlikely(!hs))
     {
         return ERR_BAD_PARAM;
     }
 
-    // 计算hash
-    hash_val = hs->hash(data) % hs->bucket_count;
-    // 找到对应桶
-    bucket = (dlist*)hs->bucket_list[hash_val];
+    return hs->ops->hash_table_put(hs, key, value, old_value);
+}
 
-    if(true ==dlist_contain(bucket, data))
+// 查找键对应的值
+static void* _hash_table_get(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    if(unlikely(!hs))
     {
-        return ERR_HASH_TABLE_DATA_EXIST;
+        return NULL;
     }
 
-    // 尾插到桶中
-    ret = dlist_append_tail(bucket, data);
-    if(OK != ret)
+    return hs->ops->hash_table_get(hs, key);
+}
+
+// 键不存在时加入键值对
+static STATUS _hash_table_get_or_insert(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **result
+)
+{
+    if(unlikely(!hs))
     {
-        DBG("insert to dlist fail");
+        return ERR_BAD_PARAM;
     }
 
-    return ret;
+    return hs->ops->hash_table_get_or_insert(hs, key, value, result);
+}
+
+// 移除键并返回旧值
+static STATUS _hash_table_pop(
+    IN hash_table *hs,
+    IN void *key,
+    OUT void **old_value
+)
+{
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return hs->ops->hash_table_pop(hs, key, old_value);
+}
+
+// 以下集合操作把数据同时作为键和值，由键值操作实现
+
+// 加入哈希表
+static STATUS _hash_table_insert(
+    IN hash_table *hs,
+    IN void *data
+)
+{
+    return _hash_table_get_or_insert(hs, data, data, NULL);
 }
 
 // 移除出哈希表
@@ -206,18 +262,66 @@ static STATUS _hash_table_remove(
     IN void *data
 )
 {
-    unsigned int hv = 0;
-    dlist *bucket = NULL;
+    return _hash_table_pop(hs, data, NULL);
+}
+
+// 不存在时加入
+static STATUS _hash_table_insert_if_absent(
+    IN hash_table *hs,
+    IN void *data,
+    OUT void **existing
+)
+{
+    STATUS ret = _hash_table_get_or_insert(hs, data, data, existing);
+
+    // 新加入时existing置NULL，与已有数据区分
+    if(OK == ret && existing)
+    {
+        *existing = NULL;
+    }
+
+    return ret;
+}
+
+// 加入或替换
+static STATUS _hash_table_upsert(
+    IN hash_table *hs,
+    IN void *data,
+    OUT void **old
+)
+{
+    return _hash_table_put(hs, data, data, old);
+}
 
-    if(unlikely(!hs || !data))
+// 不存在时生成并加入
+static STATUS _hash_table_compute_if_absent(
+    IN hash_table *hs,
+    IN void *key,
+    IN hash_table_compute_func func,
+    IN void *ctx,
+    OUT void **result
+)
+{
+    if(unlikely(!hs))
     {
         return ERR_BAD_PARAM;
     }
 
-    hv = hs->hash(data) % hs->bucket_count;
-    bucket = (dlist*)hs->bucket_list[hv];
+    return hs->ops->hash_table_compute_if_absent(hs, key, func, ctx, result);
+}
+
+// 预留容量
+static STATUS _hash_table_reserve(
+    IN hash_table *hs,
+    IN unsigned int count
+)
+{
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
 
-    return dlist_remove_by_data(bucket, data);
+    return hs->ops->hash_table_reserve(hs, count);
 }
 
 // 获取哈希表元素总数
@@ -226,71 +330,201 @@ static STATUS _hash_table_get_size(
     OUT unsigned int *size
 )
 {
-    unsigned int bucket_size = 0;
-    unsigned int i = 0;
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return hs->ops->hash_table_get_size(hs, size);
+}
+
+// 获取统计信息
+static STATUS _hash_table_get_stats(
+    IN hash_table *hs,
+    OUT hash_table_stats *stats
+)
+{
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
 
-    if(unlikely(!hs || !size))
+    return hs->ops->hash_table_get_stats(hs, stats);
+}
+
+// 初始化迭代器
+static STATUS _hash_table_iter_init(
+    IN hash_table *hs,
+    OUT hash_table_iter *it
+)
+{
+    if(unlikely(!hs || !it))
     {
         return ERR_BAD_PARAM;
     }
 
-    *size = 0;
+    memset(it, 0, sizeof(hash_table_iter));
+    it->hs = hs;
 
-    HS_LOCK(hs);
+    return OK;
+}
 
-    for(; i < hs->bucket_count; ++ i)
+// 迭代器前进
+static bool _hash_table_iter_next(
+    IN hash_table_iter *it,
+    OUT void **key,
+    OUT void **value
+)
+{
+    if(unlikely(!it || !it->hs))
     {
-        if(OK != dlist_get_size((dlist*)hs->bucket_list[i], &bucket_size))
-        {
-            HS_UNLOCK(hs);
-            *size = 0;
-            return ERROR;
-        }
+        return false;
+    }
 
-        *size += bucket_size;
+    return it->hs->ops->hash_table_iter_next(it, key, value);
+}
+
+// 结束迭代
+static void _hash_table_iter_end(IN hash_table_iter *it)
+{
+    if(unlikely(!it || !it->hs))
+    {
+        return;
+    }
+
+    it->hs->ops->hash_table_iter_end(it);
+}
+
+// 遍历所有元素，即只有一个分片
+static STATUS _hash_table_foreach(
+    IN hash_table *hs,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    if(unlikely(!hs || !visit))
+    {
+        return ERR_BAD_PARAM;
     }
 
-    HS_UNLOCK(hs);
+    hs->ops->hash_table_foreach_part(hs, 0, 1, visit, ctx);
 
     return OK;
 }
 
+// 并行遍历的回调包装，检查停止标志
+static bool parallel_foreach_visit(
+    IN void *key,
+    IN void *value,
+    IN void *param
+)
+{
+    parallel_foreach_ctx *pctx = (parallel_foreach_ctx*)param;
+
+    if(atomic_load_explicit(&pctx->stop, memory_order_relaxed))
+    {
+        return false;
+    }
+    if(!pctx->visit(key, value, pctx->ctx))
+    {
+        atomic_store_explicit(&pctx->stop, true, memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+// 遍历领取到的分片[begin, end)
+static void parallel_foreach_range(
+    IN size_t begin,
+    IN size_t end,
+    IN void *param
+)
+{
+    parallel_foreach_ctx *pctx = (parallel_foreach_ctx*)param;
+
+    for(; begin < end && !atomic_load_explicit(&pctx->stop, memory_order_relaxed); ++ begin)
+    {
+        pctx->hs->ops->hash_table_foreach_part(pctx->hs, (unsigned int)begin, HASH_TABLE_FOREACH_PARTS,
+                                               parallel_foreach_visit, pctx);
+    }
+}
+
+// 使用线程池并行遍历
+static STATUS _hash_table_parallel_foreach(
+    IN hash_table *hs,
+    IN thread_pool_t *pool,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    parallel_foreach_ctx pctx;
+
+    if(unlikely(!hs || !visit))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    if(!pool)
+    {
+        return _hash_table_foreach(hs, visit, ctx);
+    }
+
+    pctx.hs = hs;
+    pctx.visit = visit;
+    pctx.ctx = ctx;
+    atomic_init(&pctx.stop, false);
+
+    // 每个分片一块，线程池中的线程和调用线程一起领取，队列满时剩余分片由调用线程完成
+    return thread_pool_parallel_for(pool, 0, HASH_TABLE_FOREACH_PARTS, 1, parallel_foreach_range, &pctx);
+}
+
 // 打印哈希表
 static void _hash_table_display(
     IN hash_table *hs
 )
 {
-    unsigned int i = 0;
-
     if(unlikely(!hs))
     {
         DBG("bad param");
         return;
     }
 
-    HS_LOCK(hs);
-
-    for(; i < hs->bucket_count; ++ i)
-    {
-        printf("bucket %d:\r\n", i);
-        dlist_display((dlist*)hs->bucket_list[i], DLIST_ORDER);
-    }
-
-    HS_UNLOCK(hs);
+    hs->ops->hash_table_display(hs);
 }
 
 /*
     Variables
 */
 
-// 哈希表操作变量
+// 哈希表操作变量，按表的引擎类型分发
 hash_table_ops hash_table_operations = {
     .hash_table_create = _hash_table_create,
+    .hash_table_create_ex = _hash_table_create_ex,
+    .hash_table_create_seeded = _hash_table_create_seeded,
+    .hash_table_freeze = _hash_table_freeze,
     .hash_table_destroy = _hash_table_destroy,
     .hash_table_insert = _hash_table_insert,
     .hash_table_remove = _hash_table_remove,
+    .hash_table_insert_if_absent = _hash_table_insert_if_absent,
+    .hash_table_upsert = _hash_table_upsert,
+    .hash_table_put = _hash_table_put,
+    .hash_table_get = _hash_table_get,
+    .hash_table_get_or_insert = _hash_table_get_or_insert,
+    .hash_table_pop = _hash_table_pop,
+    .hash_table_compute_if_absent = _hash_table_compute_if_absent,
     .hash_table_contain = _hash_table_contain,
+    .hash_table_contain_batch = _hash_table_contain_batch,
+    .hash_table_get_batch = _hash_table_get_batch,
+    .hash_table_insert_batch = _hash_table_insert_batch,
+    .hash_table_reserve = _hash_table_reserve,
     .hash_table_get_size = _hash_table_get_size,
+    .hash_table_get_stats = _hash_table_get_stats,
+    .hash_table_iter_init = _hash_table_iter_init,
+    .hash_table_iter_next = _hash_table_iter_next,
+    .hash_table_iter_end = _hash_table_iter_end,
+    .hash_table_foreach = _hash_table_foreach,
+    .hash_table_parallel_foreach = _hash_table_parallel_foreach,
     .hash_table_display = _hash_table_display,
 };
 
@@ -313,6 +547,639 @@ static bool int_cmp(void *d1, void *d2)
     return *(int*)d1 == *(int*)d2;
 }
 
+static unsigned int int_identity_hash(void *data)
+{
+    return (unsigned int)*((int*)data);
+}
+
+// 链地址法扩缩容测试，迁移过程中穿插增删查
+static void hash_table_resize_test()
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    static int a[2000];
+    int i = 0;
+    unsigned int size = 0;
+    hash_table_stats stats;
+
+    for(i = 0; i < 2000; ++ i)
+        a[i] = i;
+
+    hs = hash_table_create(2, int_identity_hash, int_cmp, int_display);
+    assert_non_null(hs);
+
+    for(i = 0; i < 2000; ++ i)
+    {
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+        assert_true(hash_table_contain(hs, &a[i / 2]));
+    }
+    assert_int_equal(ERR_HASH_TABLE_DATA_EXIST, hash_table_insert(hs, &a[1234]));
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(2000, size);
+
+    // 负载因子不超过1，桶数量为2的幂
+    assert_int_not_equal(OK, hash_table_get_stats(NULL, &stats));
+    assert_int_not_equal(OK, hash_table_get_stats(hs, NULL));
+    assert_int_equal(OK, hash_table_get_stats(hs, &stats));
+    assert_int_equal(2000, stats.size);
+    assert_true(stats.bucket_count >= 2000);
+    assert_true(stats.load_factor <= 1.0);
+    assert_int_equal(0, stats.bucket_count & (stats.bucket_count - 1));
+    assert_true(stats.max_chain >= 1 && stats.max_chain <= 8);
+
+    for(i = 0; i < 1990; ++ i)
+    {
+        assert_int_equal(OK, hash_table_remove(hs, &a[i]));
+        assert_false(hash_table_contain(hs, &a[i]));
+        assert_true(hash_table_contain(hs, &a[1990 + i % 10]));
+    }
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(10, size);
+
+    assert_int_not_equal(OK, hash_table_reserve(NULL, 100));
+    assert_int_not_equal(OK, hash_table_reserve(hs, 0));
+    assert_int_equal(OK, hash_table_reserve(hs, 4096));
+    for(i = 0; i < 1990; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    for(i = 0; i < 2000; ++ i)
+        assert_true(hash_table_contain(hs, &a[i]));
+
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+static int compute_calls = 0;
+
+// compute_if_absent测试回调，ctx为候选数据，NULL表示生成失败
+static void* int_compute(void *key, void *ctx)
+{
+    (void)key;
+    ++ compute_calls;
+    return ctx;
+}
+
+// 原子操作语义测试
+static void hash_table_atomic_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    int a[3] = {7, 7, 7};
+    int b = 8;
+    int c = 9;
+    void *ret = NULL;
+    unsigned int size = 0;
+
+    hs = hash_table_create_ex(type, 16, int_identity_hash, int_cmp, int_display);
+    assert_non_null(hs);
+
+    assert_int_not_equal(OK, hash_table_insert_if_absent(NULL, &a[0], &ret));
+    assert_int_not_equal(OK, hash_table_insert_if_absent(hs, NULL, &ret));
+    assert_int_not_equal(OK, hash_table_upsert(hs, NULL, &ret));
+    assert_int_not_equal(OK, hash_table_compute_if_absent(hs, &b, NULL, NULL, &ret));
+    assert_int_not_equal(OK, hash_table_compute_if_absent(hs, &b, int_compute, NULL, NULL));
+
+    // 不存在时加入，存在时返回表中的数据
+    assert_int_equal(OK, hash_table_insert_if_absent(hs, &a[0], &ret));
+    assert_null(ret);
+    assert_int_equal(ERR_HASH_TABLE_DATA_EXIST, hash_table_insert_if_absent(hs, &a[1], &ret));
+    assert_ptr_equal(&a[0], ret);
+    assert_int_equal(ERR_HASH_TABLE_DATA_EXIST, hash_table_insert_if_absent(hs, &a[1], NULL));
+
+    // 替换相等的数据，返回旧数据
+    assert_int_equal(OK, hash_table_upsert(hs, &a[1], &ret));
+    assert_ptr_equal(&a[0], ret);
+    assert_int_equal(ERR_HASH_TABLE_DATA_EXIST, hash_table_insert_if_absent(hs, &a[2], &ret));
+    assert_ptr_equal(&a[1], ret);
+    assert_int_equal(OK, hash_table_upsert(hs, &b, &ret));
+    assert_null(ret);
+
+    // 存在时不调用生成函数
+    compute_calls = 0;
+    assert_int_equal(OK, hash_table_compute_if_absent(hs, &a[2], int_compute, &a[2], &ret));
+    assert_ptr_equal(&a[1], ret);
+    assert_int_equal(0, compute_calls);
+    assert_int_equal(ERR_HASH_TABLE_COMPUTE_FAIL, hash_table_compute_if_absent(hs, &c, int_compute, NULL, &ret));
+    assert_null(ret);
+    assert_false(hash_table_contain(hs, &c));
+    assert_int_equal(OK, hash_table_compute_if_absent(hs, &c, int_compute, &c, &ret));
+    assert_ptr_equal(&c, ret);
+    assert_int_equal(2, compute_calls);
+    assert_true(hash_table_contain(hs, &c));
+
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(3, size);
+
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+// 键值对测试用的记录，键存放在记录内部
+typedef struct
+{
+    int id;
+    int score;
+}map_test_record;
+
+// 键值接口测试
+static void hash_table_map_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    static map_test_record recs[200];
+    map_test_record newer = {5, 500};
+    int key = 0;
+    int i = 0;
+    void *ret = NULL;
+    unsigned int size = 0;
+
+    for(i = 0; i < 200; ++ i)
+    {
+        recs[i].id = i;
+        recs[i].score = i * 10;
+    }
+
+    hs = hash_table_create_ex(type, 4, int_identity_hash, int_cmp, int_display);
+    assert_non_null(hs);
+
+    assert_int_not_equal(OK, hash_table_put(NULL, &recs[0].id, &recs[0], &ret));
+    assert_int_not_equal(OK, hash_table_put(hs, NULL, &recs[0], &ret));
+    assert_null(hash_table_get(NULL, &key));
+    assert_null(hash_table_get(hs, NULL));
+    assert_int_not_equal(OK, hash_table_get_or_insert(hs, NULL, &recs[0], &ret));
+    assert_int_not_equal(OK, hash_table_pop(hs, NULL, &ret));
+
+    // 插入过程中触发扩容，值始终跟随键
+    for(i = 0; i < 200; ++ i)
+    {
+        assert_int_equal(OK, hash_table_put(hs, &recs[i].id, &recs[i], &ret));
+        assert_null(ret);
+    }
+    for(i = 0; i < 200; ++ i)
+    {
+        key = i;
+        assert_ptr_equal(&recs[i], hash_table_get(hs, &key));
+    }
+    key = 200;
+    assert_null(hash_table_get(hs, &key));
+
+    // 替换时返回旧值，键一并替换为新记录中的键
+    assert_int_equal(OK, hash_table_put(hs, &newer.id, &newer, &ret));
+    assert_ptr_equal(&recs[5], ret);
+    recs[5].id = -1;
+    key = 5;
+    assert_ptr_equal(&newer, hash_table_get(hs, &key));
+
+    // 存在时返回表中的值，不存在时加入
+    assert_int_equal(ERR_HASH_TABLE_DATA_EXIST, hash_table_get_or_insert(hs, &key, &recs[6], &ret));
+    assert_ptr_equal(&newer, ret);
+    key = 300;
+    assert_int_equal(OK, hash_table_get_or_insert(hs, &key, NULL, &ret));
+    assert_null(ret);
+    assert_true(hash_table_contain(hs, &key));
+    assert_null(hash_table_get(hs, &key));
+
+    // 移除时返回旧值
+    assert_int_equal(OK, hash_table_pop(hs, &key, &ret));
+    assert_null(ret);
+    key = 5;
+    assert_int_equal(OK, hash_table_pop(hs, &key, &ret));
+    assert_ptr_equal(&newer, ret);
+    assert_int_equal(ERR_HASH_TABLE_DATA_NOT_EXIST, hash_table_pop(hs, &key, &ret));
+    assert_null(ret);
+    for(i = 0; i < 190; ++ i)
+    {
+        key = i;
+        if(5 == i)  continue;
+        assert_int_equal(OK, hash_table_pop(hs, &key, &ret));
+        assert_ptr_equal(&recs[i], ret);
+    }
+    for(i = 190; i < 200; ++ i)
+    {
+        key = i;
+        assert_ptr_equal(&recs[i], hash_table_get(hs, &key));
+    }
+
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(10, size);
+
+    recs[5].id = 5;
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+static int hash_calls = 0;
+static int cmp_calls = 0;
+
+static unsigned int counting_hash(void *data)
+{
+    ++ hash_calls;
+    return (unsigned int)*((int*)data);
+}
+
+static bool counting_cmp(void *d1, void *d2)
+{
+    ++ cmp_calls;
+    return int_cmp(d1, d2);
+}
+
+// 缓存哈希值测试：扩容时不重新计算哈希值，哈希值不同时不调用比较函数
+static void hash_table_cached_hash_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    static int a[1000];
+    int i = 0;
+
+    for(i = 0; i < 1000; ++ i)
+        a[i] = i;
+
+    hs = hash_table_create_ex(type, 1, counting_hash, counting_cmp, int_display);
+    assert_non_null(hs);
+
+    hash_calls = 0;
+    cmp_calls = 0;
+    for(i = 0; i < 1000; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    assert_int_equal(1000, hash_calls);
+    assert_int_equal(0, cmp_calls);
+
+    for(i = 0; i < 1000; ++ i)
+        assert_true(hash_table_contain(hs, &a[i]));
+    assert_int_equal(2000, hash_calls);
+    assert_int_equal(1000, cmp_calls);
+
+    for(i = 0; i < 1000; ++ i)
+        assert_int_equal(OK, hash_table_remove(hs, &a[i]));
+    assert_int_equal(3000, hash_calls);
+    assert_int_equal(2000, cmp_calls);
+
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+static void str_display(void *data)
+{
+    printf("%s", (char*)data);
+}
+
+// 内置哈希函数和带种子哈希表测试
+static void hash_table_seeded_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    static char strs[65][65];
+    static uint8_t bytes[256];
+    char probe[65];
+    int ints[3] = {1, 2, 1};
+    uint64_t seed = 0;
+    int i = 0;
+    int j = 0;
+
+    // 同一种子结果稳定，不同种子、不同长度结果不同
+    seed = hash_table_random_seed();
+    assert_int_not_equal(seed, hash_table_random_seed());
+    for(i = 0; i < 256; ++ i)
+        bytes[i] = (uint8_t)i;
+    for(i = 0; i <= 256; ++ i)
+    {
+        assert_true(hash_table_hash_bytes(bytes, i, seed) == hash_table_hash_bytes(bytes, i, seed));
+        for(j = 0; j < i; ++ j)
+            assert_true(hash_table_hash_bytes(bytes, i, seed) != hash_table_hash_bytes(bytes, j, seed));
+    }
+    assert_true(hash_table_hash_bytes(bytes, 100, seed) != hash_table_hash_bytes(bytes, 100, seed + 1));
+    assert_true(hash_table_hash_u64(0, seed) != hash_table_hash_u64(1, seed));
+    assert_true(hash_table_hash_int(&ints[0], seed) == hash_table_hash_int(&ints[2], seed));
+    assert_true(hash_table_hash_int(&ints[0], seed) != hash_table_hash_int(&ints[1], seed));
+    assert_true(hash_table_hash_ptr(&ints[0], seed) != hash_table_hash_ptr(&ints[2], seed));
+
+    assert_null(hash_table_create_seeded(type, 16, NULL, hash_table_cmp_str, str_display));
+    assert_null(hash_table_create_seeded((HASH_TABLE_TYPE)-1, 16, hash_table_hash_str, hash_table_cmp_str, str_display));
+
+    // 长度0~64的字符串，覆盖各个分支
+    hs = hash_table_create_seeded(type, 4, hash_table_hash_str, hash_table_cmp_str, str_display);
+    assert_non_null(hs);
+    for(i = 0; i <= 64; ++ i)
+    {
+        for(j = 0; j < i; ++ j)
+            strs[i][j] = (char)('a' + (i + j) % 26);
+        strs[i][i] = '\0';
+        assert_int_equal(OK, hash_table_insert(hs, strs[i]));
+    }
+    for(i = 0; i <= 64; ++ i)
+    {
+        strcpy(probe, strs[i]);
+        assert_ptr_equal(strs[i], hash_table_get(hs, probe));
+    }
+    assert_false(hash_table_contain(hs, "not exist"));
+    assert_return_code(OK, hash_table_destroy(hs));
+
+    hs = hash_table_create_seeded(type, 4, hash_table_hash_ptr, hash_table_cmp_ptr, NULL);
+    assert_non_null(hs);
+    assert_int_equal(OK, hash_table_put(hs, &ints[0], &ints[1], NULL));
+    assert_ptr_equal(&ints[1], hash_table_get(hs, &ints[0]));
+    assert_null(hash_table_get(hs, &ints[2]));
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+// 批量接口测试，数量不是每轮数量的整数倍，且包含重复和不存在的键
+static void hash_table_batch_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    static int a[1000];
+    static void *keys[1000];
+    static void *values[1000];
+    static bool found[1000];
+    int missing = 5000;
+    unsigned int inserted = 0;
+    unsigned int size = 0;
+    int i = 0;
+
+    for(i = 0; i < 1000; ++ i)
+    {
+        a[i] = i;
+        keys[i] = &a[i];
+    }
+
+    hs = hash_table_create_ex(type, 8, int_identity_hash, int_cmp, int_display);
+    assert_non_null(hs);
+
+    assert_int_not_equal(OK, hash_table_insert_batch(NULL, keys, 10, &inserted));
+    assert_int_not_equal(OK, hash_table_insert_batch(hs, NULL, 10, &inserted));
+    assert_int_not_equal(OK, hash_table_contain_batch(hs, keys, 10, NULL));
+    assert_int_not_equal(OK, hash_table_get_batch(hs, NULL, 10, values));
+
+    // 先加入偶数，再批量加入全部，偶数被跳过
+    for(i = 0; i < 1000; i += 2)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    assert_int_equal(OK, hash_table_insert_batch(hs, keys, 999, &inserted));
+    assert_int_equal(499, inserted);
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(999, size);
+
+    keys[998] = &missing;
+    keys[997] = NULL;
+    assert_int_equal(OK, hash_table_contain_batch(hs, keys, 1000, found));
+    assert_int_equal(OK, hash_table_get_batch(hs, keys, 1000, values));
+    for(i = 0; i < 997; ++ i)
+    {
+        assert_true(found[i]);
+        assert_ptr_equal(&a[i], values[i]);
+    }
+    assert_false(found[997]);
+    assert_null(values[997]);
+    assert_false(found[998]);
+    assert_null(values[998]);
+    assert_false(found[999]);
+    assert_null(values[999]);
+
+    // 含NULL时不加入任何数据
+    assert_int_equal(ERR_BAD_PARAM, hash_table_insert_batch(hs, keys, 1000, &inserted));
+    assert_int_equal(OK, hash_table_contain_batch(hs, keys, 0, found));
+
+    // 同一轮内重复的键只加入一次，键分散在不同段时结果不变
+    keys[0] = &missing;
+    keys[1] = &a[1];
+    keys[2] = &missing;
+    assert_int_equal(OK, hash_table_insert_batch(hs, keys, 3, &inserted));
+    assert_int_equal(1, inserted);
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(1000, size);
+
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+typedef struct
+{
+    atomic_int count;
+    atomic_long sum;
+    int limit;                  // 访问到该数量后停止，0表示不停止
+}iter_test_ctx;
+
+static bool iter_test_visit(void *key, void *value, void *param)
+{
+    iter_test_ctx *ctx = (iter_test_ctx*)param;
+    int n = atomic_fetch_add(&ctx->count, 1) + 1;
+
+    // 可能在线程池线程中调用，这里不做断言
+    atomic_fetch_add(&ctx->sum, (key == value) ? *(int*)key : -1000000);
+
+    return 0 == ctx->limit || n < ctx->limit;
+}
+
+// 迭代器和遍历测试，链地址法引擎在迁移中途遍历
+static void hash_table_iter_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    thread_pool_t *pool = NULL;
+    hash_table_iter it;
+    iter_test_ctx ctx;
+    static int a[1000];
+    void *key = NULL;
+    void *value = NULL;
+    long sum = 0;
+    int count = 0;
+    int i = 0;
+
+    for(i = 0; i < 1000; ++ i)
+        a[i] = i;
+
+    hs = hash_table_create_ex(type, 4, int_identity_hash, int_cmp, int_display);
+    assert_non_null(hs);
+
+    assert_int_not_equal(OK, hash_table_iter_init(NULL, &it));
+    assert_int_not_equal(OK, hash_table_iter_init(hs, NULL));
+    assert_int_not_equal(OK, hash_table_foreach(hs, NULL, NULL));
+    assert_int_not_equal(OK, hash_table_parallel_foreach(NULL, NULL, iter_test_visit, &ctx));
+
+    // 空表
+    assert_int_equal(OK, hash_table_iter_init(hs, &it));
+    assert_false(hash_table_iter_next(&it, &key, &value));
+    hash_table_iter_end(&it);
+
+    for(i = 0; i < 1000; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    assert_int_equal(OK, hash_table_reserve(hs, 5000));
+
+    assert_int_equal(OK, hash_table_iter_init(hs, &it));
+    while(hash_table_iter_next(&it, &key, &value))
+    {
+        assert_ptr_equal(key, value);
+        sum += *(int*)key;
+        ++ count;
+    }
+    hash_table_iter_end(&it);
+    assert_int_equal(1000, count);
+    assert_int_equal(999 * 1000 / 2, sum);
+
+    // 提前结束后锁已释放，可以继续修改
+    assert_int_equal(OK, hash_table_iter_init(hs, &it));
+    assert_true(hash_table_iter_next(&it, NULL, NULL));
+    hash_table_iter_end(&it);
+    assert_false(hash_table_iter_next(&it, NULL, NULL));
+    assert_int_equal(OK, hash_table_remove(hs, &a[0]));
+    assert_int_equal(OK, hash_table_insert(hs, &a[0]));
+
+    memset(&ctx, 0, sizeof(ctx));
+    assert_int_equal(OK, hash_table_foreach(hs, iter_test_visit, &ctx));
+    assert_int_equal(1000, ctx.count);
+    assert_int_equal(999 * 1000 / 2, ctx.sum);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.limit = 10;
+    assert_int_equal(OK, hash_table_foreach(hs, iter_test_visit, &ctx));
+    assert_int_equal(10, ctx.count);
+
+    // 并行遍历，线程池队列放不下所有分片时由调用线程完成
+    pool = thread_pool_create(4, 8);
+    assert_non_null(pool);
+
+    memset(&ctx, 0, sizeof(ctx));
+    assert_int_equal(OK, hash_table_parallel_foreach(hs, pool, iter_test_visit, &ctx));
+    assert_int_equal(1000, ctx.count);
+    assert_int_equal(999 * 1000 / 2, ctx.sum);
+
+    memset(&ctx, 0, sizeof(ctx));
+    assert_int_equal(OK, hash_table_parallel_foreach(hs, NULL, iter_test_visit, &ctx));
+    assert_int_equal(1000, ctx.count);
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.limit = 1;
+    assert_int_equal(OK, hash_table_parallel_foreach(hs, pool, iter_test_visit, &ctx));
+    assert_true(ctx.count >= 1 && ctx.count < 1000);
+
+    assert_return_code(OK, thread_pool_destroy(pool));
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+#define STRIPED_TEST_THREADS    (8)
+#define STRIPED_TEST_KEYS       (2000)
+
+typedef struct
+{
+    hash_table *hs;
+    int *keys;
+    int inserted;
+}striped_test_arg;
+
+// 所有线程插入同一批数据，每个数据只能有一个线程插入成功
+static void* striped_test_worker(void *param)
+{
+    striped_test_arg *arg = (striped_test_arg*)param;
+    int i = 0;
+
+    for(i = 0; i < STRIPED_TEST_KEYS; ++ i)
+    {
+        if(OK == hash_table_insert_if_absent(arg->hs, &arg->keys[i], NULL))
+        {
+            ++ arg->inserted;
+        }
+    }
+
+    return NULL;
+}
+
+// 链地址法节点复用测试：反复增删后内容正确，清空时保留的节点块可以继续切分，销毁时全部释放，由cmocka检查泄漏
+static void hash_table_compact_test(HASH_TABLE_TYPE type)
+{
+#if CMOCKA_TEST
+    static int keys[3000];
+    hash_table *hs = NULL;
+    unsigned int size = 0;
+    int round = 0;
+    int i = 0;
+
+    for(i = 0; i < 3000; ++ i)
+        keys[i] = i;
+
+    hs = hash_table_create_ex(type, 16, int_identity_hash, int_cmp, int_display);
+    assert_non_null(hs);
+
+    for(round = 0; round < 3; ++ round)
+    {
+        for(i = 0; i < 3000; ++ i)
+            assert_int_equal(OK, hash_table_insert(hs, &keys[i]));
+
+        // 删除一半后再插入，复用删除的节点
+        for(i = 0; i < 3000; i += 2)
+            assert_int_equal(OK, hash_table_remove(hs, &keys[i]));
+        for(i = 0; i < 3000; i += 2)
+            assert_false(hash_table_contain(hs, &keys[i]));
+        for(i = 0; i < 3000; i += 2)
+            assert_int_equal(OK, hash_table_insert(hs, &keys[i]));
+
+        for(i = 0; i < 3000; ++ i)
+            assert_ptr_equal(&keys[i], hash_table_get(hs, &keys[i]));
+        assert_int_equal(OK, hash_table_get_size(hs, &size));
+        assert_int_equal(3000, size);
+
+        // 最后一轮不清空，销毁时释放仍在使用的节点块
+        if(round < 2)
+        {
+            for(i = 0; i < 3000; ++ i)
+                assert_int_equal(OK, hash_table_remove(hs, &keys[i]));
+            assert_int_equal(OK, hash_table_get_size(hs, &size));
+            assert_int_equal(0, size);
+
+            // 在空和一个元素之间反复变化，使用保留的节点块
+            for(i = 0; i < 100; ++ i)
+            {
+                assert_int_equal(OK, hash_table_insert(hs, &keys[i]));
+                assert_ptr_equal(&keys[i], hash_table_get(hs, &keys[i]));
+                assert_int_equal(OK, hash_table_remove(hs, &keys[i]));
+            }
+        }
+    }
+
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
+// 分段锁并发测试
+static void hash_table_striped_test()
+{
+#if CMOCKA_TEST
+    static int keys[STRIPED_TEST_KEYS];
+    striped_test_arg args[STRIPED_TEST_THREADS];
+    pthread_t threads[STRIPED_TEST_THREADS];
+    hash_table *hs = NULL;
+    unsigned int size = 0;
+    int total = 0;
+    int i = 0;
+
+    for(i = 0; i < STRIPED_TEST_KEYS; ++ i)
+        keys[i] = i;
+
+    hs = hash_table_create_ex(HASH_TABLE_STRIPED, 1, int_identity_hash, int_cmp, int_display);
+    assert_non_null(hs);
+
+    for(i = 0; i < STRIPED_TEST_THREADS; ++ i)
+    {
+        args[i].hs = hs;
+        args[i].keys = keys;
+        args[i].inserted = 0;
+        assert_int_equal(0, pthread_create(&threads[i], NULL, striped_test_worker, &args[i]));
+    }
+    for(i = 0; i < STRIPED_TEST_THREADS; ++ i)
+    {
+        pthread_join(threads[i], NULL);
+        total += args[i].inserted;
+    }
+
+    assert_int_equal(STRIPED_TEST_KEYS, total);
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(STRIPED_TEST_KEYS, size);
+    for(i = 0; i < STRIPED_TEST_KEYS; ++ i)
+        assert_true(hash_table_contain(hs, &keys[i]));
+
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+
 void hash_table_test()
 {
 #if CMOCKA_TEST
@@ -372,6 +1239,29 @@ void hash_table_test()
 
     assert_int_not_equal(OK, hash_table_destroy(NULL));
     assert_return_code(OK, hash_table_destroy(hs));
+
+    hash_table_resize_test();
+    hash_table_atomic_test(HASH_TABLE_CHAIN);
+    hash_table_atomic_test(HASH_TABLE_OPEN_ADDR);
+    hash_table_atomic_test(HASH_TABLE_STRIPED);
+    hash_table_map_test(HASH_TABLE_CHAIN);
+    hash_table_map_test(HASH_TABLE_OPEN_ADDR);
+    hash_table_map_test(HASH_TABLE_STRIPED);
+    hash_table_cached_hash_test(HASH_TABLE_CHAIN);
+    hash_table_cached_hash_test(HASH_TABLE_OPEN_ADDR);
+    hash_table_cached_hash_test(HASH_TABLE_STRIPED);
+    hash_table_seeded_test(HASH_TABLE_CHAIN);
+    hash_table_seeded_test(HASH_TABLE_OPEN_ADDR);
+    hash_table_seeded_test(HASH_TABLE_STRIPED);
+    hash_table_batch_test(HASH_TABLE_CHAIN);
+    hash_table_batch_test(HASH_TABLE_OPEN_ADDR);
+    hash_table_batch_test(HASH_TABLE_STRIPED);
+    hash_table_iter_test(HASH_TABLE_CHAIN);
+    hash_table_iter_test(HASH_TABLE_OPEN_ADDR);
+    hash_table_iter_test(HASH_TABLE_STRIPED);
+    hash_table_compact_test(HASH_TABLE_CHAIN);
+    hash_table_compact_test(HASH_TABLE_STRIPED);
+    hash_table_striped_test();
 #endif
 }
 #endif
\ No newline at end of file
@@ -6,35 +6,119 @@
 */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "dlist/dlist.h"
 
+/*
+    Defines
+*/
+
+// 分段锁模式的段数量，必须是2的幂
+#define HASH_TABLE_STRIPE_COUNT     (64)
+// 并行遍历的分片数量，必须是2的幂且不超过128
+#define HASH_TABLE_FOREACH_PARTS    (32)
+
 /*
     typedefs
 */
 
 // 哈希函数指针
 typedef unsigned int (*hash_func)(void *data);
+// 带种子的哈希函数指针，seed为哈希表创建时生成的随机种子
+typedef uint64_t (*hash_table_seeded_func)(void *key, uint64_t seed);
 // 打印节点函数指针
 typedef dlist_show_func hash_table_show_func;
 // 数据比较函数指针
 typedef bool (*cmp_func)(void *d1, void *d2);
+// 按需生成数据的函数指针，返回与key相等且哈希值相同的新数据，失败返回NULL
+typedef void* (*hash_table_compute_func)(void *key, void *ctx);
+// 遍历回调，返回false时停止遍历
+typedef bool (*hash_table_visit_func)(void *key, void *value, void *ctx);
 // 哈希表声明，隐藏成员
 typedef struct hash_table hash_table;
-// 哈希表操作集合
+// 线程池声明，见thread_pool/thread_pool.h
+typedef struct thread_pool_t thread_pool_t;
+// 哈希表引擎类型
+typedef enum
+{
+    HASH_TABLE_CHAIN,       // 链地址法，每个桶一个单链表（默认）
+    HASH_TABLE_OPEN_ADDR,   // 开放寻址法，控制字节+16路分组探测
+    HASH_TABLE_STRIPED,     // 链地址法，分为HASH_TABLE_STRIPE_COUNT个独立加锁的段
+}HASH_TABLE_TYPE;
+// 哈希表统计信息
+typedef struct
+{
+    unsigned int size;          // 元素数量
+    unsigned int bucket_count;  // 桶数量，开放寻址引擎为槽数量
+    double load_factor;         // 负载因子，size / bucket_count
+    unsigned int max_chain;     // 最长链的节点数，开放寻址引擎为最长探测组数
+}hash_table_stats;
+// 迭代器，成员由引擎维护，调用者不要直接访问
 typedef struct
+{
+    hash_table *hs;             // 所属哈希表
+    unsigned int segment;       // 当前段
+    unsigned int index;         // 段内的下一个桶或槽
+    void *node;                 // 链地址法引擎中下一个待返回的节点
+    bool locked;                // 是否持有当前段的读锁
+}hash_table_iter;
+// 哈希表操作集合
+typedef struct hash_table_ops
 {
     // 创建哈希表
     hash_table* (*hash_table_create)(unsigned int, hash_func, cmp_func, hash_table_show_func);
+    // 创建指定引擎的哈希表
+    hash_table* (*hash_table_create_ex)(HASH_TABLE_TYPE, unsigned int, hash_func, cmp_func, hash_table_show_func);
+    // 创建使用带种子哈希函数的哈希表
+    hash_table* (*hash_table_create_seeded)(HASH_TABLE_TYPE, unsigned int, hash_table_seeded_func, cmp_func, hash_table_show_func);
+    // 转换为只读的完美哈希表
+    hash_table* (*hash_table_freeze)(hash_table*);
     // 销毁哈希表
     STATUS (*hash_table_destroy)(hash_table*);
     // 加入哈希表
     STATUS (*hash_table_insert)(hash_table*, void*);
     // 移除哈希表
     STATUS (*hash_table_remove)(hash_table*, void*);
+    // 不存在时加入，存在时返回已有数据
+    STATUS (*hash_table_insert_if_absent)(hash_table*, void*, void**);
+    // 加入或替换，返回被替换的数据
+    STATUS (*hash_table_upsert)(hash_table*, void*, void**);
+    // 加入或替换键值对，返回被替换的值
+    STATUS (*hash_table_put)(hash_table*, void*, void*, void**);
+    // 查找键，返回对应的值
+    void* (*hash_table_get)(hash_table*, void*);
+    // 键不存在时加入键值对，返回表中的值
+    STATUS (*hash_table_get_or_insert)(hash_table*, void*, void*, void**);
+    // 移除键，返回被移除的值
+    STATUS (*hash_table_pop)(hash_table*, void*, void**);
+    // 不存在时调用函数生成数据并加入，返回表中的数据
+    STATUS (*hash_table_compute_if_absent)(hash_table*, void*, hash_table_compute_func, void*, void**);
     // 检查哈希表是否存在元素
     bool (*hash_table_contain)(hash_table*, void*);
+    // 批量检查键是否存在
+    STATUS (*hash_table_contain_batch)(hash_table*, void**, unsigned int, bool*);
+    // 批量查找键对应的值
+    STATUS (*hash_table_get_batch)(hash_table*, void**, unsigned int, void**);
+    // 批量加入
+    STATUS (*hash_table_insert_batch)(hash_table*, void**, unsigned int, unsigned int*);
+    // 预留容量
+    STATUS (*hash_table_reserve)(hash_table*, unsigned int);
     // 获取哈希表元素数量
     STATUS (*hash_table_get_size)(hash_table*, unsigned int*);
+    // 获取统计信息
+    STATUS (*hash_table_get_stats)(hash_table*, hash_table_stats*);
+    // 初始化迭代器
+    STATUS (*hash_table_iter_init)(hash_table*, hash_table_iter*);
+    // 迭代器前进，返回下一个键值对
+    bool (*hash_table_iter_next)(hash_table_iter*, void**, void**);
+    // 结束迭代
+    void (*hash_table_iter_end)(hash_table_iter*);
+    // 遍历所有元素
+    STATUS (*hash_table_foreach)(hash_table*, hash_table_visit_func, void*);
+    // 使用线程池并行遍历所有元素
+    STATUS (*hash_table_parallel_foreach)(hash_table*, thread_pool_t*, hash_table_visit_func, void*);
+    // 遍历哈希值低位等于part的元素，parts为2的幂，返回false表示被回调停止。引擎内部使用
+    bool (*hash_table_foreach_part)(hash_table*, unsigned int, unsigned int, hash_table_visit_func, void*);
     // 打印哈希表
     void (*hash_table_display)(hash_table*);
 }hash_table_ops;
@@ -49,6 +133,24 @@ extern hash_table_ops hash_table_operations;
     Functions
 */
 
+// 内置哈希函数，算法为wyhash，见hash_table_hash.c
+// 字节串哈希
+uint64_t hash_table_hash_bytes(const void *data, size_t len, uint64_t seed);
+// 64位整数哈希
+uint64_t hash_table_hash_u64(uint64_t v, uint64_t seed);
+// 键指向int
+uint64_t hash_table_hash_int(void *key, uint64_t seed);
+// 键本身即指针，按地址哈希
+uint64_t hash_table_hash_ptr(void *key, uint64_t seed);
+// 键指向'\0'结尾的字符串
+uint64_t hash_table_hash_str(void *key, uint64_t seed);
+// 与内置哈希函数配套的比较函数
+bool hash_table_cmp_int(void *d1, void *d2);
+bool hash_table_cmp_ptr(void *d1, void *d2);
+bool hash_table_cmp_str(void *d1, void *d2);
+// 生成随机种子，每次调用结果不同
+uint64_t hash_table_random_seed(void);
+
 // 创建哈希表
 static inline hash_table* hash_table_create(
     IN unsigned int bucket_size,
@@ -60,6 +162,39 @@ static inline hash_table* hash_table_create(
     return hash_table_operations.hash_table_create(bucket_size, hash, cmp, show);
 }
 
+// 创建指定引擎的哈希表，bucket_size对开放寻址引擎表示预期容量
+static inline hash_table* hash_table_create_ex(
+    IN HASH_TABLE_TYPE type,
+    IN unsigned int bucket_size,
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    return hash_table_operations.hash_table_create_ex(type, bucket_size, hash, cmp, show);
+}
+
+// 创建使用带种子哈希函数的哈希表，每个表创建时生成随机种子，
+// 相同的键在不同的表中哈希值不同，难以构造出大量冲突的输入
+static inline hash_table* hash_table_create_seeded(
+    IN HASH_TABLE_TYPE type,
+    IN unsigned int bucket_size,
+    IN hash_table_seeded_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    return hash_table_operations.hash_table_create_seeded(type, bucket_size, hash, cmp, show);
+}
+
+// 把填充好的哈希表转换为只读的最小完美哈希表，返回新表，原表不变，键和值与原表共享。
+// 新表查找只访问一个槽且不加锁，修改操作返回ERR_HASH_TABLE_FROZEN，用hash_table_destroy销毁
+// 没有种子的表按用户的32位哈希值区分键，哈希值相同的键在溢出区中逐个比较，冻结前应使用带种子或分布均匀的哈希函数
+static inline hash_table* hash_table_freeze(IN hash_table *hs)
+{
+    return hash_table_operations.hash_table_freeze(hs);
+}
+
 // 销毁哈希表
 static inline STATUS hash_table_destroy(IN hash_table *hs)
 {
@@ -84,6 +219,82 @@ static inline STATUS hash_table_remove(
     return hash_table_operations.hash_table_remove(hs, data);
 }
 
+// 原子地检查并加入：不存在时加入并返回OK，existing置NULL；
+// 存在时返回ERR_HASH_TABLE_DATA_EXIST，existing返回表中已有的数据。existing可以为NULL
+static inline STATUS hash_table_insert_if_absent(
+    IN hash_table *hs,
+    IN void *data,
+    OUT void **existing
+)
+{
+    return hash_table_operations.hash_table_insert_if_absent(hs, data, existing);
+}
+
+// 原子地加入或替换相等的数据，old返回被替换的数据，原先不存在时置NULL。old可以为NULL
+static inline STATUS hash_table_upsert(
+    IN hash_table *hs,
+    IN void *data,
+    OUT void **old
+)
+{
+    return hash_table_operations.hash_table_upsert(hs, data, old);
+}
+
+// 原子地查找key，不存在时调用func(key, ctx)生成数据并加入，result返回表中的数据
+// func在持锁状态下调用，不能再访问同一个哈希表
+static inline STATUS hash_table_compute_if_absent(
+    IN hash_table *hs,
+    IN void *key,
+    IN hash_table_compute_func func,
+    IN void *ctx,
+    OUT void **result
+)
+{
+    return hash_table_operations.hash_table_compute_if_absent(hs, key, func, ctx, result);
+}
+
+// 加入或替换键值对，键已存在时键和值一并替换，old_value返回旧值，原先不存在时置NULL。old_value可以为NULL
+static inline STATUS hash_table_put(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **old_value
+)
+{
+    return hash_table_operations.hash_table_put(hs, key, value, old_value);
+}
+
+// 查找键，返回对应的值，不存在时返回NULL。值本身可以为NULL，需要区分时使用hash_table_contain
+static inline void* hash_table_get(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    return hash_table_operations.hash_table_get(hs, key);
+}
+
+// 原子地查找键，不存在时加入键值对并返回OK；存在时返回ERR_HASH_TABLE_DATA_EXIST。
+// 两种情况下result都返回表中的值，result可以为NULL
+static inline STATUS hash_table_get_or_insert(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **result
+)
+{
+    return hash_table_operations.hash_table_get_or_insert(hs, key, value, result);
+}
+
+// 移除键，old_value返回被移除的值，不存在时返回ERR_HASH_TABLE_DATA_NOT_EXIST。old_value可以为NULL
+static inline STATUS hash_table_pop(
+    IN hash_table *hs,
+    IN void *key,
+    OUT void **old_value
+)
+{
+    return hash_table_operations.hash_table_pop(hs, key, old_value);
+}
+
 // 检查数据是否存在
 static inline bool hash_table_contain(
     IN hash_table *hs,
@@ -93,7 +304,51 @@ static inline bool hash_table_contain(
     return hash_table_operations.hash_table_contain(hs, data);
 }
 
-// 获取哈希表元素数量
+// 批量检查键是否存在，found[i]对应keys[i]。先计算所有键的哈希值并预取桶，再逐个查找，
+// 多个键的缓存缺失可以重叠，适合一次查询几十到上千个键
+static inline STATUS hash_table_contain_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found
+)
+{
+    return hash_table_operations.hash_table_contain_batch(hs, keys, count, found);
+}
+
+// 批量查找键对应的值，values[i]对应keys[i]，不存在时为NULL
+static inline STATUS hash_table_get_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT void **values
+)
+{
+    return hash_table_operations.hash_table_get_batch(hs, keys, count, values);
+}
+
+// 批量加入，已存在的数据跳过，inserted返回新加入的数量，可以为NULL。
+// 内存不足时停止并返回错误，此前加入的数据保留在表中
+static inline STATUS hash_table_insert_batch(
+    IN hash_table *hs,
+    IN void **data,
+    IN unsigned int count,
+    OUT unsigned int *inserted
+)
+{
+    return hash_table_operations.hash_table_insert_batch(hs, data, count, inserted);
+}
+
+// 预留容量，保证容纳count个元素前不再扩容
+static inline STATUS hash_table_reserve(
+    IN hash_table *hs,
+    IN unsigned int count
+)
+{
+    return hash_table_operations.hash_table_reserve(hs, count);
+}
+
+// 获取哈希表元素数量，O(1)且不加锁，并发修改时返回近似值
 static inline STATUS hash_table_get_size(
     IN hash_table *hs,
     OUT unsigned int *size
@@ -102,6 +357,68 @@ static inline STATUS hash_table_get_size(
     return hash_table_operations.hash_table_get_size(hs, size);
 }
 
+// 获取统计信息，最长链需要遍历桶数组，适合诊断而非频繁轮询
+static inline STATUS hash_table_get_stats(
+    IN hash_table *hs,
+    OUT hash_table_stats *stats
+)
+{
+    return hash_table_operations.hash_table_get_stats(hs, stats);
+}
+
+// 初始化迭代器。迭代期间持有当前段的读锁：其他线程的查找不受影响，对该段的修改会阻塞到
+// 迭代离开该段，因此每个段内的元素恰好访问一次；尚未访问的段可能反映迭代开始后的修改。
+// 迭代线程在迭代期间不能修改该表；提前结束时必须调用hash_table_iter_end释放锁
+static inline STATUS hash_table_iter_init(
+    IN hash_table *hs,
+    OUT hash_table_iter *it
+)
+{
+    return hash_table_operations.hash_table_iter_init(hs, it);
+}
+
+// 迭代器前进，key和value返回下一个键值对，可以为NULL。遍历结束时返回false并自动释放锁
+static inline bool hash_table_iter_next(
+    IN hash_table_iter *it,
+    OUT void **key,
+    OUT void **value
+)
+{
+    return hash_table_operations.hash_table_iter_next(it, key, value);
+}
+
+// 结束迭代，释放持有的锁，遍历结束后调用也是安全的
+static inline void hash_table_iter_end(
+    IN hash_table_iter *it
+)
+{
+    hash_table_operations.hash_table_iter_end(it);
+}
+
+// 遍历所有元素，visit返回false时停止。回调在持有读锁时调用，不能修改该表
+static inline STATUS hash_table_foreach(
+    IN hash_table *hs,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    return hash_table_operations.hash_table_foreach(hs, visit, ctx);
+}
+
+// 使用线程池并行遍历所有元素：按哈希值低位分为HASH_TABLE_FOREACH_PARTS个分片，线程池中的线程和
+// 调用线程一起领取分片，调用线程等待全部分片结束后返回。visit会被多个线程同时调用，
+// 任一回调返回false时尽快停止其余分片。pool为NULL时在调用线程中遍历。
+// 调用线程只等待其他线程正在遍历的分片，可以在同一线程池的任务中调用
+static inline STATUS hash_table_parallel_foreach(
+    IN hash_table *hs,
+    IN thread_pool_t *pool,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    return hash_table_operations.hash_table_parallel_foreach(hs, pool, visit, ctx);
+}
+
 // 打印哈希表
 static inline void hash_table_display(
     IN hash_table* hs
@@ -112,6 +429,8 @@ static inline void hash_table_display(
 
 #if HASH_TABLE_TEST
 void hash_table_test();
+void hash_table_oa_test();
+void hash_table_frozen_test();
 #endif
 
 #endif
\ No newline at end of file
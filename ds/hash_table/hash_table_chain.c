@@ -0,0 +1,1431 @@
+/*
+    Include files
+*/
+
+#define _POSIX_C_SOURCE 200112L     // pthread_rwlock_t
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "hash_table_engine.h"
+
+/*
+    Defines
+*/
+
+#define CHAIN_LOAD_MAX      (1)             // 平均每个桶超过该数量时扩容
+#define CHAIN_SHRINK_DIV    (8)             // 元素数量低于桶数量的1/8时缩容
+#define CHAIN_REHASH_STEP   (4)             // 每次增删最多迁移的非空桶数量
+#define CHAIN_BUCKET_MAX    (0x40000000u)   // 每段最大桶数量，桶数量均为2的幂
+#define CHAIN_CACHE_LINE    (64)            // 缓存行大小，段按缓存行对齐
+#define CHAIN_BATCH         (16)            // 批量操作每轮处理的键数量
+#define CHAIN_SLAB_MIN      (16)            // 段内第一个节点块的节点数量
+#define CHAIN_SLAB_MAX      (1024)          // 节点块逐次翻倍，最多这么多个节点
+
+#define SEG_RLOCK(seg)      pthread_rwlock_rdlock(&(seg)->lock)
+#define SEG_WLOCK(seg)      pthread_rwlock_wrlock(&(seg)->lock)
+#define SEG_UNLOCK(seg)     pthread_rwlock_unlock(&(seg)->lock)
+
+// 段内元素计数，只在写锁内修改，因此用load+store代替原子加减；读取不需要加锁
+#define SEG_COUNT(seg)          atomic_load_explicit(&(seg)->count, memory_order_relaxed)
+#define SEG_COUNT_ADD(seg, n)   atomic_store_explicit(&(seg)->count, SEG_COUNT(seg) + (n), memory_order_relaxed)
+
+/*
+    typedefs
+*/
+
+// 桶内节点，键和值存放在一起，一次查找即可取到值
+typedef struct chain_node
+{
+    struct chain_node *next;    // 桶内下一个节点
+    void *key;                  // 键，用于计算哈希值和比较
+    void *value;                // 值，集合用法中与键相同
+    unsigned int hash;          // 键的完整哈希值，比较前先比它，迁移时直接复用
+}chain_node;
+
+// 节点块，段内的节点从块中切分，不再逐个malloc
+typedef struct chain_slab
+{
+    struct chain_slab *next;    // 上一个申请的块
+    unsigned int capacity;      // 块内节点数量
+    chain_node nodes[];         // 节点数组
+}chain_slab;
+
+// 段，拥有独立的锁、桶数组和迁移状态，段之间互不干扰
+typedef struct
+{
+    _Alignas(CHAIN_CACHE_LINE)
+    pthread_rwlock_t lock;      // 段锁，查找共享，增删和迁移独占
+
+    chain_node **bucket_list;   // 桶数组，每个桶是一个单链表，NULL表示空桶
+    unsigned int bucket_count;  // 桶的数量
+    unsigned int min_bucket_count;  // 缩容下限，创建时的桶数量或reserve的数量
+
+    chain_node **rehash_list;   // 迁移目标桶数组，NULL表示未在迁移
+    unsigned int rehash_count;  // 迁移目标桶数量
+    unsigned int rehash_idx;    // bucket_list中下一个待迁移的桶，之前的桶均已迁移
+
+    atomic_uint count;          // 段内元素数量，用于计算负载因子，各段的计数即元素总数的分片
+
+    chain_node **inline_list;   // 创建时随表一起申请的桶数组，不能单独释放
+    chain_slab *slab;           // 节点块链表，头部为最新的块
+    unsigned int slab_used;     // 最新的块中已切分的节点数量
+    chain_node *free_nodes;     // 删除后可复用的节点，通过next串联
+}chain_segment;
+
+// 链地址法哈希表结构
+typedef struct
+{
+    hash_table base;            // 公共头部
+
+    chain_segment *segments;    // 段数组，按缓存行对齐，避免不同段的锁伪共享，与表头位于同一块内存
+    unsigned int segment_count; // 段数量，2的幂
+    unsigned int segment_shift; // 选段时哈希值右移的位数
+}chain_hash_table;
+
+/*
+    Functions
+*/
+
+// 计算键的哈希值，再经过murmur3的fmix32混淆，桶数量为2的幂时低位也分布均匀
+static inline unsigned int chain_hash(
+    IN chain_hash_table *ht,
+    IN void *key
+)
+{
+    unsigned int h = hash_table_hash(&ht->base, key);
+
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+// 不小于n的最小2的幂，n不超过CHAIN_BUCKET_MAX
+static inline unsigned int chain_pow2_ceil(IN unsigned int n)
+{
+    unsigned int p = 1;
+
+    while(p < n)
+    {
+        p <<= 1;
+    }
+
+    return p;
+}
+
+// 根据哈希值选段，使用乘法哈希的高位，与段内取模用到的低位相互独立
+static inline chain_segment* chain_segment_of(
+    IN chain_hash_table *ht,
+    IN unsigned int hash_val
+)
+{
+    uint64_t h = (uint32_t)(hash_val * 0x9E3779B9u);
+    return &ht->segments[h >> ht->segment_shift];
+}
+
+// 申请桶数组，桶初始为空
+static chain_node** chain_bucket_list_alloc(IN unsigned int bucket_count)
+{
+    chain_node **list = (chain_node**)malloc(sizeof(chain_node*) * bucket_count);
+    if(likely(list))
+    {
+        memset(list, 0, sizeof(chain_node*) * bucket_count);
+    }
+    return list;
+}
+
+// 销毁桶数组，节点属于段的节点块，不在这里释放
+static inline void chain_bucket_list_free(
+    IN chain_segment *seg,
+    IN chain_node **list
+)
+{
+    if(list != seg->inline_list)
+    {
+        free(list);
+    }
+}
+
+// 从段的节点块申请节点：优先复用删除的节点，其次从最新的块切分，块用完时申请一个两倍大的块，调用者持有写锁
+static chain_node* chain_node_alloc(IN chain_segment *seg)
+{
+    chain_node *node = seg->free_nodes;
+    chain_slab *slab = NULL;
+    unsigned int capacity = CHAIN_SLAB_MIN;
+
+    if(node)
+    {
+        seg->free_nodes = node->next;
+        return node;
+    }
+
+    if(!seg->slab || seg->slab_used == seg->slab->capacity)
+    {
+        if(seg->slab)
+        {
+            capacity = (seg->slab->capacity < CHAIN_SLAB_MAX) ? seg->slab->capacity * 2 : CHAIN_SLAB_MAX;
+        }
+
+        slab = (chain_slab*)malloc(sizeof(chain_slab) + sizeof(chain_node) * capacity);
+        if(unlikely(!slab))
+        {
+            return NULL;
+        }
+        slab->next = seg->slab;
+        slab->capacity = capacity;
+        seg->slab = slab;
+        seg->slab_used = 0;
+    }
+
+    return &seg->slab->nodes[seg->slab_used ++];
+}
+
+// 释放段内全部节点块
+static void chain_slab_release(IN chain_segment *seg)
+{
+    chain_slab *slab = seg->slab;
+    chain_slab *next = NULL;
+
+    for(; slab; slab = next)
+    {
+        next = slab->next;
+        free(slab);
+    }
+
+    seg->slab = NULL;
+    seg->slab_used = 0;
+    seg->free_nodes = NULL;
+}
+
+// 段内没有元素时只保留最新（也是最大）的节点块，从头重新切分；较早的块释放，
+// 表在空和少量元素之间反复变化时不会反复申请和释放节点块
+static void chain_slab_trim(IN chain_segment *seg)
+{
+    chain_slab *slab = seg->slab->next;
+    chain_slab *next = NULL;
+
+    for(; slab; slab = next)
+    {
+        next = slab->next;
+        free(slab);
+    }
+
+    seg->slab->next = NULL;
+    seg->slab_used = 0;
+    seg->free_nodes = NULL;
+}
+
+// 归还节点，段内没有元素时收缩节点块，调用者持有写锁
+static inline void chain_node_free(
+    IN chain_segment *seg,
+    IN chain_node *node
+)
+{
+    if(0 == SEG_COUNT(seg))
+    {
+        chain_slab_trim(seg);
+        return;
+    }
+
+    node->next = seg->free_nodes;
+    seg->free_nodes = node;
+}
+
+// 定位哈希值所在的桶，旧数组中已迁移的部分到目标数组中查找，调用者持有段锁
+static chain_node** chain_bucket_locate(
+    IN chain_segment *seg,
+    IN unsigned int hash_val
+)
+{
+    unsigned int idx = hash_val & (seg->bucket_count - 1);
+
+    if(seg->rehash_list && idx < seg->rehash_idx)
+    {
+        return &seg->rehash_list[hash_val & (seg->rehash_count - 1)];
+    }
+
+    return &seg->bucket_list[idx];
+}
+
+// 开始迁移到new_count个桶，调用者持有写锁
+static STATUS chain_rehash_start(
+    IN chain_segment *seg,
+    IN unsigned int new_count
+)
+{
+    if(seg->rehash_list || new_count == seg->bucket_count)
+    {
+        return OK;
+    }
+
+    seg->rehash_list = chain_bucket_list_alloc(new_count);
+    if(unlikely(!seg->rehash_list))
+    {
+        DBG("malloc space of %u buckets fail", new_count);
+        return ERR_NO_MEMORY;
+    }
+
+    seg->rehash_count = new_count;
+    seg->rehash_idx = 0;
+
+    DBG("rehash %u -> %u buckets", seg->bucket_count, new_count);
+
+    return OK;
+}
+
+// 迁移一个旧桶的全部节点，只修改链接，不申请内存也不重新计算哈希值，调用者持有写锁
+static void chain_rehash_bucket(
+    IN chain_segment *seg,
+    IN chain_node *node
+)
+{
+    chain_node *next = NULL;
+    chain_node **bucket = NULL;
+
+    for(; node; node = next)
+    {
+        next = node->next;
+        bucket = &seg->rehash_list[node->hash & (seg->rehash_count - 1)];
+        node->next = *bucket;
+        *bucket = node;
+    }
+}
+
+// 增量迁移，最多迁移steps个非空桶，全部迁移完成后切换到目标数组，调用者持有写锁
+static void chain_rehash_step(
+    IN chain_segment *seg,
+    IN unsigned int steps
+)
+{
+    unsigned int empty_visits = steps * 10;
+    chain_node *node = NULL;
+
+    while(seg->rehash_list && seg->rehash_idx < seg->bucket_count)
+    {
+        node = seg->bucket_list[seg->rehash_idx];
+        if(node)
+        {
+            chain_rehash_bucket(seg, node);
+            seg->bucket_list[seg->rehash_idx] = NULL;
+        }
+        ++ seg->rehash_idx;
+
+        // 空桶不计入迁移步数，但限制单次访问的空桶数量
+        if(node ? (0 == -- steps) : (0 == -- empty_visits))
+        {
+            break;
+        }
+    }
+
+    if(seg->rehash_list && seg->rehash_idx == seg->bucket_count)
+    {
+        chain_bucket_list_free(seg, seg->bucket_list);
+        seg->bucket_list = seg->rehash_list;
+        seg->bucket_count = seg->rehash_count;
+        seg->rehash_list = NULL;
+        seg->rehash_count = 0;
+        seg->rehash_idx = 0;
+    }
+}
+
+// 根据负载因子开始扩缩容，调用者持有写锁
+static void chain_resize_check(IN chain_segment *seg)
+{
+    unsigned int n = seg->bucket_count;
+
+    if(seg->rehash_list)
+    {
+        return;
+    }
+
+    if(SEG_COUNT(seg) / CHAIN_LOAD_MAX > n && n < CHAIN_BUCKET_MAX)
+    {
+        chain_rehash_start(seg, n * 2);
+    }
+    else if(n > seg->min_bucket_count && SEG_COUNT(seg) < n / CHAIN_SHRINK_DIV)
+    {
+        chain_rehash_start(seg, (n / 2 > seg->min_bucket_count) ? n / 2 : seg->min_bucket_count);
+    }
+}
+
+// 段内查找，返回指向匹配节点的链接，不存在时返回桶尾的空链接，调用者持有段锁
+static chain_node** chain_segment_find(
+    IN chain_hash_table *ht,
+    IN chain_segment *seg,
+    IN unsigned int hash_val,
+    IN void *key
+)
+{
+    chain_node **link = chain_bucket_locate(seg, hash_val);
+
+    // 哈希值不同的节点一定不相等，只对哈希值相同的节点调用比较函数
+    while(*link && ((*link)->hash != hash_val || !ht->base.cmp(key, (*link)->key)))
+    {
+        link = &(*link)->next;
+    }
+
+    return link;
+}
+
+// 在find返回的空链接处加入新节点，调用者持有写锁
+static STATUS chain_segment_add(
+    IN chain_segment *seg,
+    IN chain_node **link,
+    IN unsigned int hash_val,
+    IN void *key,
+    IN void *value
+)
+{
+    chain_node *node = chain_node_alloc(seg);
+
+    if(unlikely(!node))
+    {
+        DBG("malloc node fail");
+        return ERR_NO_MEMORY;
+    }
+
+    node->next = NULL;
+    node->key = key;
+    node->value = value;
+    node->hash = hash_val;
+    *link = node;
+
+    SEG_COUNT_ADD(seg, 1);
+    chain_resize_check(seg);
+
+    return OK;
+}
+
+// 段内修改前加写锁，并推进迁移
+static inline chain_segment* chain_segment_wlock(
+    IN chain_hash_table *ht,
+    IN unsigned int hash_val
+)
+{
+    chain_segment *seg = chain_segment_of(ht, hash_val);
+
+    SEG_WLOCK(seg);
+    if(seg->rehash_list)
+    {
+        chain_rehash_step(seg, CHAIN_REHASH_STEP);
+    }
+
+    return seg;
+}
+
+// 销毁段数组
+static void chain_segments_free(IN chain_hash_table *ht)
+{
+    unsigned int i = 0;
+    chain_segment *seg = NULL;
+
+    for(; i < ht->segment_count; ++ i)
+    {
+        seg = &ht->segments[i];
+        chain_bucket_list_free(seg, seg->bucket_list);
+        chain_bucket_list_free(seg, seg->rehash_list);
+        chain_slab_release(seg);
+        pthread_rwlock_destroy(&seg->lock);
+    }
+}
+
+// 创建哈希表，按段数量平分桶；表头、段数组和初始桶数组一次申请，布局为 表头|对齐|段数组|桶数组
+static hash_table* chain_create(
+    IN const hash_table_ops *ops,
+    IN unsigned int segment_count,
+    IN unsigned int bucket_size,
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    chain_hash_table *ht = NULL;
+    chain_segment *seg = NULL;
+    chain_node **lists = NULL;
+    unsigned int seg_buckets = 0;
+    unsigned int i = 0;
+    size_t size = 0;
+
+    if(unlikely(bucket_size == 0 || bucket_size > CHAIN_BUCKET_MAX || NULL == cmp))
+    {
+        DBG("bad in param for create hash table");
+        return NULL;
+    }
+
+    seg_buckets = chain_pow2_ceil((bucket_size + segment_count - 1) / segment_count);
+
+    // 表头之后多留一个缓存行用于段数组对齐，段的大小是缓存行的整数倍，桶数组紧随其后
+    size = sizeof(chain_hash_table) + CHAIN_CACHE_LINE +
+           sizeof(chain_segment) * segment_count +
+           sizeof(chain_node*) * seg_buckets * segment_count;
+
+    ht = (chain_hash_table*)malloc(size);
+    if(unlikely(NULL == ht))
+    {
+        DBG("malloc space of hash table fail");
+        return NULL;
+    }
+    memset(ht, 0, size);
+
+    ht->segments = (chain_segment*)(((uintptr_t)(ht + 1) + CHAIN_CACHE_LINE - 1) &
+                                    ~(uintptr_t)(CHAIN_CACHE_LINE - 1));
+    lists = (chain_node**)(ht->segments + segment_count);
+
+    ht->segment_shift = 32;
+    for(i = segment_count; i > 1; i >>= 1)
+    {
+        -- ht->segment_shift;
+    }
+
+    for(i = 0; i < segment_count; ++ i)
+    {
+        seg = &ht->segments[i];
+
+        // 桶数组位于同一块内存中，桶初始为空
+        seg->inline_list = lists + (size_t)seg_buckets * i;
+        seg->bucket_list = seg->inline_list;
+        seg->bucket_count = seg_buckets;
+        seg->min_bucket_count = seg_buckets;
+        atomic_init(&seg->count, 0);
+
+        // 初始化锁
+        if(0 != pthread_rwlock_init(&seg->lock, NULL))
+        {
+            DBG("init rwlock fail");
+            goto error;
+        }
+        ++ ht->segment_count;
+    }
+
+    hash_table_base_init(&ht->base, ops, hash, cmp, show);
+
+    return &ht->base;
+
+error:
+    chain_segments_free(ht);
+    free(ht);
+    return NULL;
+}
+
+// 创建哈希表，所有桶属于同一个段
+static hash_table* _chain_create(
+    IN unsigned int bucket_size,
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    return chain_create(&hash_table_chain_operations, 1, bucket_size, hash, cmp, show);
+}
+
+// 创建分段锁哈希表
+static hash_table* _striped_create(
+    IN unsigned int bucket_size,
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    return chain_create(&hash_table_striped_operations, HASH_TABLE_STRIPE_COUNT, bucket_size, hash, cmp, show);
+}
+
+// 销毁哈希表
+static STATUS _chain_destroy(IN hash_table *hs)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    chain_segments_free(ht);
+    free(ht);
+
+    return OK;
+}
+
+// 检查键是否存在表中
+static bool _chain_contain(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    unsigned int hs_val = 0;
+    bool ret = false;
+
+    if(unlikely(!hs || !key))
+    {
+        return false;
+    }
+
+    // 计算哈希值
+    hs_val = chain_hash(ht, key);
+    seg = chain_segment_of(ht, hs_val);
+
+    SEG_RLOCK(seg);
+    ret = (NULL != *chain_segment_find(ht, seg, hs_val, key));
+    SEG_UNLOCK(seg);
+
+    return ret;
+}
+
+// 查找键，返回对应的值
+static void* _chain_get(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    chain_node *node = NULL;
+    unsigned int hash_val = 0;
+    void *value = NULL;
+
+    if(unlikely(!hs || !key))
+    {
+        return NULL;
+    }
+
+    hash_val = chain_hash(ht, key);
+    seg = chain_segment_of(ht, hash_val);
+
+    SEG_RLOCK(seg);
+    node = *chain_segment_find(ht, seg, hash_val, key);
+    if(node)
+    {
+        value = node->value;
+    }
+    SEG_UNLOCK(seg);
+
+    return value;
+}
+
+// 加入或替换键值对
+static STATUS _chain_put(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **old_value
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    chain_node **link = NULL;
+    unsigned int hash_val = 0;
+    void *found = NULL;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    // 计算hash
+    hash_val = chain_hash(ht, key);
+
+    // 查找和修改在同一个临界区内完成
+    seg = chain_segment_wlock(ht, hash_val);
+
+    link = chain_segment_find(ht, seg, hash_val, key);
+    if(*link)
+    {
+        // 键也一并替换，旧键可能指向旧值内部
+        found = (*link)->value;
+        (*link)->key = key;
+        (*link)->value = value;
+    }
+    else
+    {
+        ret = chain_segment_add(seg, link, hash_val, key, value);
+    }
+
+    SEG_UNLOCK(seg);
+
+    if(old_value)
+    {
+        *old_value = found;
+    }
+
+    return ret;
+}
+
+// 键不存在时加入键值对，返回表中的值
+static STATUS _chain_get_or_insert(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **result
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    chain_node **link = NULL;
+    unsigned int hash_val = 0;
+    STATUS ret = ERR_HASH_TABLE_DATA_EXIST;
+
+    if(unlikely(!hs || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    hash_val = chain_hash(ht, key);
+
+    seg = chain_segment_wlock(ht, hash_val);
+
+    link = chain_segment_find(ht, seg, hash_val, key);
+    if(*link)
+    {
+        value = (*link)->value;
+    }
+    else
+    {
+        ret = chain_segment_add(seg, link, hash_val, key, value);
+    }
+
+    SEG_UNLOCK(seg);
+
+    if(result)
+    {
+        *result = (OK == ret || ERR_HASH_TABLE_DATA_EXIST == ret) ? value : NULL;
+    }
+
+    return ret;
+}
+
+// 不存在时调用func生成数据并加入
+static STATUS _chain_compute_if_absent(
+    IN hash_table *hs,
+    IN void *key,
+    IN hash_table_compute_func func,
+    IN void *ctx,
+    OUT void **result
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    chain_node **link = NULL;
+    unsigned int hash_val = 0;
+    void *found = NULL;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || !key || !func || !result))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    hash_val = chain_hash(ht, key);
+
+    seg = chain_segment_wlock(ht, hash_val);
+
+    link = chain_segment_find(ht, seg, hash_val, key);
+    if(*link)
+    {
+        found = (*link)->value;
+    }
+    else
+    {
+        // 生成的数据同时作为键和值
+        found = func(key, ctx);
+        ret = found ? chain_segment_add(seg, link, hash_val, found, found) : ERR_HASH_TABLE_COMPUTE_FAIL;
+    }
+
+    SEG_UNLOCK(seg);
+
+    *result = (OK == ret) ? found : NULL;
+
+    return ret;
+}
+
+// 移除键，返回旧值
+static STATUS _chain_pop(
+    IN hash_table *hs,
+    IN void *key,
+    OUT void **old_value
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    chain_node **link = NULL;
+    chain_node *node = NULL;
+    unsigned int hv = 0;
+    void *found = NULL;
+    STATUS ret = ERR_HASH_TABLE_DATA_NOT_EXIST;
+
+    if(unlikely(!hs || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    hv = chain_hash(ht, key);
+
+    seg = chain_segment_wlock(ht, hv);
+
+    link = chain_segment_find(ht, seg, hv, key);
+    node = *link;
+    if(node)
+    {
+        *link = node->next;
+        found = node->value;
+
+        SEG_COUNT_ADD(seg, -1);
+        chain_node_free(seg, node);
+        chain_resize_check(seg);
+        ret = OK;
+    }
+
+    SEG_UNLOCK(seg);
+
+    if(old_value)
+    {
+        *old_value = found;
+    }
+
+    return ret;
+}
+
+// 一轮批量操作的准备：计算各键的哈希值，再按所在段稳定排序，同一段的键相邻，每个段只加一次锁。
+// 返回非NULL键的数量，order[i]为排序后第i个键在本轮中的下标，segs[i]为其所在的段
+static unsigned int chain_batch_sort(
+    IN chain_hash_table *ht,
+    IN void **keys,
+    IN unsigned int n,
+    OUT unsigned int *hashes,
+    OUT unsigned int *order,
+    OUT chain_segment **segs
+)
+{
+    chain_segment *seg = NULL;
+    unsigned int m = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    for(i = 0; i < n; ++ i)
+    {
+        if(!keys[i])
+        {
+            continue;
+        }
+
+        hashes[i] = chain_hash(ht, keys[i]);
+        seg = chain_segment_of(ht, hashes[i]);
+
+        // 插入排序，每轮最多CHAIN_BATCH个键；段数组连续，按地址比较即按段序号比较
+        for(j = m; j > 0 && segs[j - 1] > seg; -- j)
+        {
+            segs[j] = segs[j - 1];
+            order[j] = order[j - 1];
+        }
+        segs[j] = seg;
+        order[j] = i;
+        ++ m;
+    }
+
+    return m;
+}
+
+// 同一段内一组键的预取：先预取所有桶头，再预取所有首节点，让多次缓存缺失重叠，调用者持有段锁
+static void chain_batch_prefetch(
+    IN chain_segment *seg,
+    IN unsigned int *hashes,
+    IN unsigned int *order,
+    IN unsigned int n
+)
+{
+    chain_node *node = NULL;
+    unsigned int i = 0;
+
+    for(i = 0; i < n; ++ i)
+    {
+        prefetch(chain_bucket_locate(seg, hashes[order[i]]));
+    }
+    for(i = 0; i < n; ++ i)
+    {
+        node = *chain_bucket_locate(seg, hashes[order[i]]);
+        if(node)
+        {
+            prefetch(node);
+        }
+    }
+}
+
+// 排序后从first开始、属于同一段的键的数量
+static inline unsigned int chain_batch_run(
+    IN chain_segment **segs,
+    IN unsigned int first,
+    IN unsigned int m
+)
+{
+    unsigned int last = first + 1;
+
+    while(last < m && segs[last] == segs[first])
+    {
+        ++ last;
+    }
+
+    return last - first;
+}
+
+// 批量查找，每轮按段分组，每组加一次读锁，预取后逐个查找。found和values可以为NULL
+static void chain_find_batch(
+    IN chain_hash_table *ht,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found,
+    OUT void **values
+)
+{
+    unsigned int hashes[CHAIN_BATCH];
+    unsigned int order[CHAIN_BATCH];
+    chain_segment *segs[CHAIN_BATCH];
+    chain_segment *seg = NULL;
+    chain_node *node = NULL;
+    unsigned int base = 0;
+    unsigned int n = 0;
+    unsigned int m = 0;
+    unsigned int g = 0;
+    unsigned int k = 0;
+    unsigned int i = 0;
+    unsigned int idx = 0;
+
+    for(base = 0; base < count; base += n)
+    {
+        n = (count - base < CHAIN_BATCH) ? count - base : CHAIN_BATCH;
+
+        // 键为NULL时结果为不存在
+        for(i = 0; i < n; ++ i)
+        {
+            if(found)
+            {
+                found[base + i] = false;
+            }
+            if(values)
+            {
+                values[base + i] = NULL;
+            }
+        }
+
+        m = chain_batch_sort(ht, keys + base, n, hashes, order, segs);
+
+        for(g = 0; g < m; g += k)
+        {
+            k = chain_batch_run(segs, g, m);
+            seg = segs[g];
+
+            SEG_RLOCK(seg);
+
+            chain_batch_prefetch(seg, hashes, order + g, k);
+
+            for(i = g; i < g + k; ++ i)
+            {
+                idx = order[i];
+                node = *chain_segment_find(ht, seg, hashes[idx], keys[base + idx]);
+                if(found)
+                {
+                    found[base + idx] = (NULL != node);
+                }
+                if(values)
+                {
+                    values[base + idx] = node ? node->value : NULL;
+                }
+            }
+
+            SEG_UNLOCK(seg);
+        }
+    }
+}
+
+// 批量检查键是否存在
+static STATUS _chain_contain_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found
+)
+{
+    if(unlikely(!hs || !keys || !found))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    chain_find_batch((chain_hash_table*)hs, keys, count, found, NULL);
+
+    return OK;
+}
+
+// 批量查找键对应的值
+static STATUS _chain_get_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT void **values
+)
+{
+    if(unlikely(!hs || !keys || !values))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    chain_find_batch((chain_hash_table*)hs, keys, count, NULL, values);
+
+    return OK;
+}
+
+// 批量加入，已存在的数据跳过。每轮按段分组，每组加一次写锁，先推进迁移再预取，预取的桶头不会被迁移改动
+static STATUS _chain_insert_batch(
+    IN hash_table *hs,
+    IN void **data,
+    IN unsigned int count,
+    OUT unsigned int *inserted
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    unsigned int hashes[CHAIN_BATCH];
+    unsigned int order[CHAIN_BATCH];
+    chain_segment *segs[CHAIN_BATCH];
+    chain_segment *seg = NULL;
+    chain_node **link = NULL;
+    unsigned int added = 0;
+    unsigned int base = 0;
+    unsigned int n = 0;
+    unsigned int m = 0;
+    unsigned int g = 0;
+    unsigned int k = 0;
+    unsigned int i = 0;
+    unsigned int idx = 0;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || !data))
+    {
+        return ERR_BAD_PARAM;
+    }
+    for(i = 0; i < count; ++ i)
+    {
+        if(unlikely(!data[i]))
+        {
+            return ERR_BAD_PARAM;
+        }
+    }
+
+    for(base = 0; OK == ret && base < count; base += n)
+    {
+        n = (count - base < CHAIN_BATCH) ? count - base : CHAIN_BATCH;
+
+        m = chain_batch_sort(ht, data + base, n, hashes, order, segs);
+
+        for(g = 0; OK == ret && g < m; g += k)
+        {
+            k = chain_batch_run(segs, g, m);
+            seg = segs[g];
+
+            SEG_WLOCK(seg);
+
+            // 与逐个加入推进相同的迁移量
+            if(seg->rehash_list)
+            {
+                chain_rehash_step(seg, CHAIN_REHASH_STEP * k);
+            }
+
+            chain_batch_prefetch(seg, hashes, order + g, k);
+
+            for(i = g; OK == ret && i < g + k; ++ i)
+            {
+                idx = order[i];
+                link = chain_segment_find(ht, seg, hashes[idx], data[base + idx]);
+                if(!*link)
+                {
+                    ret = chain_segment_add(seg, link, hashes[idx], data[base + idx], data[base + idx]);
+                    added += (OK == ret);
+                }
+            }
+
+            SEG_UNLOCK(seg);
+        }
+    }
+
+    if(inserted)
+    {
+        *inserted = added;
+    }
+
+    return ret;
+}
+
+// 预留容量，保证容纳count个元素时不再扩容，且缩容不低于该规模
+static STATUS _chain_reserve(
+    IN hash_table *hs,
+    IN unsigned int count
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    unsigned int target = 0;
+    unsigned int i = 0;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || 0 == count))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    // 哈希值在段之间均匀分布，每段按平均数量预留
+    target = (count + ht->segment_count - 1) / ht->segment_count / CHAIN_LOAD_MAX;
+    target = (target > CHAIN_BUCKET_MAX) ? CHAIN_BUCKET_MAX : chain_pow2_ceil(target);
+
+    for(i = 0; OK == ret && i < ht->segment_count; ++ i)
+    {
+        seg = &ht->segments[i];
+
+        SEG_WLOCK(seg);
+
+        if(target > seg->min_bucket_count)
+        {
+            seg->min_bucket_count = target;
+        }
+
+        // 迁移目标不够大时，先完成当前迁移
+        while(seg->rehash_list && seg->rehash_count < target)
+        {
+            chain_rehash_step(seg, seg->bucket_count);
+        }
+
+        if(!seg->rehash_list && seg->bucket_count < target)
+        {
+            ret = chain_rehash_start(seg, target);
+        }
+
+        SEG_UNLOCK(seg);
+    }
+
+    return ret;
+}
+
+// 获取哈希表元素总数，累加各段的计数，不加锁，并发修改时结果是近似值
+static STATUS _chain_get_size(
+    IN hash_table *hs,
+    OUT unsigned int *size
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    unsigned int i = 0;
+
+    if(unlikely(!hs || !size))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    *size = 0;
+
+    for(i = 0; i < ht->segment_count; ++ i)
+    {
+        *size += SEG_COUNT(&ht->segments[i]);
+    }
+
+    return OK;
+}
+
+// 桶数组中的最长链长度
+static unsigned int chain_bucket_list_max_chain(
+    IN chain_node **list,
+    IN unsigned int bucket_count
+)
+{
+    chain_node *node = NULL;
+    unsigned int max_chain = 0;
+    unsigned int len = 0;
+    unsigned int i = 0;
+
+    for(; list && i < bucket_count; ++ i)
+    {
+        for(len = 0, node = list[i]; node; node = node->next)
+        {
+            ++ len;
+        }
+        if(len > max_chain)
+        {
+            max_chain = len;
+        }
+    }
+
+    return max_chain;
+}
+
+// 获取统计信息，迁移中的段按目标桶数量统计
+static STATUS _chain_get_stats(
+    IN hash_table *hs,
+    OUT hash_table_stats *stats
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    unsigned int max_chain = 0;
+    unsigned int i = 0;
+
+    if(unlikely(!hs || !stats))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    memset(stats, 0, sizeof(hash_table_stats));
+
+    for(i = 0; i < ht->segment_count; ++ i)
+    {
+        seg = &ht->segments[i];
+
+        SEG_RLOCK(seg);
+
+        stats->size += SEG_COUNT(seg);
+        stats->bucket_count += seg->rehash_list ? seg->rehash_count : seg->bucket_count;
+
+        max_chain = chain_bucket_list_max_chain(seg->bucket_list, seg->bucket_count);
+        if(max_chain > stats->max_chain)
+        {
+            stats->max_chain = max_chain;
+        }
+        max_chain = chain_bucket_list_max_chain(seg->rehash_list, seg->rehash_count);
+        if(max_chain > stats->max_chain)
+        {
+            stats->max_chain = max_chain;
+        }
+
+        SEG_UNLOCK(seg);
+    }
+
+    stats->load_factor = (double)stats->size / stats->bucket_count;
+
+    return OK;
+}
+
+// 迭代器前进，每个段在遍历期间持有读锁，段内的元素恰好访问一次
+static bool _chain_iter_next(
+    IN hash_table_iter *it,
+    OUT void **key,
+    OUT void **value
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)it->hs;
+    chain_segment *seg = NULL;
+    chain_node *node = NULL;
+
+    while(it->segment < ht->segment_count)
+    {
+        seg = &ht->segments[it->segment];
+        if(!it->locked)
+        {
+            SEG_RLOCK(seg);
+            it->locked = true;
+            it->index = 0;
+            it->node = NULL;
+        }
+
+        // 旧桶数组和迁移目标数组连续编号
+        while(!it->node && it->index < seg->bucket_count + seg->rehash_count)
+        {
+            it->node = (it->index < seg->bucket_count) ?
+                            seg->bucket_list[it->index] :
+                            seg->rehash_list[it->index - seg->bucket_count];
+            ++ it->index;
+        }
+
+        if(it->node)
+        {
+            node = (chain_node*)it->node;
+            it->node = node->next;
+            if(key)     *key = node->key;
+            if(value)   *value = node->value;
+            return true;
+        }
+
+        SEG_UNLOCK(seg);
+        it->locked = false;
+        ++ it->segment;
+    }
+
+    return false;
+}
+
+// 提前结束迭代，释放持有的读锁
+static void _chain_iter_end(IN hash_table_iter *it)
+{
+    chain_hash_table *ht = (chain_hash_table*)it->hs;
+
+    if(it->locked)
+    {
+        SEG_UNLOCK(&ht->segments[it->segment]);
+        it->locked = false;
+    }
+    it->segment = ht->segment_count;
+}
+
+// 遍历一个桶数组中属于分片part的节点。桶下标是哈希值的低位，
+// 桶数量不小于分片数时只需访问下标与part同余的桶，否则只有一个桶可能含有该分片
+static bool chain_bucket_list_visit(
+    IN chain_node **list,
+    IN unsigned int bucket_count,
+    IN unsigned int part,
+    IN unsigned int parts,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    unsigned int step = (bucket_count < parts) ? bucket_count : parts;
+    chain_node *node = NULL;
+    unsigned int i = 0;
+
+    for(i = part & (step - 1); list && i < bucket_count; i += step)
+    {
+        for(node = list[i]; node; node = node->next)
+        {
+            if((node->hash & (parts - 1)) == part && !visit(node->key, node->value, ctx))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// 遍历哈希值低位等于part的元素，分片与桶数量无关，迁移不会让元素跨分片
+static bool _chain_foreach_part(
+    IN hash_table *hs,
+    IN unsigned int part,
+    IN unsigned int parts,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    bool ret = true;
+    unsigned int i = 0;
+
+    for(i = 0; ret && i < ht->segment_count; ++ i)
+    {
+        seg = &ht->segments[i];
+
+        SEG_RLOCK(seg);
+        ret = chain_bucket_list_visit(seg->bucket_list, seg->bucket_count, part, parts, visit, ctx) &&
+              chain_bucket_list_visit(seg->rehash_list, seg->rehash_count, part, parts, visit, ctx);
+        SEG_UNLOCK(seg);
+    }
+
+    return ret;
+}
+
+// 打印一个桶，格式与dlist_display一致
+static void chain_bucket_display(
+    IN chain_hash_table *ht,
+    IN chain_node *node
+)
+{
+    unsigned int count = 0;
+
+    for(; node; node = node->next)
+    {
+        if(ht->base.show)
+        {
+            ht->base.show(node->key);
+        }
+        printf("(%u)-->", ++ count);
+    }
+    printf("\r\n");
+}
+
+// 打印哈希表
+static void _chain_display(
+    IN hash_table *hs
+)
+{
+    chain_hash_table *ht = (chain_hash_table*)hs;
+    chain_segment *seg = NULL;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    if(unlikely(!hs))
+    {
+        DBG("bad param");
+        return;
+    }
+
+    for(i = 0; i < ht->segment_count; ++ i)
+    {
+        seg = &ht->segments[i];
+
+        SEG_RLOCK(seg);
+
+        if(ht->segment_count > 1)
+        {
+            printf("segment %u:\r\n", i);
+        }
+
+        for(j = 0; j < seg->bucket_count + seg->rehash_count; ++ j)
+        {
+            if(j < seg->bucket_count)
+            {
+                printf("bucket %u:\r\n", j);
+                chain_bucket_display(ht, seg->bucket_list[j]);
+            }
+            else
+            {
+                printf("rehash bucket %u:\r\n", j - seg->bucket_count);
+                chain_bucket_display(ht, seg->rehash_list[j - seg->bucket_count]);
+            }
+        }
+
+        SEG_UNLOCK(seg);
+    }
+}
+
+/*
+    Variables
+*/
+
+// 链地址法引擎操作集合，insert/remove等集合操作由hash_table.c基于键值操作实现
+hash_table_ops hash_table_chain_operations = {
+    .hash_table_create = _chain_create,
+    .hash_table_destroy = _chain_destroy,
+    .hash_table_put = _chain_put,
+    .hash_table_get = _chain_get,
+    .hash_table_get_or_insert = _chain_get_or_insert,
+    .hash_table_pop = _chain_pop,
+    .hash_table_compute_if_absent = _chain_compute_if_absent,
+    .hash_table_contain = _chain_contain,
+    .hash_table_contain_batch = _chain_contain_batch,
+    .hash_table_get_batch = _chain_get_batch,
+    .hash_table_insert_batch = _chain_insert_batch,
+    .hash_table_reserve = _chain_reserve,
+    .hash_table_get_size = _chain_get_size,
+    .hash_table_get_stats = _chain_get_stats,
+    .hash_table_iter_next = _chain_iter_next,
+    .hash_table_iter_end = _chain_iter_end,
+    .hash_table_foreach_part = _chain_foreach_part,
+    .hash_table_display = _chain_display,
+};
+
+// 分段锁链地址法引擎操作集合，除创建外与链地址法引擎相同
+hash_table_ops hash_table_striped_operations = {
+    .hash_table_create = _striped_create,
+    .hash_table_destroy = _chain_destroy,
+    .hash_table_put = _chain_put,
+    .hash_table_get = _chain_get,
+    .hash_table_get_or_insert = _chain_get_or_insert,
+    .hash_table_pop = _chain_pop,
+    .hash_table_compute_if_absent = _chain_compute_if_absent,
+    .hash_table_contain = _chain_contain,
+    .hash_table_contain_batch = _chain_contain_batch,
+    .hash_table_get_batch = _chain_get_batch,
+    .hash_table_insert_batch = _chain_insert_batch,
+    .hash_table_reserve = _chain_reserve,
+    .hash_table_get_size = _chain_get_size,
+    .hash_table_get_stats = _chain_get_stats,
+    .hash_table_iter_next = _chain_iter_next,
+    .hash_table_iter_end = _chain_iter_end,
+    .hash_table_foreach_part = _chain_foreach_part,
+    .hash_table_display = _chain_display,
+};
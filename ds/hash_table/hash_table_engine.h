@@ -0,0 +1,88 @@
+#ifndef _HASH_TABLE_ENGINE_H
+#define _HASH_TABLE_ENGINE_H
+
+/*
+    Include files
+*/
+
+#include "hash_table.h"
+
+/*
+    typedefs
+*/
+
+// 哈希表公共头部，各引擎的表结构必须以它作为第一个成员
+struct hash_table
+{
+    const hash_table_ops *ops;  // 所属引擎的操作集合
+
+    hash_func hash;             // 哈希函数
+    hash_table_seeded_func seeded_hash; // 带种子的哈希函数，非NULL时代替hash
+    uint64_t seed;              // 表的随机种子
+    cmp_func cmp;               // 数据比较函数
+    hash_table_show_func show;  // 数据打印函数
+};
+
+/*
+    Extern symbols
+*/
+
+// 链地址法引擎
+extern hash_table_ops hash_table_chain_operations;
+// 开放寻址法引擎
+extern hash_table_ops hash_table_oa_operations;
+// 分段锁链地址法引擎
+extern hash_table_ops hash_table_striped_operations;
+// 冻结的完美哈希表，只读
+extern hash_table_ops hash_table_frozen_operations;
+
+/*
+    Functions
+*/
+
+// 初始化公共头部
+static inline void hash_table_base_init(
+    IN hash_table *hs,
+    IN const hash_table_ops *ops,
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    hs->ops = ops;
+    hs->hash = hash;
+    hs->seeded_hash = NULL;
+    hs->seed = 0;
+    hs->cmp = cmp;
+    hs->show = show;
+}
+
+// 改用带种子的哈希函数
+static inline void hash_table_base_seed(
+    IN hash_table *hs,
+    IN hash_table_seeded_func seeded_hash,
+    IN uint64_t seed
+)
+{
+    hs->seeded_hash = seeded_hash;
+    hs->seed = seed;
+}
+
+// 计算键的哈希值，各引擎都通过它调用哈希函数
+static inline unsigned int hash_table_hash(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    uint64_t h = 0;
+
+    if(hs->seeded_hash)
+    {
+        h = hs->seeded_hash(key, hs->seed);
+        return (unsigned int)(h ^ (h >> 32));
+    }
+
+    return hs->hash(key);
+}
+
+#endif
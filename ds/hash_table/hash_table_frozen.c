@@ -0,0 +1,1024 @@
+/*
+    Include files
+*/
+
+#include <stdint.h>
+#include <limits.h>
+#include "hash_table_engine.h"
+
+/*
+    Defines
+*/
+
+#define FROZEN_LAMBDA       (2)             // 平均每个桶的键数量，越大位移数组越小，构建越慢
+#define FROZEN_DIRECT       (0x80000000u)   // 位移最高位为1时，低位直接记录单键桶的槽下标
+#define FROZEN_MAX_PILOT    (1u << 16)      // 每个桶最多尝试的位移数量
+#define FROZEN_MAX_ATTEMPTS (8)             // 构建失败时更换种子重试的次数
+#define FROZEN_BATCH        (16)            // 批量查找每轮处理的键数量
+#define FROZEN_TAG_OVERFLOW (0x8000u)       // 标签最高位为1时，溢出区中有与该槽哈希值相同的元素
+
+#define FROZEN_TAG(h)       ((uint16_t)((h) >> 49))  // 槽标签，取64位哈希值的高15位
+
+/*
+    typedefs
+*/
+
+// 槽，只存键值对，哈希值的标签另存在标签数组中
+typedef struct
+{
+    void *key;                  // 键
+    void *value;                // 值
+}frozen_entry;
+
+// 构建时收集的元素，带64位哈希值
+typedef struct
+{
+    uint64_t hash;              // 键的64位哈希值
+    void *key;                  // 键
+    void *value;                // 值
+}frozen_build_entry;
+
+// 冻结的哈希表结构，与位移数组、槽数组在同一块内存
+typedef struct
+{
+    hash_table base;            // 公共头部，复制自原表
+
+    uint64_t seed;              // 完美哈希的种子
+    unsigned int count;         // 元素数量
+    unsigned int slot_count;    // 槽数量，即不同哈希值的数量
+    unsigned int bucket_count;  // 桶数量
+    unsigned int max_chain;     // 哈希值相同的元素最多的一组
+    uint32_t *pilots;           // 每个桶的位移
+    uint16_t *tags;             // 每个槽的标签，查找时先比它再比键
+    frozen_entry *slots;        // 槽数组，每个哈希值恰好一个槽
+    frozen_entry *overflow;     // 与槽中哈希值相同的其余元素，按哈希值排序，紧接在槽数组之后
+    uint64_t *overflow_hashes;  // 溢出区元素的哈希值，供二分查找
+}frozen_hash_table;
+
+// 构建时收集的元素
+typedef struct
+{
+    hash_table *hs;
+    frozen_build_entry *entries;
+    unsigned int count;
+    unsigned int capacity;
+    STATUS ret;
+}frozen_collect_ctx;
+
+/*
+    Functions
+*/
+
+// fmix64
+static inline uint64_t frozen_mix(IN uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+// 把x的高32位映射到[0, n)，乘法代替取模
+static inline unsigned int frozen_reduce(
+    IN uint64_t x,
+    IN unsigned int n
+)
+{
+    return (unsigned int)(((x >> 32) * (uint64_t)n) >> 32);
+}
+
+// 键的64位哈希值：带种子的哈希函数直接使用，否则把32位哈希值混淆扩展
+static inline uint64_t frozen_key_hash(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    return hs->seeded_hash ? hs->seeded_hash(key, hs->seed) : hash_table_hash_u64(hs->hash(key), hs->seed);
+}
+
+// 哈希值所在的桶
+static inline unsigned int frozen_bucket(
+    IN uint64_t seed,
+    IN unsigned int bucket_count,
+    IN uint64_t h
+)
+{
+    return frozen_reduce(frozen_mix(h ^ seed), bucket_count);
+}
+
+// 哈希值在给定位移下的槽
+static inline unsigned int frozen_slot(
+    IN uint64_t seed,
+    IN unsigned int slot_count,
+    IN uint64_t h,
+    IN uint32_t pilot
+)
+{
+    if(pilot & FROZEN_DIRECT)
+    {
+        return pilot & ~FROZEN_DIRECT;
+    }
+
+    return frozen_reduce(frozen_mix(h ^ frozen_mix(seed + pilot + 1)), slot_count);
+}
+
+// 哈希值对应的槽下标
+static inline unsigned int frozen_locate(
+    IN frozen_hash_table *ft,
+    IN uint64_t h
+)
+{
+    uint32_t pilot = ft->pilots[frozen_bucket(ft->seed, ft->bucket_count, h)];
+    return frozen_slot(ft->seed, ft->slot_count, h, pilot);
+}
+
+// 在溢出区中查找，二分找到第一个哈希值相同的元素后逐个比较
+static frozen_entry* frozen_overflow_find(
+    IN frozen_hash_table *ft,
+    IN void *key,
+    IN uint64_t h
+)
+{
+    unsigned int n = ft->count - ft->slot_count;
+    unsigned int lo = 0;
+    unsigned int hi = n;
+    unsigned int mid = 0;
+
+    while(lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if(ft->overflow_hashes[mid] < h)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for(; lo < n && ft->overflow_hashes[lo] == h; ++ lo)
+    {
+        if(ft->base.cmp(ft->overflow[lo].key, key))
+        {
+            return &ft->overflow[lo];
+        }
+    }
+
+    return NULL;
+}
+
+// 查找：一次定位到唯一可能的槽，标签相同才比较键；只有槽标记了溢出且键不同时才查溢出区
+static inline frozen_entry* frozen_find_slot(
+    IN frozen_hash_table *ft,
+    IN unsigned int idx,
+    IN void *key,
+    IN uint64_t h
+)
+{
+    uint16_t tag = ft->tags[idx];
+
+    if((tag & ~FROZEN_TAG_OVERFLOW) != FROZEN_TAG(h))
+    {
+        return NULL;
+    }
+    if(likely(ft->base.cmp(ft->slots[idx].key, key)))
+    {
+        return &ft->slots[idx];
+    }
+
+    return (tag & FROZEN_TAG_OVERFLOW) ? frozen_overflow_find(ft, key, h) : NULL;
+}
+
+static frozen_entry* frozen_find(
+    IN frozen_hash_table *ft,
+    IN void *key
+)
+{
+    uint64_t h = 0;
+
+    if(unlikely(!key || 0 == ft->slot_count))
+    {
+        return NULL;
+    }
+
+    h = frozen_key_hash(&ft->base, key);
+
+    return frozen_find_slot(ft, frozen_locate(ft, h), key, h);
+}
+
+// 遍历回调：收集原表中的元素
+static bool frozen_collect(
+    IN void *key,
+    IN void *value,
+    IN void *param
+)
+{
+    frozen_collect_ctx *fc = (frozen_collect_ctx*)param;
+    frozen_build_entry *entries = NULL;
+
+    if(fc->count == fc->capacity)
+    {
+        if(unlikely(fc->capacity >= FROZEN_DIRECT / 2))
+        {
+            fc->ret = ERR_NO_MEMORY;
+            return false;
+        }
+        entries = (frozen_build_entry*)malloc(sizeof(frozen_build_entry) * fc->capacity * 2);
+        if(unlikely(!entries))
+        {
+            fc->ret = ERR_NO_MEMORY;
+            return false;
+        }
+        memcpy(entries, fc->entries, sizeof(frozen_build_entry) * fc->count);
+        free(fc->entries);
+        fc->entries = entries;
+        fc->capacity *= 2;
+    }
+
+    fc->entries[fc->count].hash = frozen_key_hash(fc->hs, key);
+    fc->entries[fc->count].key = key;
+    fc->entries[fc->count].value = value;
+    ++ fc->count;
+
+    return true;
+}
+
+// 把收集的元素放入槽，并记录标签
+static inline void frozen_fill(
+    IN frozen_hash_table *ft,
+    IN unsigned int idx,
+    IN frozen_build_entry *e
+)
+{
+    ft->slots[idx].key = e->key;
+    ft->slots[idx].value = e->value;
+    ft->tags[idx] = FROZEN_TAG(e->hash);
+}
+
+static int frozen_entry_cmp(
+    IN const void *a,
+    IN const void *b
+)
+{
+    uint64_t ha = ((const frozen_build_entry*)a)->hash;
+    uint64_t hb = ((const frozen_build_entry*)b)->hash;
+
+    return (ha > hb) - (ha < hb);
+}
+
+// 构建完美哈希：按桶分组，从大桶开始为每个桶寻找一个位移，使桶内所有键落到互不相同的空槽；
+// 单键桶最后处理，直接记录剩余空槽的下标。成功返回true
+static bool frozen_place(
+    IN frozen_hash_table *ft,
+    IN frozen_build_entry *uniq
+)
+{
+    unsigned int m = ft->slot_count;
+    unsigned int nb = ft->bucket_count;
+    unsigned int *start = NULL;     // 桶b的键为order[start[b], start[b + 1])
+    unsigned int *order = NULL;
+    unsigned int *sorted = NULL;    // 按键数量从大到小排列的桶
+    unsigned int *by_size = NULL;
+    uint64_t *taken = NULL;         // 已占用的槽
+    unsigned int pos[64];
+    unsigned int max_size = 0;
+    unsigned int size = 0;
+    unsigned int free_slot = 0;
+    unsigned int b = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+    unsigned int t = 0;
+    uint32_t pilot = 0;
+    bool ok = false;
+
+    start = (unsigned int*)malloc(sizeof(unsigned int) * (nb + 1) * 2);
+    order = (unsigned int*)malloc(sizeof(unsigned int) * (m + nb));
+    taken = (uint64_t*)malloc(sizeof(uint64_t) * (m / 64 + 1));
+    if(unlikely(!start || !order || !taken))
+    {
+        goto out;
+    }
+    sorted = start + nb + 1;
+    memset(start, 0, sizeof(unsigned int) * (nb + 1));
+    memset(taken, 0, sizeof(uint64_t) * (m / 64 + 1));
+
+    // 计数排序，把键按桶分组
+    for(i = 0; i < m; ++ i)
+    {
+        ++ start[frozen_bucket(ft->seed, nb, uniq[i].hash) + 1];
+    }
+    for(b = 0; b < nb; ++ b)
+    {
+        if(start[b + 1] > max_size)
+        {
+            max_size = start[b + 1];
+        }
+        start[b + 1] += start[b];
+        sorted[b] = start[b];
+    }
+    // 种子很差时单个桶过大，换种子重试
+    if(max_size >= sizeof(pos) / sizeof(pos[0]))
+    {
+        goto out;
+    }
+    for(i = 0; i < m; ++ i)
+    {
+        order[sorted[frozen_bucket(ft->seed, nb, uniq[i].hash)] ++] = i;
+    }
+
+    // 再按键数量从大到小计数排序桶，pos暂存各档的起点
+    by_size = order + m;
+    memset(pos, 0, sizeof(pos));
+    for(b = 0; b < nb; ++ b)
+    {
+        ++ pos[max_size - (start[b + 1] - start[b])];
+    }
+    for(i = 0, j = 0; i <= max_size; ++ i)
+    {
+        t = pos[i];
+        pos[i] = j;
+        j += t;
+    }
+    for(b = 0; b < nb; ++ b)
+    {
+        by_size[pos[max_size - (start[b + 1] - start[b])] ++] = b;
+    }
+    memcpy(sorted, by_size, sizeof(unsigned int) * nb);
+
+    for(i = 0; i < nb; ++ i)
+    {
+        b = sorted[i];
+        size = start[b + 1] - start[b];
+        ft->pilots[b] = 0;
+
+        if(size < 2)
+        {
+            if(1 == size)
+            {
+                // 单键桶：直接放入下一个空槽
+                while(taken[free_slot / 64] & (1ull << (free_slot % 64)))
+                {
+                    ++ free_slot;
+                }
+                ft->pilots[b] = FROZEN_DIRECT | free_slot;
+                frozen_fill(ft, free_slot, &uniq[order[start[b]]]);
+                taken[free_slot / 64] |= 1ull << (free_slot % 64);
+            }
+            continue;
+        }
+
+        for(pilot = 0; pilot < FROZEN_MAX_PILOT; ++ pilot)
+        {
+            for(t = 0; t < size; ++ t)
+            {
+                pos[t] = frozen_slot(ft->seed, m, uniq[order[start[b] + t]].hash, pilot);
+                if(taken[pos[t] / 64] & (1ull << (pos[t] % 64)))
+                {
+                    break;
+                }
+                for(j = 0; j < t && pos[j] != pos[t]; ++ j);
+                if(j < t)
+                {
+                    break;
+                }
+            }
+            if(t == size)
+            {
+                break;
+            }
+        }
+        if(pilot == FROZEN_MAX_PILOT)
+        {
+            goto out;
+        }
+
+        ft->pilots[b] = pilot;
+        for(t = 0; t < size; ++ t)
+        {
+            frozen_fill(ft, pos[t], &uniq[order[start[b] + t]]);
+            taken[pos[t] / 64] |= 1ull << (pos[t] % 64);
+        }
+    }
+    ok = true;
+
+out:
+    free(taken);
+    free(order);
+    free(start);
+    return ok;
+}
+
+// 把哈希表转换为只读的完美哈希表，原表不变，键和值与原表共享
+static hash_table* _frozen_create(IN hash_table *hs)
+{
+    frozen_collect_ctx fc;
+    frozen_hash_table *ft = NULL;
+    uint8_t *mem = NULL;
+    unsigned int size = 0;
+    unsigned int m = 0;
+    unsigned int run = 0;
+    unsigned int i = 0;
+    unsigned int k = 0;
+    int attempt = 0;
+
+    if(unlikely(!hs || !hs->cmp))
+    {
+        return NULL;
+    }
+
+    memset(&fc, 0, sizeof(fc));
+    hash_table_get_size(hs, &size);
+    fc.hs = hs;
+    fc.capacity = size + 16;
+    fc.ret = OK;
+    fc.entries = (frozen_build_entry*)malloc(sizeof(frozen_build_entry) * fc.capacity);
+    if(unlikely(!fc.entries))
+    {
+        return NULL;
+    }
+
+    hash_table_foreach(hs, frozen_collect, &fc);
+    if(unlikely(OK != fc.ret))
+    {
+        goto error;
+    }
+
+    // 按哈希值排序，哈希值相同的元素只有第一个参与完美哈希，其余放入溢出区
+    qsort(fc.entries, fc.count, sizeof(frozen_build_entry), frozen_entry_cmp);
+    for(i = 0; i < fc.count; ++ i)
+    {
+        if(0 == i || fc.entries[i].hash != fc.entries[i - 1].hash)
+        {
+            ++ m;
+        }
+    }
+
+    // 表头|对齐|槽数组|溢出区|溢出区哈希值|位移数组|标签数组
+    mem = (uint8_t*)malloc(sizeof(frozen_hash_table) + 64 + sizeof(frozen_entry) * fc.count +
+                           sizeof(uint64_t) * (fc.count - m) + sizeof(uint32_t) * (m / FROZEN_LAMBDA + 1) +
+                           sizeof(uint16_t) * m);
+    if(unlikely(!mem))
+    {
+        goto error;
+    }
+
+    ft = (frozen_hash_table*)mem;
+    ft->base = *hs;
+    ft->base.ops = &hash_table_frozen_operations;
+    ft->count = fc.count;
+    ft->slot_count = m;
+    ft->bucket_count = m / FROZEN_LAMBDA + 1;
+    ft->max_chain = fc.count ? 1 : 0;
+    ft->slots = (frozen_entry*)(((uintptr_t)(mem + sizeof(frozen_hash_table)) + 63) & ~(uintptr_t)63);
+    ft->overflow = ft->slots + m;
+    ft->overflow_hashes = (uint64_t*)(ft->slots + fc.count);
+    ft->pilots = (uint32_t*)(ft->overflow_hashes + (fc.count - m));
+    ft->tags = (uint16_t*)(ft->pilots + ft->bucket_count);
+
+    // 原地压缩：每组第一个元素移到数组前部，其余依次写入溢出区
+    for(i = 0, m = 0; i < fc.count; ++ i)
+    {
+        if(0 == i || fc.entries[i].hash != fc.entries[i - 1].hash)
+        {
+            fc.entries[m ++] = fc.entries[i];
+            run = 1;
+        }
+        else
+        {
+            ft->overflow[k].key = fc.entries[i].key;
+            ft->overflow[k].value = fc.entries[i].value;
+            ft->overflow_hashes[k ++] = fc.entries[i].hash;
+            if(++ run > ft->max_chain)
+            {
+                ft->max_chain = run;
+            }
+        }
+    }
+
+    for(attempt = 0; attempt < FROZEN_MAX_ATTEMPTS; ++ attempt)
+    {
+        ft->seed = hash_table_random_seed();
+        if(frozen_place(ft, fc.entries))
+        {
+            // 溢出区中有相同哈希值的槽打上标记
+            for(k = 0; k < ft->count - ft->slot_count; ++ k)
+            {
+                ft->tags[frozen_locate(ft, ft->overflow_hashes[k])] |= FROZEN_TAG_OVERFLOW;
+            }
+            free(fc.entries);
+            return &ft->base;
+        }
+    }
+    DBG("build perfect hash of %u keys fail", ft->slot_count);
+
+error:
+    free(mem);
+    free(fc.entries);
+    return NULL;
+}
+
+// 销毁冻结的哈希表，一次释放
+static STATUS _frozen_destroy(IN hash_table *hs)
+{
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    free(hs);
+
+    return OK;
+}
+
+// 检查键是否存在，不加锁
+static bool _frozen_contain(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    if(unlikely(!hs))
+    {
+        return false;
+    }
+
+    return NULL != frozen_find((frozen_hash_table*)hs, key);
+}
+
+// 查找键对应的值，不加锁
+static void* _frozen_get(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    frozen_entry *e = NULL;
+
+    if(unlikely(!hs))
+    {
+        return NULL;
+    }
+
+    e = frozen_find((frozen_hash_table*)hs, key);
+
+    return e ? e->value : NULL;
+}
+
+// 批量查找，每轮先定位FROZEN_BATCH个键的槽并预取，再逐个比较。found和values可以为NULL
+static void frozen_find_batch(
+    IN frozen_hash_table *ft,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found,
+    OUT void **values
+)
+{
+    uint64_t hashes[FROZEN_BATCH];
+    unsigned int slots[FROZEN_BATCH];
+    frozen_entry *e = NULL;
+    unsigned int base = 0;
+    unsigned int n = 0;
+    unsigned int i = 0;
+
+    for(base = 0; base < count; base += n)
+    {
+        n = (count - base < FROZEN_BATCH) ? count - base : FROZEN_BATCH;
+
+        for(i = 0; i < n; ++ i)
+        {
+            slots[i] = UINT_MAX;
+            if(keys[base + i] && ft->slot_count)
+            {
+                hashes[i] = frozen_key_hash(&ft->base, keys[base + i]);
+                slots[i] = frozen_locate(ft, hashes[i]);
+                prefetch(&ft->tags[slots[i]]);
+                prefetch(&ft->slots[slots[i]]);
+            }
+        }
+
+        for(i = 0; i < n; ++ i)
+        {
+            e = (UINT_MAX != slots[i]) ? frozen_find_slot(ft, slots[i], keys[base + i], hashes[i]) : NULL;
+            if(found)
+            {
+                found[base + i] = (NULL != e);
+            }
+            if(values)
+            {
+                values[base + i] = e ? e->value : NULL;
+            }
+        }
+    }
+}
+
+// 批量检查键是否存在
+static STATUS _frozen_contain_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found
+)
+{
+    if(unlikely(!hs || !keys || !found))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    frozen_find_batch((frozen_hash_table*)hs, keys, count, found, NULL);
+
+    return OK;
+}
+
+// 批量查找键对应的值
+static STATUS _frozen_get_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT void **values
+)
+{
+    if(unlikely(!hs || !keys || !values))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    frozen_find_batch((frozen_hash_table*)hs, keys, count, NULL, values);
+
+    return OK;
+}
+
+// 以下修改操作一律返回ERR_HASH_TABLE_FROZEN
+
+static STATUS _frozen_put(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **old_value
+)
+{
+    (void)hs; (void)key; (void)value; (void)old_value;
+    return ERR_HASH_TABLE_FROZEN;
+}
+
+static STATUS _frozen_pop(
+    IN hash_table *hs,
+    IN void *key,
+    OUT void **old_value
+)
+{
+    (void)hs; (void)key; (void)old_value;
+    return ERR_HASH_TABLE_FROZEN;
+}
+
+static STATUS _frozen_compute_if_absent(
+    IN hash_table *hs,
+    IN void *key,
+    IN hash_table_compute_func func,
+    IN void *ctx,
+    OUT void **result
+)
+{
+    (void)hs; (void)key; (void)func; (void)ctx; (void)result;
+    return ERR_HASH_TABLE_FROZEN;
+}
+
+static STATUS _frozen_insert_batch(
+    IN hash_table *hs,
+    IN void **data,
+    IN unsigned int count,
+    OUT unsigned int *inserted
+)
+{
+    (void)hs; (void)data; (void)count;
+    if(inserted)
+    {
+        *inserted = 0;
+    }
+    return ERR_HASH_TABLE_FROZEN;
+}
+
+static STATUS _frozen_reserve(
+    IN hash_table *hs,
+    IN unsigned int count
+)
+{
+    (void)hs; (void)count;
+    return ERR_HASH_TABLE_FROZEN;
+}
+
+// 获取元素数量
+static STATUS _frozen_get_size(
+    IN hash_table *hs,
+    OUT unsigned int *size
+)
+{
+    if(unlikely(!hs || !size))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    *size = ((frozen_hash_table*)hs)->count;
+
+    return OK;
+}
+
+// 获取统计信息，桶数量为槽数量，最长链为哈希值相同的元素最多的一组
+static STATUS _frozen_get_stats(
+    IN hash_table *hs,
+    OUT hash_table_stats *stats
+)
+{
+    frozen_hash_table *ft = (frozen_hash_table*)hs;
+
+    if(unlikely(!hs || !stats))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    stats->size = ft->count;
+    stats->bucket_count = ft->slot_count;
+    stats->load_factor = ft->slot_count ? (double)ft->count / ft->slot_count : 0;
+    stats->max_chain = ft->max_chain;
+
+    return OK;
+}
+
+// 迭代器前进，槽数组和溢出区连续存放，按下标顺序遍历，不加锁
+static bool _frozen_iter_next(
+    IN hash_table_iter *it,
+    OUT void **key,
+    OUT void **value
+)
+{
+    frozen_hash_table *ft = (frozen_hash_table*)it->hs;
+
+    if(it->segment > 0 || it->index >= ft->count)
+    {
+        it->segment = 1;
+        return false;
+    }
+
+    if(key)     *key = ft->slots[it->index].key;
+    if(value)   *value = ft->slots[it->index].value;
+    ++ it->index;
+
+    return true;
+}
+
+// 结束迭代
+static void _frozen_iter_end(IN hash_table_iter *it)
+{
+    it->segment = 1;
+}
+
+// 槽中不存哈希值，按下标把元素均分为parts段，遍历第part段
+static bool _frozen_foreach_part(
+    IN hash_table *hs,
+    IN unsigned int part,
+    IN unsigned int parts,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    frozen_hash_table *ft = (frozen_hash_table*)hs;
+    unsigned int i = (unsigned int)((uint64_t)ft->count * part / parts);
+    unsigned int end = (unsigned int)((uint64_t)ft->count * (part + 1) / parts);
+    bool ret = true;
+
+    for(; ret && i < end; ++ i)
+    {
+        ret = visit(ft->slots[i].key, ft->slots[i].value, ctx);
+    }
+
+    return ret;
+}
+
+// 打印哈希表，按槽输出
+static void _frozen_display(
+    IN hash_table *hs
+)
+{
+    frozen_hash_table *ft = (frozen_hash_table*)hs;
+    unsigned int i = 0;
+
+    if(unlikely(!hs))
+    {
+        DBG("bad param");
+        return;
+    }
+
+    for(; i < ft->count; ++ i)
+    {
+        if(i == ft->slot_count)
+        {
+            printf("\r\noverflow:");
+        }
+        if(hs->show)
+        {
+            hs->show(ft->slots[i].key);
+        }
+        printf("-->");
+    }
+    printf("\r\n");
+}
+
+/*
+    Variables
+*/
+
+// 冻结的哈希表操作集合
+hash_table_ops hash_table_frozen_operations = {
+    .hash_table_freeze = _frozen_create,
+    .hash_table_destroy = _frozen_destroy,
+    .hash_table_put = _frozen_put,
+    .hash_table_get = _frozen_get,
+    .hash_table_get_or_insert = _frozen_put,
+    .hash_table_pop = _frozen_pop,
+    .hash_table_compute_if_absent = _frozen_compute_if_absent,
+    .hash_table_contain = _frozen_contain,
+    .hash_table_contain_batch = _frozen_contain_batch,
+    .hash_table_get_batch = _frozen_get_batch,
+    .hash_table_insert_batch = _frozen_insert_batch,
+    .hash_table_reserve = _frozen_reserve,
+    .hash_table_get_size = _frozen_get_size,
+    .hash_table_get_stats = _frozen_get_stats,
+    .hash_table_iter_next = _frozen_iter_next,
+    .hash_table_iter_end = _frozen_iter_end,
+    .hash_table_foreach_part = _frozen_foreach_part,
+    .hash_table_display = _frozen_display,
+};
+
+// 冻结的哈希表测试
+#if HASH_TABLE_TEST
+
+#define FROZEN_TEST_KEYS    (20000)
+
+static unsigned int frozen_test_hash(void *data)
+{
+    return (unsigned int)*((int*)data);
+}
+
+static unsigned int frozen_test_bad_hash(void *data)
+{
+    return (unsigned int)*((int*)data) % 11;
+}
+
+static uint64_t frozen_test_seeded_hash(void *data, uint64_t seed)
+{
+    return hash_table_hash_u64((uint64_t)*((int*)data), seed);
+}
+
+static void frozen_test_display(void *data)
+{
+    printf("%d", *((int*)data));
+}
+
+static bool frozen_test_cmp(void *d1, void *d2)
+{
+    if(!d1 || !d2)  return false;
+    return *(int*)d1 == *(int*)d2;
+}
+
+static bool frozen_test_sum(void *key, void *value, void *ctx)
+{
+    (void)value;
+    *(long*)ctx += *(int*)key;
+    return true;
+}
+
+void hash_table_frozen_test()
+{
+#if CMOCKA_TEST
+    static int a[FROZEN_TEST_KEYS];
+    static int b[FROZEN_TEST_KEYS];
+    void *keys[100];
+    void *values[100];
+    bool found[100];
+    hash_table *hs = NULL;
+    hash_table *fz = NULL;
+    hash_table_iter it;
+    hash_table_stats stats;
+    void *key = NULL;
+    void *value = NULL;
+    unsigned int size = 0;
+    int miss = -1;
+    long sum = 0;
+    int i = 0;
+
+    for(i = 0; i < FROZEN_TEST_KEYS; ++ i)
+    {
+        a[i] = i;
+        b[i] = i * 2;
+    }
+
+    assert_null(hash_table_freeze(NULL));
+    assert_int_equal(2 * sizeof(void*), sizeof(frozen_entry));
+
+    // 冻结后原表不变，销毁原表不影响冻结的表
+    hs = hash_table_create_seeded(HASH_TABLE_CHAIN, 64, frozen_test_seeded_hash, frozen_test_cmp, frozen_test_display);
+    assert_non_null(hs);
+    for(i = 0; i < FROZEN_TEST_KEYS; ++ i)
+        assert_int_equal(OK, hash_table_put(hs, &a[i], &b[i], NULL));
+    fz = hash_table_freeze(hs);
+    assert_non_null(fz);
+    assert_true(hash_table_contain(hs, &a[0]));
+    assert_return_code(OK, hash_table_destroy(hs));
+
+    assert_int_equal(OK, hash_table_get_size(fz, &size));
+    assert_int_equal(FROZEN_TEST_KEYS, size);
+    for(i = 0; i < FROZEN_TEST_KEYS; ++ i)
+    {
+        assert_true(hash_table_contain(fz, &a[i]));
+        assert_ptr_equal(&b[i], hash_table_get(fz, &a[i]));
+    }
+    assert_false(hash_table_contain(fz, &miss));
+    assert_false(hash_table_contain(fz, NULL));
+    assert_null(hash_table_get(fz, &miss));
+
+    assert_int_equal(OK, hash_table_get_stats(fz, &stats));
+    assert_int_equal(FROZEN_TEST_KEYS, stats.size);
+    assert_int_equal(FROZEN_TEST_KEYS, stats.bucket_count);
+    assert_int_equal(1, stats.max_chain);
+
+    // 批量查找，穿插不存在的键
+    for(i = 0; i < 100; ++ i)
+        keys[i] = (i % 10 == 9) ? (void*)&miss : (void*)&a[i * 37];
+    assert_int_equal(OK, hash_table_contain_batch(fz, keys, 100, found));
+    assert_int_equal(OK, hash_table_get_batch(fz, keys, 100, values));
+    for(i = 0; i < 100; ++ i)
+    {
+        assert_int_equal(i % 10 != 9, found[i]);
+        assert_ptr_equal((i % 10 == 9) ? NULL : (void*)&b[i * 37], values[i]);
+    }
+
+    // 只读
+    assert_int_equal(ERR_HASH_TABLE_FROZEN, hash_table_insert(fz, &miss));
+    assert_int_equal(ERR_HASH_TABLE_FROZEN, hash_table_put(fz, &a[1], &b[2], NULL));
+    assert_int_equal(ERR_HASH_TABLE_FROZEN, hash_table_remove(fz, &a[1]));
+    assert_int_equal(ERR_HASH_TABLE_FROZEN, hash_table_reserve(fz, 100));
+    assert_int_equal(ERR_HASH_TABLE_FROZEN, hash_table_insert_batch(fz, keys, 1, &size));
+    assert_int_equal(0, size);
+    assert_ptr_equal(&b[1], hash_table_get(fz, &a[1]));
+
+    // 遍历
+    assert_int_equal(OK, hash_table_foreach(fz, frozen_test_sum, &sum));
+    assert_int_equal((long)FROZEN_TEST_KEYS * (FROZEN_TEST_KEYS - 1) / 2, sum);
+    sum = 0;
+    assert_int_equal(OK, hash_table_iter_init(fz, &it));
+    while(hash_table_iter_next(&it, &key, &value))
+    {
+        assert_ptr_equal(&b[*(int*)key], value);
+        sum += *(int*)key;
+    }
+    hash_table_iter_end(&it);
+    assert_int_equal((long)FROZEN_TEST_KEYS * (FROZEN_TEST_KEYS - 1) / 2, sum);
+
+    // 再次冻结
+    hs = hash_table_freeze(fz);
+    assert_non_null(hs);
+    assert_return_code(OK, hash_table_destroy(fz));
+    for(i = 0; i < FROZEN_TEST_KEYS; i += 7)
+        assert_ptr_equal(&b[i], hash_table_get(hs, &a[i]));
+    assert_return_code(OK, hash_table_destroy(hs));
+
+    // 用户哈希值大量相同时，相同哈希值的其余元素进入溢出区
+    hs = hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 16, frozen_test_bad_hash, frozen_test_cmp, frozen_test_display);
+    assert_non_null(hs);
+    for(i = 0; i < 100; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    fz = hash_table_freeze(hs);
+    assert_non_null(fz);
+    assert_int_equal(OK, hash_table_get_stats(fz, &stats));
+    assert_int_equal(100, stats.size);
+    assert_int_equal(11, stats.bucket_count);
+    assert_int_equal(10, stats.max_chain);
+    for(i = 0; i < FROZEN_TEST_KEYS; ++ i)
+        assert_int_equal(i < 100, hash_table_contain(fz, &a[i]));
+    hash_table_display(fz);
+    sum = 0;
+    assert_int_equal(OK, hash_table_foreach(fz, frozen_test_sum, &sum));
+    assert_int_equal(100 * 99 / 2, sum);
+    // 没有打印函数时只打印布局
+    fz->show = NULL;
+    hash_table_display(fz);
+    assert_return_code(OK, hash_table_destroy(fz));
+    assert_return_code(OK, hash_table_destroy(hs));
+
+    // 空表
+    hs = hash_table_create(16, frozen_test_hash, frozen_test_cmp, NULL);
+    assert_non_null(hs);
+    fz = hash_table_freeze(hs);
+    assert_non_null(fz);
+    assert_int_equal(OK, hash_table_get_size(fz, &size));
+    assert_int_equal(0, size);
+    assert_false(hash_table_contain(fz, &a[0]));
+    assert_int_equal(OK, hash_table_get_batch(fz, keys, 100, values));
+    assert_null(values[0]);
+    assert_int_equal(OK, hash_table_iter_init(fz, &it));
+    assert_false(hash_table_iter_next(&it, NULL, NULL));
+    assert_return_code(OK, hash_table_destroy(fz));
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+#endif
@@ -0,0 +1,207 @@
+/*
+    Include files
+*/
+
+#define _POSIX_C_SOURCE 200112L     // clock_gettime
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "hash_table.h"
+
+/*
+    Defines
+*/
+
+// wyhash使用的常数
+#define WY_P0   (0x2d358dccaa6c78a5ull)
+#define WY_P1   (0x8bb84b93962eacc9ull)
+#define WY_P2   (0x4b33a62ed433d4a3ull)
+#define WY_P3   (0x4d5a2da51de1aa47ull)
+
+/*
+    Functions
+*/
+
+// 64位乘法得到128位结果，返回高低两半的异或
+static inline uint64_t wy_mix(
+    IN uint64_t a,
+    IN uint64_t b
+)
+{
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+
+    c += lo < t;
+    return lo ^ (rh + (rm0 >> 32) + (rm1 >> 32) + c);
+#endif
+}
+
+// 按本机字节序读取，不要求对齐
+static inline uint64_t wy_r8(IN const uint8_t *p)
+{
+    uint64_t v = 0;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t wy_r4(IN const uint8_t *p)
+{
+    uint32_t v = 0;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// 读取1~3个字节
+static inline uint64_t wy_r3(
+    IN const uint8_t *p,
+    IN size_t k
+)
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+// 字节串哈希，算法为wyhash
+uint64_t hash_table_hash_bytes(
+    IN const void *data,
+    IN size_t len,
+    IN uint64_t seed
+)
+{
+    const uint8_t *p = (const uint8_t*)data;
+    uint64_t see1 = 0;
+    uint64_t see2 = 0;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    size_t i = len;
+
+    seed ^= wy_mix(seed ^ WY_P0, WY_P1);
+
+    if(likely(len <= 16))
+    {
+        if(likely(len >= 4))
+        {
+            a = (wy_r4(p) << 32) | wy_r4(p + ((len >> 3) << 2));
+            b = (wy_r4(p + len - 4) << 32) | wy_r4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if(likely(len > 0))
+        {
+            a = wy_r3(p, len);
+        }
+    }
+    else
+    {
+        // 长输入用三条独立的链并行吸收，每轮48字节
+        if(unlikely(i > 48))
+        {
+            see1 = seed;
+            see2 = seed;
+            do
+            {
+                seed = wy_mix(wy_r8(p) ^ WY_P1, wy_r8(p + 8) ^ seed);
+                see1 = wy_mix(wy_r8(p + 16) ^ WY_P2, wy_r8(p + 24) ^ see1);
+                see2 = wy_mix(wy_r8(p + 32) ^ WY_P3, wy_r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            }while(likely(i > 48));
+            seed ^= see1 ^ see2;
+        }
+        while(unlikely(i > 16))
+        {
+            seed = wy_mix(wy_r8(p) ^ WY_P1, wy_r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wy_r8(p + i - 16);
+        b = wy_r8(p + i - 8);
+    }
+
+    return wy_mix(WY_P1 ^ len, wy_mix(a ^ WY_P1, b ^ seed));
+}
+
+// 64位整数哈希
+uint64_t hash_table_hash_u64(
+    IN uint64_t v,
+    IN uint64_t seed
+)
+{
+    return wy_mix(wy_mix(v ^ WY_P0, seed ^ WY_P1) ^ WY_P0, seed ^ WY_P2);
+}
+
+// 键指向int
+uint64_t hash_table_hash_int(
+    IN void *key,
+    IN uint64_t seed
+)
+{
+    return hash_table_hash_u64((uint64_t)(int64_t)*(int*)key, seed);
+}
+
+// 键本身即指针，按地址哈希
+uint64_t hash_table_hash_ptr(
+    IN void *key,
+    IN uint64_t seed
+)
+{
+    return hash_table_hash_u64((uint64_t)(uintptr_t)key, seed);
+}
+
+// 键指向'\0'结尾的字符串
+uint64_t hash_table_hash_str(
+    IN void *key,
+    IN uint64_t seed
+)
+{
+    return hash_table_hash_bytes(key, strlen((const char*)key), seed);
+}
+
+// 与hash_table_hash_int配套的比较函数
+bool hash_table_cmp_int(
+    IN void *d1,
+    IN void *d2
+)
+{
+    return *(int*)d1 == *(int*)d2;
+}
+
+// 与hash_table_hash_ptr配套的比较函数
+bool hash_table_cmp_ptr(
+    IN void *d1,
+    IN void *d2
+)
+{
+    return d1 == d2;
+}
+
+// 与hash_table_hash_str配套的比较函数
+bool hash_table_cmp_str(
+    IN void *d1,
+    IN void *d2
+)
+{
+    return 0 == strcmp((const char*)d1, (const char*)d2);
+}
+
+// 生成随机种子：时间、计数器和栈地址经过splitmix64混合，每次调用结果不同
+uint64_t hash_table_random_seed(void)
+{
+    static atomic_ullong counter = 0;
+    struct timespec ts;
+    uint64_t x = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    x = ((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec) ^ (uint64_t)(uintptr_t)&ts;
+    x += (atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed) + 1) * 0x9E3779B97F4A7C15ull;
+
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
@@ -0,0 +1,1166 @@
+/*
+    Include files
+*/
+
+#define _POSIX_C_SOURCE 200112L     // pthread_rwlock_t
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "hash_table_engine.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+    Defines
+*/
+
+#define OA_GROUP_WIDTH      (16)                // 每组槽数，对应一个SSE2寄存器
+#define OA_CTRL_EMPTY       ((int8_t)-128)      // 0x80，空槽
+#define OA_CTRL_DELETED     ((int8_t)-2)        // 0xFE，墓碑
+#define OA_NOT_FOUND        (0xFFFFFFFFu)       // 查找失败
+#define OA_CAPACITY_MAX     (0x80000000u)       // 最大槽数
+#define OA_BATCH            (16)                // 批量操作每轮处理的键数量
+
+// 最大负载因子7/8
+#define OA_MAX_LOAD(cap)    ((cap) - (cap) / 8)
+
+// 哈希值高位用于定位组，低7位作为控制字节中的哈希片段
+#define OA_H1(h)            ((unsigned int)((h) >> 7))
+#define OA_H2(h)            ((int8_t)((h) & 0x7F))
+
+#define OA_RLOCK(ht)        pthread_rwlock_rdlock(&(ht)->lock)
+#define OA_WLOCK(ht)        pthread_rwlock_wrlock(&(ht)->lock)
+#define OA_UNLOCK(ht)       pthread_rwlock_unlock(&(ht)->lock)
+
+// 元素数量只在写锁内修改，因此用load+store代替原子加减；读取不需要加锁
+#define OA_SIZE(ht)         atomic_load_explicit(&(ht)->size, memory_order_relaxed)
+#define OA_SIZE_ADD(ht, n)  atomic_store_explicit(&(ht)->size, OA_SIZE(ht) + (n), memory_order_relaxed)
+
+/*
+    typedefs
+*/
+
+// 槽，键和值存放在一起，命中后无需再次访存
+typedef struct
+{
+    void *key;                  // 键，用于计算哈希值和比较
+    void *value;                // 值，集合用法中与键相同
+    uint64_t hash;              // 混淆后的完整哈希值，比较前先比它，重建时直接复用
+}oa_entry;
+
+// 开放寻址法哈希表结构
+typedef struct
+{
+    hash_table base;            // 公共头部
+
+    pthread_rwlock_t lock;      // 读写锁，查找共享，增删独占
+
+    int8_t *ctrl;               // 控制字节数组，每个槽一个字节
+    oa_entry *slots;            // 槽数组，存放键值对，与ctrl同一块内存
+
+    unsigned int capacity;      // 槽数量，2的幂且不小于OA_GROUP_WIDTH
+    unsigned int min_capacity;  // 缩容下限，创建时的容量或reserve的容量
+    atomic_uint size;           // 元素数量
+    unsigned int growth_left;   // 不触发扩容还能占用的空槽数
+}oa_hash_table;
+
+/*
+    Functions
+*/
+
+// 对用户哈希值做一次乘法混淆，避免用户哈希分布差时聚集
+static inline uint64_t oa_hash(
+    IN oa_hash_table *ht,
+    IN void *data
+)
+{
+    uint64_t h = (uint64_t)hash_table_hash(&ht->base, data) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+#if defined(__SSE2__)
+
+// 组内匹配控制字节，返回命中槽的位图
+static inline uint32_t oa_group_match(
+    IN const int8_t *group,
+    IN int8_t h2
+)
+{
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+// 组内空槽或墓碑的位图，两者最高位均为1
+static inline uint32_t oa_group_match_free(IN const int8_t *group)
+{
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+
+#else
+
+static inline uint32_t oa_group_match(
+    IN const int8_t *group,
+    IN int8_t h2
+)
+{
+    uint32_t mask = 0;
+    unsigned int i = 0;
+
+    for(; i < OA_GROUP_WIDTH; ++ i)
+    {
+        if(group[i] == h2)  mask |= (1u << i);
+    }
+
+    return mask;
+}
+
+static inline uint32_t oa_group_match_free(IN const int8_t *group)
+{
+    uint32_t mask = 0;
+    unsigned int i = 0;
+
+    for(; i < OA_GROUP_WIDTH; ++ i)
+    {
+        if(group[i] < 0)    mask |= (1u << i);
+    }
+
+    return mask;
+}
+
+#endif
+
+// 组内空槽的位图
+static inline uint32_t oa_group_match_empty(IN const int8_t *group)
+{
+    return oa_group_match(group, OA_CTRL_EMPTY);
+}
+
+// 能容纳n个元素的最小槽数
+static unsigned int oa_capacity_for(IN unsigned int n)
+{
+    unsigned int cap = OA_GROUP_WIDTH;
+
+    while(OA_MAX_LOAD(cap) < n && cap < OA_CAPACITY_MAX)
+    {
+        cap <<= 1;
+    }
+
+    return cap;
+}
+
+// 查找键所在槽，探测序列以组为单位做三角数跳跃，组数为2的幂时可覆盖所有组
+static unsigned int oa_find(
+    IN oa_hash_table *ht,
+    IN void *key,
+    IN uint64_t h
+)
+{
+    unsigned int group_mask = ht->capacity / OA_GROUP_WIDTH - 1;
+    unsigned int g = OA_H1(h) & group_mask;
+    unsigned int probe = 0;
+    unsigned int idx = 0;
+    const int8_t *group = NULL;
+    uint32_t match = 0;
+
+    for(; probe <= group_mask; ++ probe)
+    {
+        group = ht->ctrl + g * OA_GROUP_WIDTH;
+
+        // 只对哈希片段和完整哈希值都相同的槽调用比较函数
+        match = oa_group_match(group, OA_H2(h));
+        while(match)
+        {
+            idx = g * OA_GROUP_WIDTH + (unsigned int)__builtin_ctz(match);
+            if(ht->slots[idx].hash == h && ht->base.cmp(key, ht->slots[idx].key))
+            {
+                return idx;
+            }
+            match &= match - 1;
+        }
+
+        // 组内有空槽，说明数据从未越过该组
+        if(oa_group_match_empty(group))
+        {
+            return OA_NOT_FOUND;
+        }
+
+        g = (g + probe + 1) & group_mask;
+    }
+
+    return OA_NOT_FOUND;
+}
+
+// 沿探测序列找到第一个空槽或墓碑
+static unsigned int oa_find_free(
+    IN int8_t *ctrl,
+    IN unsigned int capacity,
+    IN uint64_t h
+)
+{
+    unsigned int group_mask = capacity / OA_GROUP_WIDTH - 1;
+    unsigned int g = OA_H1(h) & group_mask;
+    unsigned int probe = 0;
+    uint32_t match = 0;
+
+    for(; probe <= group_mask; ++ probe)
+    {
+        match = oa_group_match_free(ctrl + g * OA_GROUP_WIDTH);
+        if(match)
+        {
+            return g * OA_GROUP_WIDTH + (unsigned int)__builtin_ctz(match);
+        }
+
+        g = (g + probe + 1) & group_mask;
+    }
+
+    return OA_NOT_FOUND;
+}
+
+// 申请控制字节和槽数组，两者放在同一块内存
+static STATUS oa_alloc(
+    IN unsigned int capacity,
+    OUT int8_t **ctrl,
+    OUT oa_entry **slots
+)
+{
+    int8_t *mem = (int8_t*)malloc(capacity + sizeof(oa_entry) * capacity);
+    if(unlikely(!mem))
+    {
+        return ERR_NO_MEMORY;
+    }
+
+    memset(mem, OA_CTRL_EMPTY, capacity);
+    *ctrl = mem;
+    *slots = (oa_entry*)(mem + capacity);
+
+    return OK;
+}
+
+// 以新容量重建哈希表，同时清理墓碑，复用槽中保存的哈希值
+static STATUS oa_rehash(
+    IN oa_hash_table *ht,
+    IN unsigned int new_capacity
+)
+{
+    int8_t *ctrl = NULL;
+    oa_entry *slots = NULL;
+    unsigned int i = 0;
+    unsigned int idx = 0;
+    uint64_t h = 0;
+
+    if(unlikely(OK != oa_alloc(new_capacity, &ctrl, &slots)))
+    {
+        DBG("malloc space of %u slots fail", new_capacity);
+        return ERR_NO_MEMORY;
+    }
+
+    for(; i < ht->capacity; ++ i)
+    {
+        if(ht->ctrl[i] < 0)
+        {
+            continue;
+        }
+
+        h = ht->slots[i].hash;
+        idx = oa_find_free(ctrl, new_capacity, h);
+        ctrl[idx] = OA_H2(h);
+        slots[idx] = ht->slots[i];
+    }
+
+    free(ht->ctrl);
+    ht->ctrl = ctrl;
+    ht->slots = slots;
+    ht->capacity = new_capacity;
+    ht->growth_left = OA_MAX_LOAD(new_capacity) - OA_SIZE(ht);
+
+    return OK;
+}
+
+// 空槽用尽时调用：墓碑较多则原地重建，否则扩容一倍
+static STATUS oa_grow(IN oa_hash_table *ht)
+{
+    if(OA_SIZE(ht) <= OA_MAX_LOAD(ht->capacity) / 2)
+    {
+        return oa_rehash(ht, ht->capacity);
+    }
+
+    if(unlikely(ht->capacity >= OA_CAPACITY_MAX))
+    {
+        return ERR_NO_MEMORY;
+    }
+
+    return oa_rehash(ht, ht->capacity << 1);
+}
+
+// 创建哈希表，bucket_size为预期元素数量
+static hash_table* _oa_create(
+    IN unsigned int bucket_size,
+    IN hash_func hash,
+    IN cmp_func cmp,
+    IN hash_table_show_func show
+)
+{
+    oa_hash_table *ht = NULL;
+
+    if(unlikely(bucket_size == 0 || NULL == cmp))
+    {
+        DBG("bad in param for create hash table");
+        return NULL;
+    }
+
+    ht = (oa_hash_table*)malloc(sizeof(oa_hash_table));
+    if(unlikely(NULL == ht))
+    {
+        DBG("malloc space of hash table fail");
+        return NULL;
+    }
+    memset(ht, 0, sizeof(oa_hash_table));
+
+    ht->capacity = oa_capacity_for(bucket_size);
+    if(unlikely(OK != oa_alloc(ht->capacity, &ht->ctrl, &ht->slots)))
+    {
+        DBG("malloc space of %u slots fail", ht->capacity);
+        goto error;
+    }
+    ht->growth_left = OA_MAX_LOAD(ht->capacity);
+    ht->min_capacity = ht->capacity;
+    atomic_init(&ht->size, 0);
+
+    if(unlikely(0 != pthread_rwlock_init(&ht->lock, NULL)))
+    {
+        DBG("init rwlock fail");
+        goto error;
+    }
+
+    hash_table_base_init(&ht->base, &hash_table_oa_operations, hash, cmp, show);
+
+    return &ht->base;
+
+error:
+    if(ht->ctrl)    free(ht->ctrl);
+    free(ht);
+    return NULL;
+}
+
+// 销毁哈希表
+static STATUS _oa_destroy(IN hash_table *hs)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+
+    if(unlikely(!hs))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    pthread_rwlock_destroy(&ht->lock);
+    free(ht->ctrl);
+    free(ht);
+
+    return OK;
+}
+
+// 检查键是否存在表中
+static bool _oa_contain(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    bool ret = false;
+    uint64_t h = 0;
+
+    if(unlikely(!hs || !key))
+    {
+        return false;
+    }
+
+    h = oa_hash(ht, key);
+
+    OA_RLOCK(ht);
+    ret = (OA_NOT_FOUND != oa_find(ht, key, h));
+    OA_UNLOCK(ht);
+
+    return ret;
+}
+
+// 查找键，返回对应的值
+static void* _oa_get(
+    IN hash_table *hs,
+    IN void *key
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int idx = 0;
+    void *value = NULL;
+    uint64_t h = 0;
+
+    if(unlikely(!hs || !key))
+    {
+        return NULL;
+    }
+
+    h = oa_hash(ht, key);
+
+    OA_RLOCK(ht);
+    idx = oa_find(ht, key, h);
+    if(OA_NOT_FOUND != idx)
+    {
+        value = ht->slots[idx].value;
+    }
+    OA_UNLOCK(ht);
+
+    return value;
+}
+
+// 加入键值对，调用者持有写锁且已确认键不存在
+static STATUS oa_add(
+    IN oa_hash_table *ht,
+    IN void *key,
+    IN void *value,
+    IN uint64_t h
+)
+{
+    unsigned int idx = oa_find_free(ht->ctrl, ht->capacity, h);
+    STATUS ret = OK;
+
+    // 墓碑可以直接复用，占用空槽则需要检查负载
+    if(OA_CTRL_EMPTY == ht->ctrl[idx] && 0 == ht->growth_left)
+    {
+        ret = oa_grow(ht);
+        if(unlikely(OK != ret))
+        {
+            return ret;
+        }
+        idx = oa_find_free(ht->ctrl, ht->capacity, h);
+    }
+
+    if(OA_CTRL_EMPTY == ht->ctrl[idx])
+    {
+        -- ht->growth_left;
+    }
+    ht->ctrl[idx] = OA_H2(h);
+    ht->slots[idx].key = key;
+    ht->slots[idx].value = value;
+    ht->slots[idx].hash = h;
+    OA_SIZE_ADD(ht, 1);
+
+    return OK;
+}
+
+// 加入或替换键值对，相等的键哈希值相同，直接替换槽中的键值
+static STATUS _oa_put(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **old_value
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int idx = 0;
+    uint64_t h = 0;
+    void *found = NULL;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    h = oa_hash(ht, key);
+
+    OA_WLOCK(ht);
+
+    idx = oa_find(ht, key, h);
+    if(OA_NOT_FOUND != idx)
+    {
+        found = ht->slots[idx].value;
+        ht->slots[idx].key = key;
+        ht->slots[idx].value = value;
+    }
+    else
+    {
+        ret = oa_add(ht, key, value, h);
+    }
+
+    OA_UNLOCK(ht);
+
+    if(old_value)
+    {
+        *old_value = found;
+    }
+
+    return ret;
+}
+
+// 键不存在时加入键值对，返回表中的值
+static STATUS _oa_get_or_insert(
+    IN hash_table *hs,
+    IN void *key,
+    IN void *value,
+    OUT void **result
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int idx = 0;
+    uint64_t h = 0;
+    STATUS ret = ERR_HASH_TABLE_DATA_EXIST;
+
+    if(unlikely(!hs || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    h = oa_hash(ht, key);
+
+    OA_WLOCK(ht);
+
+    idx = oa_find(ht, key, h);
+    if(OA_NOT_FOUND != idx)
+    {
+        value = ht->slots[idx].value;
+    }
+    else
+    {
+        ret = oa_add(ht, key, value, h);
+    }
+
+    OA_UNLOCK(ht);
+
+    if(result)
+    {
+        *result = (OK == ret || ERR_HASH_TABLE_DATA_EXIST == ret) ? value : NULL;
+    }
+
+    return ret;
+}
+
+// 不存在时调用func生成数据并加入
+static STATUS _oa_compute_if_absent(
+    IN hash_table *hs,
+    IN void *key,
+    IN hash_table_compute_func func,
+    IN void *ctx,
+    OUT void **result
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int idx = 0;
+    uint64_t h = 0;
+    void *found = NULL;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || !key || !func || !result))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    h = oa_hash(ht, key);
+
+    OA_WLOCK(ht);
+
+    idx = oa_find(ht, key, h);
+    if(OA_NOT_FOUND != idx)
+    {
+        found = ht->slots[idx].value;
+    }
+    else
+    {
+        // 生成的数据同时作为键和值
+        found = func(key, ctx);
+        ret = found ? oa_add(ht, found, found, h) : ERR_HASH_TABLE_COMPUTE_FAIL;
+    }
+
+    OA_UNLOCK(ht);
+
+    *result = (OK == ret) ? found : NULL;
+
+    return ret;
+}
+
+// 移除键，返回旧值
+static STATUS _oa_pop(
+    IN hash_table *hs,
+    IN void *key,
+    OUT void **old_value
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int idx = 0;
+    uint64_t h = 0;
+    void *found = NULL;
+    STATUS ret = ERR_HASH_TABLE_DATA_NOT_EXIST;
+
+    if(unlikely(!hs || !key))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    h = oa_hash(ht, key);
+
+    OA_WLOCK(ht);
+
+    idx = oa_find(ht, key, h);
+    if(OA_NOT_FOUND != idx)
+    {
+        found = ht->slots[idx].value;
+
+        // 组内仍有空槽时，没有探测序列越过该组，可以直接置空；否则留下墓碑
+        if(oa_group_match_empty(ht->ctrl + (idx & ~(OA_GROUP_WIDTH - 1))))
+        {
+            ht->ctrl[idx] = OA_CTRL_EMPTY;
+            ++ ht->growth_left;
+        }
+        else
+        {
+            ht->ctrl[idx] = OA_CTRL_DELETED;
+        }
+        ht->slots[idx].key = NULL;
+        ht->slots[idx].value = NULL;
+        OA_SIZE_ADD(ht, -1);
+
+        // 负载因子低于1/8时缩容一半，失败不影响删除结果
+        if(ht->capacity > ht->min_capacity && OA_SIZE(ht) < ht->capacity / 8)
+        {
+            oa_rehash(ht, ht->capacity >> 1);
+        }
+        ret = OK;
+    }
+
+    OA_UNLOCK(ht);
+
+    if(old_value)
+    {
+        *old_value = found;
+    }
+
+    return ret;
+}
+
+// 预取键的起始组：控制字节和组内的槽，调用者持有锁
+static inline void oa_prefetch(
+    IN oa_hash_table *ht,
+    IN uint64_t h
+)
+{
+    unsigned int g = OA_H1(h) & (ht->capacity / OA_GROUP_WIDTH - 1);
+
+    prefetch(ht->ctrl + g * OA_GROUP_WIDTH);
+    prefetch(ht->slots + g * OA_GROUP_WIDTH);
+}
+
+// 批量查找，每轮先计算OA_BATCH个键的哈希值并预取，再逐个查找。found和values可以为NULL
+static void oa_find_batch(
+    IN oa_hash_table *ht,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found,
+    OUT void **values
+)
+{
+    uint64_t hashes[OA_BATCH];
+    unsigned int idx = 0;
+    unsigned int base = 0;
+    unsigned int n = 0;
+    unsigned int i = 0;
+
+    for(base = 0; base < count; base += n)
+    {
+        n = (count - base < OA_BATCH) ? count - base : OA_BATCH;
+
+        for(i = 0; i < n; ++ i)
+        {
+            hashes[i] = keys[base + i] ? oa_hash(ht, keys[base + i]) : 0;
+        }
+
+        OA_RLOCK(ht);
+
+        for(i = 0; i < n; ++ i)
+        {
+            oa_prefetch(ht, hashes[i]);
+        }
+
+        for(i = 0; i < n; ++ i)
+        {
+            idx = keys[base + i] ? oa_find(ht, keys[base + i], hashes[i]) : OA_NOT_FOUND;
+            if(found)
+            {
+                found[base + i] = (OA_NOT_FOUND != idx);
+            }
+            if(values)
+            {
+                values[base + i] = (OA_NOT_FOUND != idx) ? ht->slots[idx].value : NULL;
+            }
+        }
+
+        OA_UNLOCK(ht);
+    }
+}
+
+// 批量检查键是否存在
+static STATUS _oa_contain_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT bool *found
+)
+{
+    if(unlikely(!hs || !keys || !found))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    oa_find_batch((oa_hash_table*)hs, keys, count, found, NULL);
+
+    return OK;
+}
+
+// 批量查找键对应的值
+static STATUS _oa_get_batch(
+    IN hash_table *hs,
+    IN void **keys,
+    IN unsigned int count,
+    OUT void **values
+)
+{
+    if(unlikely(!hs || !keys || !values))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    oa_find_batch((oa_hash_table*)hs, keys, count, NULL, values);
+
+    return OK;
+}
+
+// 批量加入，已存在的数据跳过
+static STATUS _oa_insert_batch(
+    IN hash_table *hs,
+    IN void **data,
+    IN unsigned int count,
+    OUT unsigned int *inserted
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    uint64_t hashes[OA_BATCH];
+    unsigned int added = 0;
+    unsigned int base = 0;
+    unsigned int n = 0;
+    unsigned int i = 0;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || !data))
+    {
+        return ERR_BAD_PARAM;
+    }
+    for(i = 0; i < count; ++ i)
+    {
+        if(unlikely(!data[i]))
+        {
+            return ERR_BAD_PARAM;
+        }
+    }
+
+    for(base = 0; OK == ret && base < count; base += n)
+    {
+        n = (count - base < OA_BATCH) ? count - base : OA_BATCH;
+
+        for(i = 0; i < n; ++ i)
+        {
+            hashes[i] = oa_hash(ht, data[base + i]);
+        }
+
+        OA_WLOCK(ht);
+
+        for(i = 0; i < n; ++ i)
+        {
+            oa_prefetch(ht, hashes[i]);
+        }
+
+        for(i = 0; OK == ret && i < n; ++ i)
+        {
+            if(OA_NOT_FOUND == oa_find(ht, data[base + i], hashes[i]))
+            {
+                ret = oa_add(ht, data[base + i], data[base + i], hashes[i]);
+                added += (OK == ret);
+            }
+        }
+
+        OA_UNLOCK(ht);
+    }
+
+    if(inserted)
+    {
+        *inserted = added;
+    }
+
+    return ret;
+}
+
+// 预留容量，保证容纳count个元素前不再扩容，且缩容不低于该规模
+static STATUS _oa_reserve(
+    IN hash_table *hs,
+    IN unsigned int count
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int capacity = 0;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || 0 == count))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    capacity = oa_capacity_for(count);
+
+    OA_WLOCK(ht);
+
+    if(capacity > ht->min_capacity)
+    {
+        ht->min_capacity = capacity;
+    }
+    if(capacity > ht->capacity)
+    {
+        ret = oa_rehash(ht, capacity);
+    }
+
+    OA_UNLOCK(ht);
+
+    return ret;
+}
+
+// 获取哈希表元素总数
+static STATUS _oa_get_size(
+    IN hash_table *hs,
+    OUT unsigned int *size
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+
+    if(unlikely(!hs || !size))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    *size = OA_SIZE(ht);
+
+    return OK;
+}
+
+// 槽所在组在探测序列中的位置，即查找该槽需要探测的组数
+static unsigned int oa_probe_length(
+    IN oa_hash_table *ht,
+    IN unsigned int idx
+)
+{
+    unsigned int group_mask = ht->capacity / OA_GROUP_WIDTH - 1;
+    unsigned int g = OA_H1(ht->slots[idx].hash) & group_mask;
+    unsigned int probe = 0;
+
+    while(g != idx / OA_GROUP_WIDTH && probe < group_mask)
+    {
+        ++ probe;
+        g = (g + probe) & group_mask;
+    }
+
+    return probe + 1;
+}
+
+// 获取统计信息，最长链为最长的探测组数
+static STATUS _oa_get_stats(
+    IN hash_table *hs,
+    OUT hash_table_stats *stats
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int len = 0;
+    unsigned int i = 0;
+
+    if(unlikely(!hs || !stats))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    memset(stats, 0, sizeof(hash_table_stats));
+
+    OA_RLOCK(ht);
+
+    stats->size = OA_SIZE(ht);
+    stats->bucket_count = ht->capacity;
+    for(; i < ht->capacity; ++ i)
+    {
+        if(ht->ctrl[i] < 0)
+        {
+            continue;
+        }
+
+        len = oa_probe_length(ht, i);
+        if(len > stats->max_chain)
+        {
+            stats->max_chain = len;
+        }
+    }
+
+    OA_UNLOCK(ht);
+
+    stats->load_factor = (double)stats->size / stats->bucket_count;
+
+    return OK;
+}
+
+// 迭代器前进，遍历期间持有读锁
+static bool _oa_iter_next(
+    IN hash_table_iter *it,
+    OUT void **key,
+    OUT void **value
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)it->hs;
+
+    if(it->segment > 0)
+    {
+        return false;
+    }
+
+    if(!it->locked)
+    {
+        OA_RLOCK(ht);
+        it->locked = true;
+        it->index = 0;
+    }
+
+    for(; it->index < ht->capacity; ++ it->index)
+    {
+        if(ht->ctrl[it->index] >= 0)
+        {
+            if(key)     *key = ht->slots[it->index].key;
+            if(value)   *value = ht->slots[it->index].value;
+            ++ it->index;
+            return true;
+        }
+    }
+
+    OA_UNLOCK(ht);
+    it->locked = false;
+    it->segment = 1;
+
+    return false;
+}
+
+// 提前结束迭代，释放读锁
+static void _oa_iter_end(IN hash_table_iter *it)
+{
+    oa_hash_table *ht = (oa_hash_table*)it->hs;
+
+    if(it->locked)
+    {
+        OA_UNLOCK(ht);
+        it->locked = false;
+    }
+    it->segment = 1;
+}
+
+// 遍历哈希值低位等于part的元素，控制字节中的哈希片段即哈希值低7位，只扫描控制字节即可过滤
+static bool _oa_foreach_part(
+    IN hash_table *hs,
+    IN unsigned int part,
+    IN unsigned int parts,
+    IN hash_table_visit_func visit,
+    IN void *ctx
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int i = 0;
+    bool ret = true;
+
+    OA_RLOCK(ht);
+
+    for(i = 0; ret && i < ht->capacity; ++ i)
+    {
+        if(ht->ctrl[i] >= 0 && ((unsigned int)ht->ctrl[i] & (parts - 1)) == part)
+        {
+            ret = visit(ht->slots[i].key, ht->slots[i].value, ctx);
+        }
+    }
+
+    OA_UNLOCK(ht);
+
+    return ret;
+}
+
+// 打印哈希表，按组输出
+static void _oa_display(
+    IN hash_table *hs
+)
+{
+    oa_hash_table *ht = (oa_hash_table*)hs;
+    unsigned int i = 0;
+    unsigned int count = 0;
+
+    if(unlikely(!hs))
+    {
+        DBG("bad param");
+        return;
+    }
+
+    OA_RLOCK(ht);
+
+    for(; i < ht->capacity; ++ i)
+    {
+        if(0 == i % OA_GROUP_WIDTH)
+        {
+            printf("%sgroup %u:\r\n", i ? "\r\n" : "", i / OA_GROUP_WIDTH);
+            count = 0;
+        }
+        if(ht->ctrl[i] >= 0)
+        {
+            if(hs->show)
+            {
+                hs->show(ht->slots[i].key);
+            }
+            printf("(%u)-->", ++ count);
+        }
+    }
+    printf("\r\n");
+
+    OA_UNLOCK(ht);
+}
+
+/*
+    Variables
+*/
+
+// 开放寻址法引擎操作集合
+hash_table_ops hash_table_oa_operations = {
+    .hash_table_create = _oa_create,
+    .hash_table_destroy = _oa_destroy,
+    .hash_table_put = _oa_put,
+    .hash_table_get = _oa_get,
+    .hash_table_get_or_insert = _oa_get_or_insert,
+    .hash_table_pop = _oa_pop,
+    .hash_table_compute_if_absent = _oa_compute_if_absent,
+    .hash_table_contain = _oa_contain,
+    .hash_table_contain_batch = _oa_contain_batch,
+    .hash_table_get_batch = _oa_get_batch,
+    .hash_table_insert_batch = _oa_insert_batch,
+    .hash_table_reserve = _oa_reserve,
+    .hash_table_get_size = _oa_get_size,
+    .hash_table_get_stats = _oa_get_stats,
+    .hash_table_iter_next = _oa_iter_next,
+    .hash_table_iter_end = _oa_iter_end,
+    .hash_table_foreach_part = _oa_foreach_part,
+    .hash_table_display = _oa_display,
+};
+
+// 开放寻址法引擎测试
+#if HASH_TABLE_TEST
+
+static unsigned int oa_test_hash(void *data)
+{
+    return (unsigned int)*((int*)data);
+}
+
+static unsigned int oa_test_bad_hash(void *data)
+{
+    return (unsigned int)*((int*)data) % 11;
+}
+
+static void oa_test_display(void *data)
+{
+    printf("%d", *((int*)data));
+}
+
+static bool oa_test_cmp(void *d1, void *d2)
+{
+    if(!d1 || !d2)  return false;
+    return *(int*)d1 == *(int*)d2;
+}
+
+void hash_table_oa_test()
+{
+#if CMOCKA_TEST
+    hash_table *hs = NULL;
+    static int a[1000];
+    int b = 1000;
+    int i = 0;
+    unsigned int size = 0;
+    hash_table_stats stats;
+
+    for(i = 0; i < 1000; ++ i)
+        a[i] = i;
+
+    assert_null(hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 0, oa_test_hash, oa_test_cmp, NULL));
+    assert_null(hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 4, NULL, oa_test_cmp, NULL));
+    assert_null(hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 4, oa_test_hash, NULL, NULL));
+    assert_null(hash_table_create_ex((HASH_TABLE_TYPE)-1, 4, oa_test_hash, oa_test_cmp, NULL));
+
+    // 初始容量很小，插入过程中触发扩容
+    hs = hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 4, oa_test_hash, oa_test_cmp, oa_test_display);
+    assert_non_null(hs);
+
+    assert_int_not_equal(OK, hash_table_insert(hs, NULL));
+    for(i = 0; i < 1000; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    assert_int_equal(ERR_HASH_TABLE_DATA_EXIST, hash_table_insert(hs, &a[10]));
+
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(1000, size);
+
+    for(i = 0; i < 1000; ++ i)
+        assert_true(hash_table_contain(hs, &a[i]));
+    assert_false(hash_table_contain(hs, &b));
+    assert_false(hash_table_contain(hs, NULL));
+
+    // 删除一半，留下的墓碑不能影响查找
+    for(i = 0; i < 1000; i += 2)
+        assert_int_equal(OK, hash_table_remove(hs, &a[i]));
+    assert_int_equal(ERR_HASH_TABLE_DATA_NOT_EXIST, hash_table_remove(hs, &a[0]));
+    for(i = 0; i < 1000; ++ i)
+        assert_int_equal(i % 2 == 1, hash_table_contain(hs, &a[i]));
+
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(500, size);
+
+    for(i = 0; i < 1000; i += 2)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    assert_int_equal(OK, hash_table_get_size(hs, &size));
+    assert_int_equal(1000, size);
+
+    // 删除到负载因子很低时缩容，预留后不再低于预留规模
+    for(i = 0; i < 990; ++ i)
+        assert_int_equal(OK, hash_table_remove(hs, &a[i]));
+    for(i = 990; i < 1000; ++ i)
+        assert_true(hash_table_contain(hs, &a[i]));
+    assert_int_not_equal(OK, hash_table_reserve(hs, 0));
+    assert_int_equal(OK, hash_table_reserve(hs, 2000));
+    for(i = 0; i < 990; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    for(i = 0; i < 1000; ++ i)
+        assert_true(hash_table_contain(hs, &a[i]));
+
+    assert_return_code(OK, hash_table_destroy(hs));
+
+    // 用户哈希分布很差时依然正确
+    hs = hash_table_create_ex(HASH_TABLE_OPEN_ADDR, 16, oa_test_bad_hash, oa_test_cmp, oa_test_display);
+    assert_non_null(hs);
+    for(i = 0; i < 100; ++ i)
+        assert_int_equal(OK, hash_table_insert(hs, &a[i]));
+    assert_int_equal(OK, hash_table_get_stats(hs, &stats));
+    assert_int_equal(100, stats.size);
+    assert_true(stats.load_factor <= 0.875);
+    assert_true(stats.max_chain >= 1 && stats.max_chain <= stats.bucket_count / 16);
+    for(i = 0; i < 100; ++ i)
+        assert_true(hash_table_contain(hs, &a[i]));
+    for(i = 0; i < 100; i += 3)
+        assert_int_equal(OK, hash_table_remove(hs, &a[i]));
+    for(i = 0; i < 100; ++ i)
+        assert_int_equal(i % 3 != 0, hash_table_contain(hs, &a[i]));
+
+    hash_table_display(hs);
+
+    assert_return_code(OK, hash_table_destroy(hs));
+#endif
+}
+#endif
@@ -0,0 +1,796 @@
+/*
+    Include files
+*/
+
+#define _POSIX_C_SOURCE 200809L     // mmap, fsync, fileno, mkstemp, fchmod
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash_table_snapshot.h"
+
+/*
+    Defines
+*/
+
+#define SNAPSHOT_MAGIC          "HTSNAP\0\0"            // 文件魔数，8字节
+#define SNAPSHOT_BYTE_ORDER     (0x01020304u)           // 字节序标记，字节序不同的机器上读出来不相等
+#define SNAPSHOT_CHECKSUM_SEED  (0x736e617073686f74ull) // 计算校验和使用的种子
+#define SNAPSHOT_ALIGN(n)       (((n) + 7) & ~(uint64_t)7)  // 各段和每个键、值都按8字节对齐
+
+/*
+    typedefs
+*/
+
+// 文件头，位于文件开头。文件中只保存相对文件开头的偏移，映射到任何地址都可以直接使用
+typedef struct
+{
+    char magic[8];              // SNAPSHOT_MAGIC
+    uint32_t version;           // HASH_TABLE_SNAPSHOT_VERSION
+    uint32_t byte_order;        // SNAPSHOT_BYTE_ORDER
+    uint64_t header_size;       // 文件头大小
+    uint64_t seed;              // 计算键哈希值的种子，保存时随机生成
+    uint64_t count;             // 键值对数量
+    uint64_t bucket_count;      // 桶数量，2的幂
+    uint64_t buckets_offset;    // 桶数组的偏移，共bucket_count + 1项，第i个桶的条目为[buckets[i], buckets[i + 1])
+    uint64_t entries_offset;    // 条目数组的偏移，条目按桶排列
+    uint64_t data_offset;       // 键和值的字节串的偏移
+    uint64_t file_size;         // 文件大小
+    uint64_t body_checksum;     // 文件头之后全部内容的校验和
+    uint64_t header_checksum;   // 文件头的校验和，计算时该字段为0
+}snapshot_header;
+
+// 条目，32字节
+typedef struct
+{
+    uint64_t hash;              // 键的哈希值，比较字节串之前先比较它
+    uint64_t key_offset;        // 键的偏移
+    uint64_t value_offset;      // 值的偏移
+    uint32_t key_len;           // 键的长度
+    uint32_t value_len;         // 值的长度
+}snapshot_entry;
+
+// 映射后的快照
+struct hash_table_snapshot
+{
+    uint8_t *base;                  // 映射的起始地址
+    size_t size;                    // 映射的大小
+    const snapshot_header *header;  // 文件头
+    const uint64_t *buckets;        // 桶数组
+    const snapshot_entry *entries;  // 条目数组
+};
+
+// 保存时收集的键值对
+typedef struct
+{
+    uint64_t hash;
+    hash_table_blob key;
+    hash_table_blob value;
+}snapshot_record;
+
+// 收集键值对的上下文
+typedef struct
+{
+    snapshot_record *recs;
+    size_t count;
+    size_t capacity;
+    uint64_t seed;
+    hash_table_encode_func encode;
+    void *ctx;
+    STATUS ret;
+}snapshot_collect_ctx;
+
+/*
+    Functions
+*/
+
+// 遍历回调：编码键值对并计算哈希值，数组不够时翻倍
+static bool snapshot_collect(
+    IN void *key,
+    IN void *value,
+    IN void *param
+)
+{
+    snapshot_collect_ctx *sc = (snapshot_collect_ctx*)param;
+    snapshot_record *rec = NULL;
+    snapshot_record *recs = NULL;
+
+    if(sc->count == sc->capacity)
+    {
+        recs = (snapshot_record*)malloc(sizeof(snapshot_record) * sc->capacity * 2);
+        if(unlikely(!recs))
+        {
+            sc->ret = ERR_NO_MEMORY;
+            return false;
+        }
+        memcpy(recs, sc->recs, sizeof(snapshot_record) * sc->count);
+        free(sc->recs);
+        sc->recs = recs;
+        sc->capacity *= 2;
+    }
+
+    rec = &sc->recs[sc->count];
+    rec->key.data = NULL;
+    rec->key.len = 0;
+    rec->value.data = NULL;
+    rec->value.len = 0;
+    sc->encode(key, value, &rec->key, &rec->value, sc->ctx);
+
+    if(unlikely(rec->key.len > UINT32_MAX || rec->value.len > UINT32_MAX ||
+                (rec->key.len && !rec->key.data) || (rec->value.len && !rec->value.data)))
+    {
+        DBG("bad blob of key value pair");
+        sc->ret = ERR_BAD_PARAM;
+        return false;
+    }
+
+    rec->hash = hash_table_hash_bytes(rec->key.data, rec->key.len, sc->seed);
+    ++ sc->count;
+
+    return true;
+}
+
+// 计算各段的偏移和文件大小，填写文件头中除校验和以外的字段
+static void snapshot_layout(
+    IN snapshot_collect_ctx *sc,
+    OUT snapshot_header *hdr
+)
+{
+    uint64_t data_size = 0;
+    size_t i = 0;
+
+    memset(hdr, 0, sizeof(snapshot_header));
+    memcpy(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic));
+    hdr->version = HASH_TABLE_SNAPSHOT_VERSION;
+    hdr->byte_order = SNAPSHOT_BYTE_ORDER;
+    hdr->header_size = SNAPSHOT_ALIGN(sizeof(snapshot_header));
+    hdr->seed = sc->seed;
+    hdr->count = sc->count;
+    hdr->bucket_count = 1;
+    while(hdr->bucket_count < sc->count)
+    {
+        hdr->bucket_count <<= 1;
+    }
+    hdr->buckets_offset = hdr->header_size;
+    hdr->entries_offset = hdr->buckets_offset + sizeof(uint64_t) * (hdr->bucket_count + 1);
+    hdr->data_offset = hdr->entries_offset + sizeof(snapshot_entry) * sc->count;
+    for(i = 0; i < sc->count; ++ i)
+    {
+        data_size += SNAPSHOT_ALIGN(sc->recs[i].key.len) + SNAPSHOT_ALIGN(sc->recs[i].value.len);
+    }
+    hdr->file_size = hdr->data_offset + data_size;
+}
+
+// 计数排序：统计每个桶的条目数，前缀和即每个桶的起点，order按桶排列记录下标
+static void snapshot_sort(
+    IN snapshot_collect_ctx *sc,
+    IN const snapshot_header *hdr,
+    OUT uint64_t *buckets,
+    OUT unsigned int *order
+)
+{
+    uint64_t mask = hdr->bucket_count - 1;
+    size_t i = 0;
+
+    memset(buckets, 0, sizeof(uint64_t) * (hdr->bucket_count + 1));
+    for(i = 0; i < sc->count; ++ i)
+    {
+        ++ buckets[(sc->recs[i].hash & mask) + 1];
+    }
+    for(i = 0; i < hdr->bucket_count; ++ i)
+    {
+        buckets[i + 1] += buckets[i];
+    }
+
+    // 借用buckets[b]作为桶b的写入位置，放完后它等于原来的buckets[b + 1]，整体右移一位还原
+    for(i = 0; i < sc->count; ++ i)
+    {
+        order[buckets[sc->recs[i].hash & mask] ++] = (unsigned int)i;
+    }
+    memmove(buckets + 1, buckets, sizeof(uint64_t) * hdr->bucket_count);
+    buckets[0] = 0;
+}
+
+// 写入字节串并补齐到8字节
+static bool snapshot_put_blob(
+    IN FILE *fp,
+    IN const hash_table_blob *blob
+)
+{
+    static const uint8_t zero[8];
+    size_t pad = (size_t)(SNAPSHOT_ALIGN(blob->len) - blob->len);
+
+    return (0 == blob->len || blob->len == fwrite(blob->data, 1, blob->len, fp)) &&
+           (0 == pad || pad == fwrite(zero, 1, pad, fp));
+}
+
+// 文件头之后的内容逐段写入：桶数组|条目数组|键和值，文件头位置先写0占位
+static bool snapshot_put_body(
+    IN FILE *fp,
+    IN snapshot_collect_ctx *sc,
+    IN const snapshot_header *hdr,
+    IN const uint64_t *buckets,
+    IN const unsigned int *order
+)
+{
+    static const uint8_t zero[sizeof(snapshot_header) + 8];
+    snapshot_entry e;
+    snapshot_record *rec = NULL;
+    uint64_t data = hdr->data_offset;
+    size_t i = 0;
+
+    if(hdr->header_size != fwrite(zero, 1, (size_t)hdr->header_size, fp) ||
+       hdr->bucket_count + 1 != fwrite(buckets, sizeof(uint64_t), (size_t)hdr->bucket_count + 1, fp))
+    {
+        return false;
+    }
+
+    // 键和值按条目的顺序存放，条目中的偏移依次累加
+    memset(&e, 0, sizeof(e));
+    for(i = 0; i < sc->count; ++ i)
+    {
+        rec = &sc->recs[order[i]];
+        e.hash = rec->hash;
+        e.key_len = (uint32_t)rec->key.len;
+        e.value_len = (uint32_t)rec->value.len;
+        e.key_offset = data;
+        data += SNAPSHOT_ALIGN(rec->key.len);
+        e.value_offset = data;
+        data += SNAPSHOT_ALIGN(rec->value.len);
+        if(1 != fwrite(&e, sizeof(e), 1, fp))
+        {
+            return false;
+        }
+    }
+
+    for(i = 0; i < sc->count; ++ i)
+    {
+        rec = &sc->recs[order[i]];
+        if(!snapshot_put_blob(fp, &rec->key) || !snapshot_put_blob(fp, &rec->value))
+        {
+            return false;
+        }
+    }
+
+    return 0 == fflush(fp);
+}
+
+// 映射已写入的文件计算校验和，再把文件头写到开头
+static bool snapshot_put_header(
+    IN FILE *fp,
+    IN snapshot_header *hdr
+)
+{
+    void *base = mmap(NULL, (size_t)hdr->file_size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+
+    if(base == MAP_FAILED)
+    {
+        return false;
+    }
+    hdr->body_checksum = hash_table_hash_bytes((uint8_t*)base + hdr->header_size, hdr->file_size - hdr->header_size,
+                                               SNAPSHOT_CHECKSUM_SEED);
+    munmap(base, (size_t)hdr->file_size);
+
+    hdr->header_checksum = 0;
+    hdr->header_checksum = hash_table_hash_bytes(hdr, sizeof(snapshot_header), SNAPSHOT_CHECKSUM_SEED);
+
+    return 0 == fseek(fp, 0, SEEK_SET) && 1 == fwrite(hdr, sizeof(snapshot_header), 1, fp) && 0 == fflush(fp);
+}
+
+// 改名之后同步目标文件所在的目录，确保目录项落盘
+static bool snapshot_sync_dir(IN const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    char *dir = NULL;
+    size_t len = slash ? (size_t)(slash - path) : 1;
+    bool ok = false;
+    int fd = -1;
+
+    dir = (char*)malloc(len + 1);
+    if(unlikely(!dir))
+    {
+        return false;
+    }
+    if(!slash)
+    {
+        dir[0] = '.';
+    }
+    else if(0 == len)
+    {
+        dir[len ++] = '/';
+    }
+    else
+    {
+        memcpy(dir, path, len);
+    }
+    dir[len] = '\0';
+
+    fd = open(dir, O_RDONLY);
+    if(fd >= 0)
+    {
+        ok = (0 == fsync(fd));
+        close(fd);
+    }
+
+    free(dir);
+    return ok;
+}
+
+// 写入同目录下唯一命名的临时文件，落盘后改名为目标文件，再同步目录
+static STATUS snapshot_write(
+    IN const char *path,
+    IN snapshot_collect_ctx *sc,
+    IN snapshot_header *hdr,
+    IN const uint64_t *buckets,
+    IN const unsigned int *order
+)
+{
+    size_t len = strlen(path);
+    char *tmp = (char*)malloc(len + 8);
+    FILE *fp = NULL;
+    STATUS ret = ERR_API_ERROR;
+    int fd = -1;
+
+    if(unlikely(!tmp))
+    {
+        return ERR_NO_MEMORY;
+    }
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".XXXXXX", 8);
+
+    fd = mkstemp(tmp);
+    if(unlikely(fd < 0))
+    {
+        DBG("create temp file for %s fail", path);
+        free(tmp);
+        return ERR_API_ERROR;
+    }
+    fp = fdopen(fd, "wb");
+    if(unlikely(!fp))
+    {
+        DBG("open %s fail", tmp);
+        close(fd);
+        remove(tmp);
+        free(tmp);
+        return ERR_API_ERROR;
+    }
+
+    // mkstemp创建的文件只有属主可读写，改为与普通文件相同的权限供其他进程映射
+    if(0 == fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) &&
+       snapshot_put_body(fp, sc, hdr, buckets, order) &&
+       snapshot_put_header(fp, hdr) &&
+       0 == fsync(fd))
+    {
+        ret = OK;
+    }
+    if(0 != fclose(fp))
+    {
+        ret = ERR_API_ERROR;
+    }
+
+    if(OK == ret && 0 != rename(tmp, path))
+    {
+        ret = ERR_API_ERROR;
+    }
+    if(OK != ret)
+    {
+        DBG("write snapshot %s fail", path);
+        remove(tmp);
+    }
+    else if(!snapshot_sync_dir(path))
+    {
+        DBG("sync directory of %s fail", path);
+        ret = ERR_API_ERROR;
+    }
+
+    free(tmp);
+    return ret;
+}
+
+// 保存快照。文件布局：文件头|桶数组|条目数组|键和值，只收集键值对的引用，按段写入文件
+static STATUS _hash_table_snapshot_save(
+    IN hash_table *hs,
+    IN const char *path,
+    IN hash_table_encode_func encode,
+    IN void *ctx
+)
+{
+    snapshot_collect_ctx sc;
+    snapshot_header hdr;
+    uint64_t *buckets = NULL;
+    unsigned int *order = NULL;
+    unsigned int size = 0;
+    STATUS ret = OK;
+
+    if(unlikely(!hs || !path || !encode))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    memset(&sc, 0, sizeof(sc));
+    hash_table_get_size(hs, &size);
+    sc.capacity = size + 64;
+    sc.seed = hash_table_random_seed();
+    sc.encode = encode;
+    sc.ctx = ctx;
+    sc.ret = OK;
+    sc.recs = (snapshot_record*)malloc(sizeof(snapshot_record) * sc.capacity);
+    if(unlikely(!sc.recs))
+    {
+        return ERR_NO_MEMORY;
+    }
+
+    hash_table_foreach(hs, snapshot_collect, &sc);
+    if(unlikely(OK != sc.ret))
+    {
+        ret = sc.ret;
+        goto out;
+    }
+
+    snapshot_layout(&sc, &hdr);
+    if(unlikely(hdr.file_size > SIZE_MAX || sc.count > UINT32_MAX))
+    {
+        ret = ERR_NO_MEMORY;
+        goto out;
+    }
+
+    buckets = (uint64_t*)malloc(sizeof(uint64_t) * (hdr.bucket_count + 1));
+    order = (unsigned int*)malloc(sizeof(unsigned int) * (sc.count + 1));
+    if(unlikely(!buckets || !order))
+    {
+        DBG("malloc index of %llu keys for snapshot fail", (unsigned long long)sc.count);
+        ret = ERR_NO_MEMORY;
+        goto out;
+    }
+
+    snapshot_sort(&sc, &hdr, buckets, order);
+    ret = snapshot_write(path, &sc, &hdr, buckets, order);
+
+out:
+    free(order);
+    free(buckets);
+    free(sc.recs);
+    return ret;
+}
+
+// 检查文件头：魔数、版本、字节序、校验和，以及各段的偏移是否落在文件内且首尾相接
+static bool snapshot_header_valid(
+    IN const snapshot_header *hdr,
+    IN size_t size
+)
+{
+    snapshot_header tmp;
+
+    memcpy(&tmp, hdr, sizeof(tmp));
+    tmp.header_checksum = 0;
+
+    return 0 == memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)) &&
+           hdr->version == HASH_TABLE_SNAPSHOT_VERSION &&
+           hdr->byte_order == SNAPSHOT_BYTE_ORDER &&
+           hdr->header_checksum == hash_table_hash_bytes(&tmp, sizeof(tmp), SNAPSHOT_CHECKSUM_SEED) &&
+           hdr->header_size == SNAPSHOT_ALIGN(sizeof(snapshot_header)) &&
+           hdr->file_size == size &&
+           hdr->bucket_count && 0 == (hdr->bucket_count & (hdr->bucket_count - 1)) &&
+           hdr->bucket_count < size / sizeof(uint64_t) &&
+           hdr->count <= size / sizeof(snapshot_entry) &&
+           hdr->buckets_offset == hdr->header_size &&
+           hdr->entries_offset == hdr->buckets_offset + sizeof(uint64_t) * (hdr->bucket_count + 1) &&
+           hdr->data_offset == hdr->entries_offset + sizeof(snapshot_entry) * hdr->count &&
+           hdr->data_offset <= size;
+}
+
+// 映射快照文件
+static hash_table_snapshot* _hash_table_snapshot_open(
+    IN const char *path,
+    IN unsigned int flags
+)
+{
+    hash_table_snapshot *snap = NULL;
+    const snapshot_header *hdr = NULL;
+    struct stat st;
+    void *base = MAP_FAILED;
+    size_t size = 0;
+    int fd = -1;
+
+    if(unlikely(!path))
+    {
+        return NULL;
+    }
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        DBG("open %s fail", path);
+        return NULL;
+    }
+
+    if(0 == fstat(fd, &st) && st.st_size >= (off_t)sizeof(snapshot_header))
+    {
+        size = (size_t)st.st_size;
+        // 写时复制映射的修改只在本进程可见，不会写回文件
+        base = (flags & HASH_TABLE_SNAPSHOT_COW) ?
+               mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) :
+               mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if(base == MAP_FAILED)
+    {
+        DBG("map %s fail", path);
+        return NULL;
+    }
+
+    hdr = (const snapshot_header*)base;
+    if(!snapshot_header_valid(hdr, size) ||
+       ((flags & HASH_TABLE_SNAPSHOT_VERIFY) &&
+        hdr->body_checksum != hash_table_hash_bytes((uint8_t*)base + hdr->header_size, size - hdr->header_size,
+                                                    SNAPSHOT_CHECKSUM_SEED)))
+    {
+        DBG("invalid snapshot %s", path);
+        munmap(base, size);
+        return NULL;
+    }
+
+    snap = (hash_table_snapshot*)malloc(sizeof(hash_table_snapshot));
+    if(unlikely(!snap))
+    {
+        munmap(base, size);
+        return NULL;
+    }
+
+    snap->base = (uint8_t*)base;
+    snap->size = size;
+    snap->header = hdr;
+    snap->buckets = (const uint64_t*)(snap->base + hdr->buckets_offset);
+    snap->entries = (const snapshot_entry*)(snap->base + hdr->entries_offset);
+
+    return snap;
+}
+
+// 解除映射
+static STATUS _hash_table_snapshot_close(IN hash_table_snapshot *snap)
+{
+    if(unlikely(!snap))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    munmap(snap->base, snap->size);
+    free(snap);
+
+    return OK;
+}
+
+// 字节串[offset, offset + len)是否落在映射内
+static inline bool snapshot_range_valid(
+    IN hash_table_snapshot *snap,
+    IN uint64_t offset,
+    IN uint64_t len
+)
+{
+    return offset <= snap->size && len <= snap->size - offset;
+}
+
+// 查找键：计算哈希值定位桶，在桶内先比较哈希值和长度，再比较字节串；
+// 打开时没有校验全部数据，因此访问前检查偏移，损坏的文件不会越界
+static void* _hash_table_snapshot_get(
+    IN hash_table_snapshot *snap,
+    IN const void *key,
+    IN size_t key_len,
+    OUT size_t *value_len
+)
+{
+    const snapshot_entry *e = NULL;
+    uint64_t h = 0;
+    uint64_t b = 0;
+    uint64_t i = 0;
+    uint64_t end = 0;
+
+    if(unlikely(!snap || (!key && key_len)))
+    {
+        return NULL;
+    }
+
+    h = hash_table_hash_bytes(key, key_len, snap->header->seed);
+    b = h & (snap->header->bucket_count - 1);
+    i = snap->buckets[b];
+    end = snap->buckets[b + 1];
+
+    if(unlikely(end > snap->header->count))
+    {
+        return NULL;
+    }
+
+    for(; i < end; ++ i)
+    {
+        e = &snap->entries[i];
+        if(e->hash != h || e->key_len != key_len ||
+           !snapshot_range_valid(snap, e->key_offset, e->key_len) ||
+           (key_len && 0 != memcmp(snap->base + e->key_offset, key, key_len)))
+        {
+            continue;
+        }
+
+        if(unlikely(!snapshot_range_valid(snap, e->value_offset, e->value_len)))
+        {
+            return NULL;
+        }
+        if(value_len)
+        {
+            *value_len = e->value_len;
+        }
+        return snap->base + e->value_offset;
+    }
+
+    return NULL;
+}
+
+// 获取键值对数量
+static STATUS _hash_table_snapshot_get_size(
+    IN hash_table_snapshot *snap,
+    OUT unsigned int *size
+)
+{
+    if(unlikely(!snap || !size))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    *size = (unsigned int)snap->header->count;
+
+    return OK;
+}
+
+/*
+    Variables
+*/
+
+hash_table_snapshot_ops hash_table_snapshot_operations = {
+    .hash_table_snapshot_save = _hash_table_snapshot_save,
+    .hash_table_snapshot_open = _hash_table_snapshot_open,
+    .hash_table_snapshot_close = _hash_table_snapshot_close,
+    .hash_table_snapshot_get = _hash_table_snapshot_get,
+    .hash_table_snapshot_get_size = _hash_table_snapshot_get_size,
+};
+
+/*
+    Test
+*/
+
+#if HASH_TABLE_TEST
+
+#define SNAPSHOT_TEST_KEYS  (3000)
+#define SNAPSHOT_TEST_PATH  "hash_table_snapshot_test.bin"
+
+// 测试记录，键为name字符串
+typedef struct
+{
+    char name[16];
+    int id;
+    int score;
+}snapshot_test_record;
+
+// 键编码为字符串，值编码为整个记录
+static void snapshot_test_encode(void *key, void *value, hash_table_blob *key_out, hash_table_blob *value_out, void *ctx)
+{
+    (void)ctx;
+    key_out->data = key;
+    key_out->len = strlen((const char*)key);
+    value_out->data = value;
+    value_out->len = sizeof(snapshot_test_record);
+}
+
+// 修改文件中off处的一个字节
+static void snapshot_test_corrupt(long off)
+{
+#if CMOCKA_TEST
+    FILE *fp = fopen(SNAPSHOT_TEST_PATH, "r+b");
+    int c = 0;
+
+    assert_non_null(fp);
+    assert_int_equal(0, fseek(fp, off, SEEK_SET));
+    c = fgetc(fp);
+    assert_int_equal(0, fseek(fp, off, SEEK_SET));
+    fputc(c ^ 0x5a, fp);
+    fclose(fp);
+#endif
+}
+
+void hash_table_snapshot_test()
+{
+#if CMOCKA_TEST
+    static snapshot_test_record recs[SNAPSHOT_TEST_KEYS];
+    hash_table *hs = NULL;
+    hash_table_snapshot *snap = NULL;
+    snapshot_test_record *rec = NULL;
+    size_t len = 0;
+    unsigned int size = 0;
+    int i = 0;
+
+    for(i = 0; i < SNAPSHOT_TEST_KEYS; ++ i)
+    {
+        snprintf(recs[i].name, sizeof(recs[i].name), "user-%d", i);
+        recs[i].id = i;
+        recs[i].score = i * 3;
+    }
+
+    hs = hash_table_create_seeded(HASH_TABLE_CHAIN, 64, hash_table_hash_str, hash_table_cmp_str, NULL);
+    assert_non_null(hs);
+    for(i = 0; i < SNAPSHOT_TEST_KEYS; ++ i)
+        assert_int_equal(OK, hash_table_put(hs, recs[i].name, &recs[i], NULL));
+
+    assert_int_not_equal(OK, hash_table_snapshot_save(NULL, SNAPSHOT_TEST_PATH, snapshot_test_encode, NULL));
+    assert_int_not_equal(OK, hash_table_snapshot_save(hs, SNAPSHOT_TEST_PATH, NULL, NULL));
+    assert_int_equal(OK, hash_table_snapshot_save(hs, SNAPSHOT_TEST_PATH, snapshot_test_encode, NULL));
+    assert_null(hash_table_snapshot_open("hash_table_snapshot_test.none", 0));
+    // 目录不存在时无法创建临时文件
+    assert_int_equal(ERR_API_ERROR, hash_table_snapshot_save(hs, "hash_table_snapshot_test.none/x.bin",
+                                                             snapshot_test_encode, NULL));
+
+    // 只读映射：值就是保存时的记录
+    snap = hash_table_snapshot_open(SNAPSHOT_TEST_PATH, HASH_TABLE_SNAPSHOT_VERIFY);
+    assert_non_null(snap);
+    assert_int_equal(OK, hash_table_snapshot_get_size(snap, &size));
+    assert_int_equal(SNAPSHOT_TEST_KEYS, size);
+    for(i = 0; i < SNAPSHOT_TEST_KEYS; ++ i)
+    {
+        rec = (snapshot_test_record*)hash_table_snapshot_get(snap, recs[i].name, strlen(recs[i].name), &len);
+        assert_non_null(rec);
+        assert_int_equal(sizeof(snapshot_test_record), len);
+        assert_int_equal(0, (uintptr_t)rec % 8);
+        assert_int_equal(i, rec->id);
+        assert_int_equal(i * 3, rec->score);
+    }
+    assert_false(hash_table_snapshot_contain(snap, "user-", 5));
+    assert_false(hash_table_snapshot_contain(snap, "user-30000", 10));
+    assert_true(hash_table_snapshot_contain(snap, "user-1", 6));
+    assert_return_code(OK, hash_table_snapshot_close(snap));
+
+    // 写时复制映射：修改只在映射内可见
+    snap = hash_table_snapshot_open(SNAPSHOT_TEST_PATH, HASH_TABLE_SNAPSHOT_COW);
+    assert_non_null(snap);
+    rec = (snapshot_test_record*)hash_table_snapshot_get(snap, "user-7", 6, NULL);
+    assert_non_null(rec);
+    rec->score = -1;
+    rec = (snapshot_test_record*)hash_table_snapshot_get(snap, "user-7", 6, NULL);
+    assert_int_equal(-1, rec->score);
+    assert_return_code(OK, hash_table_snapshot_close(snap));
+
+    snap = hash_table_snapshot_open(SNAPSHOT_TEST_PATH, HASH_TABLE_SNAPSHOT_READ_ONLY);
+    assert_non_null(snap);
+    rec = (snapshot_test_record*)hash_table_snapshot_get(snap, "user-7", 6, NULL);
+    assert_int_equal(21, rec->score);
+    assert_return_code(OK, hash_table_snapshot_close(snap));
+
+    // 数据损坏：不校验时照常打开，校验时拒绝
+    snapshot_test_corrupt((long)sizeof(snapshot_header));
+    snap = hash_table_snapshot_open(SNAPSHOT_TEST_PATH, 0);
+    assert_non_null(snap);
+    assert_return_code(OK, hash_table_snapshot_close(snap));
+    assert_null(hash_table_snapshot_open(SNAPSHOT_TEST_PATH, HASH_TABLE_SNAPSHOT_VERIFY));
+
+    // 文件头损坏
+    snapshot_test_corrupt(offsetof(snapshot_header, count));
+    assert_null(hash_table_snapshot_open(SNAPSHOT_TEST_PATH, 0));
+
+    // 空表
+    assert_int_equal(OK, hash_table_destroy(hs));
+    hs = hash_table_create_seeded(HASH_TABLE_OPEN_ADDR, 16, hash_table_hash_str, hash_table_cmp_str, NULL);
+    assert_non_null(hs);
+    assert_int_equal(OK, hash_table_snapshot_save(hs, SNAPSHOT_TEST_PATH, snapshot_test_encode, NULL));
+    snap = hash_table_snapshot_open(SNAPSHOT_TEST_PATH, HASH_TABLE_SNAPSHOT_VERIFY);
+    assert_non_null(snap);
+    assert_int_equal(OK, hash_table_snapshot_get_size(snap, &size));
+    assert_int_equal(0, size);
+    assert_false(hash_table_snapshot_contain(snap, "user-1", 6));
+    assert_return_code(OK, hash_table_snapshot_close(snap));
+
+    assert_int_equal(OK, hash_table_destroy(hs));
+    remove(SNAPSHOT_TEST_PATH);
+#endif
+}
+
+#endif
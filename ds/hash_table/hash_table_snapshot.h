@@ -0,0 +1,127 @@
+#ifndef _HASH_TABLE_SNAPSHOT_H
+#define _HASH_TABLE_SNAPSHOT_H
+
+/*
+    Include files
+*/
+
+#include <stddef.h>
+#include "hash_table.h"
+
+/*
+    Defines
+*/
+
+// 快照格式版本，格式变化时递增，加载时版本不同视为无效
+#define HASH_TABLE_SNAPSHOT_VERSION (1)
+
+/*
+    typedefs
+*/
+
+// 快照声明，隐藏成员
+typedef struct hash_table_snapshot hash_table_snapshot;
+// 一段字节
+typedef struct
+{
+    const void *data;           // 起始地址
+    size_t len;                 // 长度，不超过4GB
+}hash_table_blob;
+// 把键值对编码为字节串，保存期间data指向的内存必须有效，通常直接指向键和值内部
+typedef void (*hash_table_encode_func)(void *key, void *value, hash_table_blob *key_out, hash_table_blob *value_out, void *ctx);
+// 打开方式
+typedef enum
+{
+    HASH_TABLE_SNAPSHOT_READ_ONLY = 0,      // 只读映射，多个进程共享页缓存
+    HASH_TABLE_SNAPSHOT_COW = 1 << 0,       // 写时复制映射，可以原地修改值，修改不写回文件
+    HASH_TABLE_SNAPSHOT_VERIFY = 1 << 1,    // 打开时校验全部数据，需要读入整个文件
+}HASH_TABLE_SNAPSHOT_FLAG;
+// 快照操作集合
+typedef struct hash_table_snapshot_ops
+{
+    // 把哈希表保存为快照文件
+    STATUS (*hash_table_snapshot_save)(hash_table*, const char*, hash_table_encode_func, void*);
+    // 映射快照文件
+    hash_table_snapshot* (*hash_table_snapshot_open)(const char*, unsigned int);
+    // 解除映射
+    STATUS (*hash_table_snapshot_close)(hash_table_snapshot*);
+    // 查找键，返回值的地址
+    void* (*hash_table_snapshot_get)(hash_table_snapshot*, const void*, size_t, size_t*);
+    // 获取键值对数量
+    STATUS (*hash_table_snapshot_get_size)(hash_table_snapshot*, unsigned int*);
+}hash_table_snapshot_ops;
+
+/*
+    Extern symbols
+*/
+
+extern hash_table_snapshot_ops hash_table_snapshot_operations;
+
+/*
+    Functions
+*/
+
+// 把哈希表保存为快照文件，先写入临时文件再改名，不会留下写了一半的快照
+static inline STATUS hash_table_snapshot_save(
+    IN hash_table *hs,
+    IN const char *path,
+    IN hash_table_encode_func encode,
+    IN void *ctx
+)
+{
+    return hash_table_snapshot_operations.hash_table_snapshot_save(hs, path, encode, ctx);
+}
+
+// 映射快照文件，flags为HASH_TABLE_SNAPSHOT_FLAG的组合。打开时只检查文件头，
+// 数据页在查找时按需读入；文件无效时返回NULL
+static inline hash_table_snapshot* hash_table_snapshot_open(
+    IN const char *path,
+    IN unsigned int flags
+)
+{
+    return hash_table_snapshot_operations.hash_table_snapshot_open(path, flags);
+}
+
+// 解除映射，之前返回的值地址随之失效
+static inline STATUS hash_table_snapshot_close(IN hash_table_snapshot *snap)
+{
+    return hash_table_snapshot_operations.hash_table_snapshot_close(snap);
+}
+
+// 按键的字节串查找，返回值在映射中的地址（按8字节对齐），value_len返回值的长度，可为NULL；
+// 不存在时返回NULL。只读映射中不能修改返回的内存
+static inline void* hash_table_snapshot_get(
+    IN hash_table_snapshot *snap,
+    IN const void *key,
+    IN size_t key_len,
+    OUT size_t *value_len
+)
+{
+    return hash_table_snapshot_operations.hash_table_snapshot_get(snap, key, key_len, value_len);
+}
+
+// 检查键是否存在
+static inline bool hash_table_snapshot_contain(
+    IN hash_table_snapshot *snap,
+    IN const void *key,
+    IN size_t key_len
+)
+{
+    return NULL != hash_table_snapshot_operations.hash_table_snapshot_get(snap, key, key_len, NULL);
+}
+
+// 获取键值对数量
+static inline STATUS hash_table_snapshot_get_size(
+    IN hash_table_snapshot *snap,
+    OUT unsigned int *size
+)
+{
+    return hash_table_snapshot_operations.hash_table_snapshot_get_size(snap, size);
+}
+
+// 测试接口
+#if HASH_TABLE_TEST
+void hash_table_snapshot_test();
+#endif
+
+#endif
@@ -4,6 +4,10 @@
 #include "ds/queue/queue.h"
 #include "ds/stack/stack.h"
 #include "ds/hash_table/hash_table.h"
+#include "ds/hash_table/hash_table_snapshot.h"
+#include "ds/cache/cache.h"
+#include "ds/cache/ttl_cache.h"
+#include "ds/filter/filter.h"
 #include "thread_pool/thread_pool.h"
 
 int main()
@@ -31,6 +35,18 @@ int main()
 
 #if HASH_TABLE_TEST
         cmocka_unit_test(hash_table_test),
+        cmocka_unit_test(hash_table_oa_test),
+        cmocka_unit_test(hash_table_frozen_test),
+        cmocka_unit_test(hash_table_snapshot_test),
+#endif
+
+#if CACHE_TEST
+        cmocka_unit_test(cache_test),
+        cmocka_unit_test(ttl_cache_test),
+#endif
+
+#if FILTER_TEST
+        cmocka_unit_test(filter_test),
 #endif
 
 #if THREAD_POOL_TEST
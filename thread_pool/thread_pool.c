@@ -2,8 +2,28 @@
     Include files
 */
 
+#define _GNU_SOURCE                 // pthread_attr_setaffinity_np, pthread_setname_np, sched_getaffinity
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "thread_pool.h"
 
+/*
+    Defines
+*/
+
+#define THREAD_POOL_CACHE_LINE  (64)    // 缓存行大小，工作线程结构按缓存行对齐
+#define WS_DEQUE_INIT           (64)    // 工作窃取双端队列的初始容量，2的幂，满时翻倍
+#define TP_RANGE_BLOCKS_MAX     (1u << 30)  // parallel_for的块数上限，元素太多时增大grain
+#define TP_RANGE_AUTO_BLOCKS    (32)    // grain为0时每个参与者平均分到的块数
+
 /*
     Typedef
 */
@@ -15,272 +35,3627 @@ typedef struct task_s
     void *args; // 输入参数
 }task_t;
 
+// 一个优先级的共享队列，环形数组，锁内访问
+typedef struct
+{
+    task_t *tasks;              // 环形数组，第一次放入任务时申请
+    unsigned int size;          // 容量
+    unsigned int head;
+    unsigned int tail;
+    atomic_uint count;          // 锁内修改；工作窃取模式下线程不加锁读取高优先级队列的深度
+    unsigned int weight;        // 每轮最多取出的任务数量
+    unsigned int credit;        // 本轮剩余可取的数量
+    unsigned int full_waiters;  // 等待该队列空位的提交线程数量
+    unsigned int peak;          // 最大深度
+    unsigned long long enqueued;    // 累计放入的任务数量
+}task_lane;
+
+// 双端队列的槽，窃取线程可能在所有者覆盖它的同时读取（随后CAS失败丢弃），因此使用原子变量
+typedef struct
+{
+    _Atomic(task_func) func;
+    _Atomic(void*) args;
+}ws_slot;
+
+// 双端队列的环形数组。扩容后窃取线程可能仍在读旧数组，旧数组挂到retired上，销毁线程池时释放
+typedef struct ws_array
+{
+    long long mask;             // 容量-1
+    struct ws_array *retired;   // 扩容前的数组
+    ws_slot slots[];
+}ws_array;
+
+// Chase-Lev双端队列：所有者在bottom端压入和弹出（LIFO），其他线程在top端窃取（FIFO）
+typedef struct
+{
+    _Alignas(THREAD_POOL_CACHE_LINE)
+    atomic_llong top;           // 窃取端，窃取线程CAS修改
+    _Alignas(THREAD_POOL_CACHE_LINE)
+    atomic_llong bottom;        // 所有者端，只有所有者修改
+    _Atomic(ws_array*) array;   // 环形数组，只有所有者替换
+}ws_deque;
+
+// 无锁环形队列的单元。seq等于入队位置时可以写入，等于入队位置+1时可以读取，
+// 读取后设为入队位置+容量，留给下一圈
+typedef struct
+{
+    atomic_size_t seq;
+    task_func func;
+    void *args;
+}lf_cell;
+
+// 有界无锁多生产者多消费者环形队列（Vyukov），入队位置、出队位置和eventcount各占一个缓存行。
+// eventcount最低位表示有线程准备休眠，高位是序号：空闲线程置位并读取序号后再检查队列，
+// 提交线程放入任务后看到该位才清除并递增序号，序号变化时futex等待立即返回
+typedef struct
+{
+    size_t mask;                // 容量-1，容量为2的幂
+    _Alignas(THREAD_POOL_CACHE_LINE)
+    atomic_size_t enqueue_pos;
+    _Alignas(THREAD_POOL_CACHE_LINE)
+    atomic_size_t dequeue_pos;
+    _Alignas(THREAD_POOL_CACHE_LINE)
+    atomic_uint ec_seq;         // eventcount，空闲线程在它上面futex等待
+    _Alignas(THREAD_POOL_CACHE_LINE)
+    lf_cell cells[];
+}lf_ring;
+
+// 工作线程槽的状态，锁内修改
+typedef enum
+{
+    WORKER_FREE,                // 没有线程
+    WORKER_RUNNING,             // 线程在运行
+    WORKER_EXITED,              // 线程已退出，等待回收
+}WORKER_STATE;
+
+// 工作线程
+typedef struct
+{
+    ws_deque deque;             // 工作窃取模式下的本地队列，槽被新线程复用时继续使用
+    thread_pool_t *pool;        // 所属线程池
+    pthread_t tid;              // 线程id
+    unsigned int index;         // 在线程池中的下标
+    unsigned int rand;          // 选择窃取对象的随机数状态
+    WORKER_STATE state;         // 槽的状态
+    bool pinned;                // 是否绑定CPU
+    cpu_set_t cpus;             // 绑定的CPU集合，槽被新线程复用时保持不变
+}thread_worker_t;
+
 // 线程池结构定义
 struct thread_pool_t
 {
     pthread_mutex_t lock;       // 互斥量
     pthread_cond_t notify;      // 条件变量
+    pthread_cond_t not_full;    // 共享队列有空位，使用单调时钟，提交任务的线程在此等待
+    pthread_cond_t drained;     // 所有线程都空闲且共享队列为空，thread_pool_drain在此等待
 
-    pthread_t *thread_arr;      // 线程数组
-    unsigned int thread_count;  // 线程数量
+    thread_worker_t *workers;   // 工作线程数组，按最多线程数量分配，与线程池结构同一块内存
+    atomic_uint thread_count;   // 存活的线程数量，锁内修改
+    unsigned int thread_min;    // 最少线程数量
+    unsigned int thread_max;    // 最多线程数量，等于thread_min时数量固定
+    unsigned int idle_timeout_ms;   // 多余线程空闲多久后退出
+    size_t stack_size;          // 线程栈大小，0表示系统默认
+    char name[THREAD_POOL_NAME_MAX + 1];    // 线程名前缀，空串表示不设置
+    THREAD_POOL_MODE mode;      // 调度模式
+    atomic_uint idle;           // 在notify上等待的线程数量，锁内修改；无锁模式下为准备futex等待的线程数量，不加锁修改
+    atomic_uint drain_waiters;  // 等待任务全部完成的线程数量，锁内修改
 
-    task_t *task_queue;         // 任务队列，数组形式
-    unsigned int queue_size;    // 任务队列容量
-    unsigned int head;
-    unsigned int tail;
-    unsigned int task_count;
+    task_lane lanes[THREAD_POOL_PRIO_COUNT];    // 各优先级的任务队列
+    unsigned int queue_size;    // 每个任务队列的初始容量
+    unsigned int queue_max;     // 每个任务队列扩容的上限
+    unsigned int full_waiters;  // 等待队列空位的提交线程数量，所有优先级合计
+    atomic_uint task_count;     // 所有优先级的任务数量，锁内修改；工作窃取模式下线程不加锁读取，判断是否需要去共享队列取任务
+
+    lf_ring *ring;              // 无锁模式下普通优先级的任务队列，按缓存行对齐
+    void *ring_mem;             // ring所在的内存块
+    atomic_bool ring_full;      // 有提交线程在等待环形队列空位，取出任务的线程清除后唤醒，每次登记只唤醒一次
+
+    atomic_bool shutdown_flag;  // 线程池销毁标志，锁内修改；无锁模式下线程不加锁读取
+};
+
+// 计数器归零时唤醒等待者。不是最后一次递减时只做原子操作，最后一次在锁内完成，
+// 等待者在锁内看到归零才返回，返回后可以立即释放
+typedef struct
+{
+    atomic_uint count;          // 未完成的数量
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        // 使用单调时钟
+}tp_latch;
+
+// future：任务和调用者各持有一个引用，最后释放的一方回收
+struct thread_pool_future
+{
+    tp_latch done;              // 计数为1，任务完成时归零
+    task_result_func func;      // 任务函数
+    void *args;                 // 输入参数
+    void *result;               // 任务函数的返回值
+    atomic_uint refs;           // 引用计数
+};
+
+// 任务组
+struct thread_pool_group
+{
+    tp_latch pending;           // 组内未完成的任务数量
+    thread_pool_t *pool;        // 执行任务的线程池
+};
+
+// 任务组中的任务，执行完后释放
+typedef struct
+{
+    thread_pool_group *group;
+    task_func func;
+    void *args;
+}tp_group_task;
+
+// 任务图的节点
+struct thread_pool_graph_node
+{
+    thread_pool_graph *graph;   // 所属的任务图
+    task_func func;             // 任务函数
+    void *args;                 // 输入参数
+    thread_pool_graph_node **succ;  // 后继节点，满时翻倍
+    unsigned int succ_count;
+    unsigned int succ_size;
+    unsigned int deps;          // 前驱数量
+    atomic_uint pending;        // 本次运行中还没完成的前驱数量，减到0的线程负责执行该节点
+    thread_pool_graph_node *next;   // 任务图中的下一个节点
+    thread_pool_graph_node *ready;  // 就绪栈中的下一个节点，只有负责执行该节点的线程访问
+};
 
-    bool shutdown_flag;         // 线程池销毁标志
+// 任务图
+struct thread_pool_graph
+{
+    tp_latch done;              // 本次运行中还没完成的节点数量，不为0时正在运行
+    thread_pool_t *pool;        // 本次运行使用的线程池
+    thread_pool_graph_node *nodes;  // 节点链表
+    unsigned int node_count;
 };
 
+// parallel_for和parallel_reduce的共享状态。下标范围按grain分块，参与者每次领取连续的若干块；
+// 调用者和辅助任务各持有一个引用，最后释放的一方回收，调用者不必等待还没开始的辅助任务
+typedef struct
+{
+    tp_latch done;              // 还没处理完的块数
+    atomic_uint next;           // 下一个未领取的块
+    atomic_uint next_id;        // 辅助任务的参与者编号，调用者为0
+    atomic_uint refs;           // 引用计数
+    unsigned int blocks;        // 块数
+    unsigned int participants;  // 调用者和辅助任务的数量
+    size_t begin;
+    size_t end;
+    size_t grain;               // 每块的元素数量，最后一块可能不足
+    thread_pool_range_func body;
+    thread_pool_reduce_func reduce;
+    void *ctx;
+    size_t stride;              // 每个参与者的部分结果占用的空间，按缓存行对齐
+    unsigned char *partials;    // 各参与者的部分结果，跟在结构后面
+    bool used[THREAD_COUNT_MAX + 1];    // 参与者是否领取过块，只有该参与者写，调用者在完成后读
+}tp_range;
+
+/*
+    Variables
+*/
+
+// 当前线程所属的工作线程结构，不是工作线程时为NULL
+static _Thread_local thread_worker_t *tp_self = NULL;
+
 /*
     function
 */
 
-// 线程工作函数
-static void* thread_worker(void *param)
+// 初始化使用单调时钟的条件变量，超时等待不受系统时间调整影响
+static STATUS thread_pool_cond_init_monotonic(IN pthread_cond_t *cond)
 {
-    thread_pool_t *thread_pool = (thread_pool_t*)param;
-    task_t task = {0};
+    pthread_condattr_t cattr;
+    int ret = 0;
 
-    while(1)
+    if(0 != pthread_condattr_init(&cattr))
     {
-        pthread_mutex_lock(&thread_pool->lock); // 上锁
+        return ERR_API_ERROR;
+    }
+    ret = pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    if(0 == ret)
+    {
+        ret = pthread_cond_init(cond, &cattr);
+    }
+    pthread_condattr_destroy(&cattr);
 
-        // 等待任务或者关闭
-        while(0 == thread_pool->task_count && false == thread_pool->shutdown_flag)
+    return (0 == ret) ? OK : ERR_API_ERROR;
+}
+
+// 计算timeout_ms毫秒后的单调时钟时刻
+static void thread_pool_deadline(
+    OUT struct timespec *deadline,
+    IN int timeout_ms
+)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if(deadline->tv_nsec >= 1000000000)
+    {
+        deadline->tv_sec += 1;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+// 选择取任务的优先级，调用者持有锁且共享队列非空。按权重轮转：优先取有剩余额度的高优先级队列，
+// 所有非空队列的额度都用完后重新发放，低优先级队列每轮至少能取出weight个任务，不会饿死
+static inline task_lane* task_queue_pick(IN thread_pool_t *pool)
+{
+    unsigned int i = 0;
+
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        if(atomic_load_explicit(&pool->lanes[i].count, memory_order_relaxed) && pool->lanes[i].credit)
         {
-            pthread_cond_wait(&thread_pool->notify, &thread_pool->lock);    // 必须使用while，防止异常唤醒
+            return &pool->lanes[i];
         }
+    }
 
-        // 处理关闭请求
-        if(true == thread_pool->shutdown_flag)
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        pool->lanes[i].credit = pool->lanes[i].weight;
+    }
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        if(atomic_load_explicit(&pool->lanes[i].count, memory_order_relaxed))
         {
-            pthread_mutex_unlock(&thread_pool->lock);
-            pthread_exit(NULL);
+            break;
         }
+    }
 
-        // 执行到这里，应从队列中取出任务执行
-        // 获取队头
-        task.func = thread_pool->task_queue[thread_pool->head].func;
-        task.args = thread_pool->task_queue[thread_pool->head].args;
-        // 修改队列
-        thread_pool->head = (thread_pool->head + 1) % thread_pool->queue_size;
-        thread_pool->task_count -= 1;
+    return &pool->lanes[i];
+}
 
-        pthread_mutex_unlock(&thread_pool->lock);
+// 从共享队列取出任务，调用者持有锁且队列非空
+static inline void task_queue_pop(
+    IN thread_pool_t *pool,
+    OUT task_t *task
+)
+{
+    task_lane *lane = task_queue_pick(pool);
 
-        // 执行任务
-        task.func(task.args);
-    }
+    *task = lane->tasks[lane->head];
+    lane->head = (lane->head + 1) % lane->size;
+    lane->credit -= 1;
+    atomic_store_explicit(&lane->count, lane->count - 1, memory_order_relaxed);
+    pool->task_count -= 1;
 
-    return NULL;
+    // 有提交线程在等待该队列时才通知；还有线程在等其他优先级的队列时，signal可能唤醒错误的线程，改为broadcast
+    if(lane->full_waiters)
+    {
+        if(lane->full_waiters == pool->full_waiters)
+        {
+            pthread_cond_signal(&pool->not_full);
+        }
+        else
+        {
+            pthread_cond_broadcast(&pool->not_full);
+        }
+    }
 }
 
-// 创建线程池
-static thread_pool_t* _thread_pool_create(
-    IN unsigned int thread_count,
-    IN unsigned int queue_size
+// 共享队列扩容一倍，不超过queue_max，调用者持有锁且队列已满；第一次使用时申请初始容量
+static STATUS task_queue_grow(
+    IN thread_pool_t *pool,
+    IN task_lane *lane
 )
 {
-    thread_pool_t *ret = NULL;
+    unsigned int size = (0 == lane->size) ? pool->queue_size :
+                        (lane->size > pool->queue_max / 2) ? pool->queue_max : lane->size * 2;
+    task_t *queue = (task_t*)malloc(sizeof(task_t) * size);
     unsigned int i = 0;
-    unsigned int j = 0;
 
-    // 参数检查
-    if(unlikely(thread_count > THREAD_COUNT_MAX || queue_size > THREAD_QUEUE_SIZE_MAX || thread_count <= 0))
+    if(unlikely(!queue))
     {
-        DBG("invalid param");
-        return NULL;
+        DBG("malloc space of task queue fail");
+        return ERR_NO_MEMORY;
     }
 
-    // 申请线程池变量空间
-    ret = (thread_pool_t*)malloc(sizeof(thread_pool_t));
-    if(unlikely(!ret))
+    // 按顺序搬到新数组开头
+    for(i = 0; i < lane->count; ++ i)
     {
-        DBG("malloc space of thread_pool fail");
-        goto error;
+        queue[i] = lane->tasks[(lane->head + i) % lane->size];
     }
-    memset(ret, 0, sizeof(thread_pool_t));
 
-    // 申请线程数组空间
-    ret->thread_arr = (pthread_t*)malloc(sizeof(pthread_t)*thread_count);
-    if(!ret->thread_arr)
+    free(lane->tasks);
+    lane->tasks = queue;
+    lane->head = 0;
+    lane->tail = lane->count;
+    lane->size = size;
+
+    return OK;
+}
+
+// 添加任务到对应优先级的共享队列尾部，调用者持有锁；队列满且无法扩容时返回ERR_THREAD_POOL_TASK_QUEUE_FULL
+static STATUS task_queue_push(
+    IN thread_pool_t *pool,
+    IN task_lane *lane,
+    IN task_func func,
+    IN void *args
+)
+{
+    if(lane->count == lane->size &&
+       ((lane->size && lane->size >= pool->queue_max) || OK != task_queue_grow(pool, lane)))
     {
-        DBG("malloc space of threads array fail");
-        goto error;
+        return ERR_THREAD_POOL_TASK_QUEUE_FULL;
     }
-    memset(ret->thread_arr, 0, sizeof(pthread_t)*thread_count);
-    ret->thread_count = thread_count;
 
-    // 申请任务队列数组空间
-    ret->task_queue = (task_t*)malloc(sizeof(task_t)*queue_size);
-    if(unlikely(!ret->task_queue))
+    lane->tasks[lane->tail].func = func;
+    lane->tasks[lane->tail].args = args;
+    lane->tail = (lane->tail + 1) % lane->size;
+    atomic_store_explicit(&lane->count, lane->count + 1, memory_order_relaxed);
+    pool->task_count += 1;
+
+    lane->enqueued += 1;
+    if(lane->count > lane->peak)
     {
-        DBG("malloc space of task queue fail");
-        goto error;
+        lane->peak = lane->count;
     }
-    memset(ret->task_queue, 0, sizeof(task_t)*queue_size);
-    ret->head = 0;
-    ret->tail = 0;
-    ret->task_count = 0;
-    ret->queue_size = queue_size;
 
-    // 初始化同步机制
-    if(unlikely(0 != pthread_mutex_init(&ret->lock, NULL)))
+    return OK;
+}
+
+// 申请双端队列的环形数组
+static ws_array* ws_array_create(IN long long capacity)
+{
+    ws_array *a = (ws_array*)malloc(sizeof(ws_array) + sizeof(ws_slot) * capacity);
+
+    if(likely(a))
     {
-        DBG("init mutex fail");
-        goto error;
+        a->mask = capacity - 1;
+        a->retired = NULL;
     }
-    if(unlikely(0 != pthread_cond_init(&ret->notify, NULL)))
+
+    return a;
+}
+
+// 初始化双端队列
+static STATUS ws_deque_init(IN ws_deque *dq)
+{
+    ws_array *a = ws_array_create(WS_DEQUE_INIT);
+
+    if(unlikely(!a))
     {
-        DBG("init cond fail");
-        goto error;
+        return ERR_NO_MEMORY;
     }
 
-    ret->shutdown_flag = 0;
+    atomic_init(&dq->top, 0);
+    atomic_init(&dq->bottom, 0);
+    atomic_init(&dq->array, a);
 
-    // 创建线程，进入工作函数
-    for(i = 0; i < thread_count; ++ i)
-    {
-        if(unlikely(0 != pthread_create(&ret->thread_arr[i], NULL, thread_worker, (void*)ret)))
-        {
-            DBG("create thread %d fail", i);
+    return OK;
+}
 
-            // 终止已经创建的线程
-            for(j = 0; j < i; ++ j)
-                pthread_cancel(ret->thread_arr[j]);
+// 释放双端队列的当前数组和所有旧数组
+static void ws_deque_destroy(IN ws_deque *dq)
+{
+    ws_array *a = atomic_load_explicit(&dq->array, memory_order_relaxed);
+    ws_array *next = NULL;
 
-            goto error;
-        }
+    while(a)
+    {
+        next = a->retired;
+        free(a);
+        a = next;
     }
+    atomic_store_explicit(&dq->array, NULL, memory_order_relaxed);
+}
 
-    return ret;
+// 所有者压入任务，数组满时翻倍
+static STATUS ws_deque_push(
+    IN ws_deque *dq,
+    IN task_func func,
+    IN void *args
+)
+{
+    long long b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    ws_array *a = atomic_load_explicit(&dq->array, memory_order_relaxed);
+    ws_array *grown = NULL;
+    ws_slot *from = NULL;
+    ws_slot *to = NULL;
+    long long i = 0;
 
-error:
+    if(unlikely(b - t > a->mask))
+    {
+        grown = ws_array_create((a->mask + 1) * 2);
+        if(unlikely(!grown))
+        {
+            return ERR_NO_MEMORY;
+        }
+        for(i = t; i < b; ++ i)
+        {
+            from = &a->slots[i & a->mask];
+            to = &grown->slots[i & grown->mask];
+            atomic_store_explicit(&to->func, atomic_load_explicit(&from->func, memory_order_relaxed), memory_order_relaxed);
+            atomic_store_explicit(&to->args, atomic_load_explicit(&from->args, memory_order_relaxed), memory_order_relaxed);
+        }
+        grown->retired = a;
+        atomic_store_explicit(&dq->array, grown, memory_order_release);
+        a = grown;
+    }
 
-    pthread_mutex_destroy(&ret->lock);
-    pthread_cond_destroy(&ret->notify);
-    if(ret->thread_arr) free(ret->thread_arr);
-    if(ret->task_queue) free(ret->task_queue);
-    if(ret) free(ret);
+    atomic_store_explicit(&a->slots[b & a->mask].func, func, memory_order_relaxed);
+    atomic_store_explicit(&a->slots[b & a->mask].args, args, memory_order_relaxed);
+    atomic_store_explicit(&dq->bottom, b + 1, memory_order_release);
 
-    return NULL;
+    return OK;
 }
 
-// 往线程池添加任务
-static STATUS _thread_pool_add_task(
-    IN thread_pool_t *pool,
-    IN task_func func,
-    IN void *args
+// 所有者从bottom端弹出任务，只剩一个任务时与窃取线程CAS竞争
+static bool ws_deque_take(
+    IN ws_deque *dq,
+    OUT task_t *task
 )
 {
-    if(unlikely(!pool || !func))
+    long long b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+    ws_array *a = atomic_load_explicit(&dq->array, memory_order_relaxed);
+    long long t = 0;
+    bool ok = true;
+
+    atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+    if(t > b)
     {
-        return ERR_BAD_PARAM;
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+        return false;
     }
 
-    pthread_mutex_lock(&pool->lock);
+    task->func = atomic_load_explicit(&a->slots[b & a->mask].func, memory_order_relaxed);
+    task->args = atomic_load_explicit(&a->slots[b & a->mask].args, memory_order_relaxed);
+    if(t == b)
+    {
+        ok = atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return ok;
+}
+
+// 其他线程从top端窃取任务，与所有者或其他窃取线程竞争失败时返回false
+static bool ws_deque_steal(
+    IN ws_deque *dq,
+    OUT task_t *task
+)
+{
+    long long t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    long long b = 0;
+    ws_array *a = NULL;
 
-    // 检查队列，已满时直接返回错误
-    if(pool->task_count == pool->queue_size)
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+    if(t >= b)
     {
-        pthread_mutex_unlock(&pool->lock);
-        return ERR_THREAD_POOL_TASK_QUEUE_FULL;
+        return false;
     }
 
-    // 添加任务到队列尾部
-    pool->task_queue[pool->tail].func = func;
-    pool->task_queue[pool->tail].args = args;
-    pool->tail = (pool->tail + 1) % pool->queue_size;
-    pool->task_count += 1;
+    a = atomic_load_explicit(&dq->array, memory_order_acquire);
+    task->func = atomic_load_explicit(&a->slots[t & a->mask].func, memory_order_relaxed);
+    task->args = atomic_load_explicit(&a->slots[t & a->mask].args, memory_order_relaxed);
 
-    // signal
-    pthread_cond_signal(&pool->notify);
-    pthread_mutex_unlock(&pool->lock);
+    return atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+                                                   memory_order_seq_cst, memory_order_relaxed);
+}
 
-    return OK;
+// 双端队列是否有任务
+static inline bool ws_deque_busy(IN ws_deque *dq)
+{
+    return atomic_load(&dq->bottom) > atomic_load(&dq->top);
 }
 
-// 销毁线程池
-static STATUS _thread_pool_destroy(
-    IN thread_pool_t *pool
+// xorshift32
+static inline unsigned int ws_rand(IN thread_worker_t *self)
+{
+    unsigned int x = self->rand;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    self->rand = x;
+
+    return x;
+}
+
+// 工作窃取模式下查找任务：本地队列 -> 共享队列 -> 从随机选择的线程开始依次窃取
+static bool ws_find_task(
+    IN thread_worker_t *self,
+    OUT task_t *task
 )
 {
+    thread_pool_t *pool = self->pool;
+    unsigned int victim = 0;
     unsigned int i = 0;
+    bool found = false;
+    bool high = false;
 
-    if(unlikely(!pool))
+    // 外部提交的高优先级任务不排在本地队列后面
+    high = 0 != atomic_load_explicit(&pool->lanes[THREAD_POOL_PRIO_HIGH].count, memory_order_relaxed);
+    if(!high && ws_deque_take(&self->deque, task))
     {
-        return ERR_BAD_PARAM;
+        return true;
     }
 
-    pthread_mutex_lock(&pool->lock);
-    pool->shutdown_flag = true;
-
-    // 唤醒所有线程
-    pthread_cond_broadcast(&pool->notify);
-    
-    pthread_mutex_unlock(&pool->lock);
+    if(atomic_load_explicit(&pool->task_count, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&pool->lock);
+        if(pool->task_count)
+        {
+            task_queue_pop(pool, task);
+            found = true;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if(found)
+        {
+            return true;
+        }
+    }
 
-    // 等待所有线程退出
-    for(i = 0; i < pool->thread_count; ++ i)
+    if(high && ws_deque_take(&self->deque, task))
     {
-        pthread_join(pool->thread_arr[i], NULL);
+        return true;
     }
 
-    free(pool->thread_arr);
-    free(pool->task_queue);
-    free(pool);
+    // 没有线程的槽队列为空，窃取时不必区分
+    victim = ws_rand(self) % pool->thread_max;
+    for(i = 0; i < pool->thread_max; ++ i)
+    {
+        if(victim != self->index && ws_deque_steal(&pool->workers[victim].deque, task))
+        {
+            return true;
+        }
+        victim = (victim + 1 == pool->thread_max) ? 0 : victim + 1;
+    }
 
-    return OK;
+    return false;
 }
 
-/*
-    Variables
-*/
+// 是否有线程的本地队列非空
+static bool ws_pool_busy(IN thread_pool_t *pool)
+{
+    unsigned int i = 0;
 
-thread_pool_ops thread_pool_operations = {
-    .thread_pool_add_task = _thread_pool_add_task,
-    .thread_pool_create = _thread_pool_create,
-    .thread_pool_destroy = _thread_pool_destroy
-};
+    for(i = 0; i < pool->thread_max; ++ i)
+    {
+        if(ws_deque_busy(&pool->workers[i].deque))
+        {
+            return true;
+        }
+    }
 
-#if THREAD_POOL_TEST
-// 示例任务函数
-void sample_task(void *arg) 
-{
-    int num = *(int *)arg;
-    printf("Task %d processed by thread %lu\n", num, (unsigned long)pthread_self());
-    free(arg); // 清理动态分配的参数
+    return false;
 }
-void thread_pool_test()
+
+// 申请无锁环形队列，容量为不小于size的2的幂
+static lf_ring* lf_ring_create(
+    IN unsigned int size,
+    OUT void **mem
+)
 {
-#if CMOCKA_TEST
-    int i = 0;
+    lf_ring *ring = NULL;
+    size_t capacity = 1;
+    size_t i = 0;
 
-    // 创建4线程+10容量的线程池
-    thread_pool_t *pool = thread_pool_create(4, 10);
-    if (!pool) 
+    while(capacity < size)
     {
-        fprintf(stderr, "Create threadpool failed\n");
-        return;
+        capacity <<= 1;
     }
 
-    // 添加20个任务
-    for (; i < 20; i++) 
+    *mem = malloc(sizeof(lf_ring) + sizeof(lf_cell) * capacity + THREAD_POOL_CACHE_LINE);
+    if(unlikely(!*mem))
     {
-        int *arg = malloc(sizeof(int));
-        *arg = i;
-        while (thread_pool_add_task(pool, sample_task, arg) != 0) 
-        {
-            sched_yield();
-        }
+        return NULL;
     }
+    ring = (lf_ring*)(((uintptr_t)*mem + THREAD_POOL_CACHE_LINE - 1) & ~(uintptr_t)(THREAD_POOL_CACHE_LINE - 1));
 
-    sleep(2); // 等待任务完成
-    thread_pool_destroy(pool); // 关闭
+    ring->mask = capacity - 1;
+    atomic_init(&ring->enqueue_pos, 0);
+    atomic_init(&ring->dequeue_pos, 0);
+    atomic_init(&ring->ec_seq, 0);
+    for(i = 0; i < capacity; ++ i)
+    {
+        atomic_init(&ring->cells[i].seq, i);
+    }
 
-#endif
+    return ring;
 }
 
-#endif
\ No newline at end of file
+// 放入一个任务，队列满时返回false
+static bool lf_ring_push(
+    IN lf_ring *ring,
+    IN task_func func,
+    IN void *args
+)
+{
+    size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    lf_cell *cell = NULL;
+    intptr_t diff = 0;
+
+    while(1)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        diff = (intptr_t)atomic_load_explicit(&cell->seq, memory_order_acquire) - (intptr_t)pos;
+        if(0 == diff)
+        {
+            if(atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->func = func;
+    cell->args = args;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    return true;
+}
+
+// 取出一个任务，队列空时返回false
+static bool lf_ring_pop(
+    IN lf_ring *ring,
+    OUT task_t *task
+)
+{
+    size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+    lf_cell *cell = NULL;
+    intptr_t diff = 0;
+
+    while(1)
+    {
+        cell = &ring->cells[pos & ring->mask];
+        diff = (intptr_t)atomic_load_explicit(&cell->seq, memory_order_acquire) - (intptr_t)(pos + 1);
+        if(0 == diff)
+        {
+            if(atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1,
+                                                     memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    task->func = cell->func;
+    task->args = cell->args;
+    atomic_store_explicit(&cell->seq, pos + ring->mask + 1, memory_order_release);
+
+    return true;
+}
+
+// 队列中是否有任务，包括已经占用位置但还没写完的任务
+static inline bool lf_ring_busy(IN lf_ring *ring)
+{
+    return atomic_load(&ring->enqueue_pos) != atomic_load(&ring->dequeue_pos);
+}
+
+static int lf_futex_wait(
+    IN atomic_uint *addr,
+    IN unsigned int val,
+    IN int timeout_ms
+)
+{
+    struct timespec ts;
+
+    if(timeout_ms >= 0)
+    {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+    }
+    if(0 == syscall(SYS_futex, (unsigned int*)addr, FUTEX_WAIT_PRIVATE, val, (timeout_ms >= 0) ? &ts : NULL, NULL, 0))
+    {
+        return 0;
+    }
+
+    return errno;
+}
+
+static inline void lf_futex_wake(
+    IN atomic_uint *addr,
+    IN int n
+)
+{
+    syscall(SYS_futex, (unsigned int*)addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+// 递增eventcount序号并唤醒n个在futex上等待的线程，不管是否有线程准备休眠
+static inline void lf_wake(
+    IN thread_pool_t *pool,
+    IN int n
+)
+{
+    atomic_fetch_add(&pool->ring->ec_seq, 2);
+    lf_futex_wake(&pool->ring->ec_seq, n);
+}
+
+// 放入任务后唤醒最多n个准备休眠的线程，没有空闲线程时返回false。先有全屏障再读idle，
+// 与空闲线程先登记idle再检查队列配对。上次唤醒后没有线程重新准备休眠时不做系统调用，
+// 被唤醒但还没运行的线程仍计入idle，不会每次提交都去唤醒
+static bool lf_notify(
+    IN thread_pool_t *pool,
+    IN unsigned int n
+)
+{
+    lf_ring *ring = pool->ring;
+    unsigned int idle = 0;
+    unsigned int ec = 0;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    idle = atomic_load_explicit(&pool->idle, memory_order_relaxed);
+    if(0 == idle)
+    {
+        return false;
+    }
+
+    ec = atomic_load_explicit(&ring->ec_seq, memory_order_relaxed);
+    while(ec & 1)
+    {
+        if(atomic_compare_exchange_weak(&ring->ec_seq, &ec, (ec + 2) & ~1u))
+        {
+            lf_futex_wake(&ring->ec_seq, (n < idle) ? (int)n : (int)idle);
+            break;
+        }
+    }
+
+    return true;
+}
+
+// 所有线程都在notify上等待且共享队列为空时，不会再有任务执行，调用者持有锁
+static inline bool thread_pool_quiescent(IN thread_pool_t *pool)
+{
+    // 无锁模式下线程先减少idle再取任务，先看到队列为空再看到全部空闲时，取到的任务都已经执行完
+    return (THREAD_POOL_LOCK_FREE != pool->mode || !lf_ring_busy(pool->ring)) &&
+           0 == pool->task_count &&
+           atomic_load(&pool->thread_count) == atomic_load(&pool->idle);
+}
+
+// 工作线程即将休眠，调用者持有锁并已登记为空闲。有线程在等待drain时检查是否已全部完成
+static inline void thread_pool_notify_drained(IN thread_pool_t *pool)
+{
+    if(pool->drain_waiters && thread_pool_quiescent(pool))
+    {
+        pthread_cond_broadcast(&pool->drained);
+    }
+}
+
+// 空闲线程在notify上等待，调用者持有锁。弹性线程池中多于最少数量时超时返回ETIMEDOUT
+static int thread_pool_idle_wait(IN thread_pool_t *pool)
+{
+    struct timespec deadline;
+
+    if(atomic_load_explicit(&pool->thread_count, memory_order_relaxed) <= pool->thread_min)
+    {
+        return pthread_cond_wait(&pool->notify, &pool->lock);
+    }
+
+    thread_pool_deadline(&deadline, pool->idle_timeout_ms);
+    return pthread_cond_timedwait(&pool->notify, &pool->lock, &deadline);
+}
+
+// 空闲超时后检查能否退出，可以时登记退出，调用者持有锁。之后线程不再访问自己的本地队列
+static bool thread_pool_retire(
+    IN thread_pool_t *pool,
+    IN thread_worker_t *self
+)
+{
+    if(pool->shutdown_flag || pool->task_count ||
+       atomic_load_explicit(&pool->thread_count, memory_order_relaxed) <= pool->thread_min ||
+       (THREAD_POOL_WORK_STEALING == pool->mode && ws_pool_busy(pool)))
+    {
+        return false;
+    }
+
+    atomic_fetch_sub(&pool->thread_count, 1);
+
+    // 无锁模式下提交线程不加锁放入任务，先放入再读线程数量；这里先减少线程数量再检查队列，
+    // 要么对方看到线程减少并增加线程，要么这里看到任务并放弃退出
+    if(THREAD_POOL_LOCK_FREE == pool->mode && lf_ring_busy(pool->ring))
+    {
+        atomic_fetch_add(&pool->thread_count, 1);
+        return false;
+    }
+
+    self->state = WORKER_EXITED;
+    thread_pool_notify_drained(pool);
+
+    return true;
+}
+
+// 工作窃取模式的线程工作函数
+static void* thread_worker_ws(void *param)
+{
+    thread_worker_t *self = (thread_worker_t*)param;
+    thread_pool_t *pool = self->pool;
+    task_t task = {0};
+    int rc = 0;
+
+    tp_self = self;
+
+    while(1)
+    {
+        if(ws_find_task(self, &task))
+        {
+            task.func(task.args);
+            continue;
+        }
+
+        // 没有找到任务，准备休眠
+        pthread_mutex_lock(&pool->lock);
+
+        if(true == pool->shutdown_flag)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        // 先登记为空闲再检查各本地队列：压入本地队列的线程先写bottom再读idle，
+        // 两边都是顺序一致的操作，要么这里看到新任务，要么对方看到空闲线程并在锁内signal
+        if(0 == pool->task_count)
+        {
+            rc = 0;
+            atomic_fetch_add(&pool->idle, 1);
+            if(!ws_pool_busy(pool))
+            {
+                thread_pool_notify_drained(pool);
+                rc = thread_pool_idle_wait(pool);
+            }
+            atomic_fetch_sub(&pool->idle, 1);
+
+            if(ETIMEDOUT == rc && thread_pool_retire(pool, self))
+            {
+                pthread_mutex_unlock(&pool->lock);
+                break;
+            }
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    tp_self = NULL;
+
+    return NULL;
+}
+
+// 无锁模式下取出普通优先级任务。有提交线程在等待空位时，第一个取出任务的线程唤醒它们
+static bool lf_pop_task(
+    IN thread_pool_t *pool,
+    OUT task_t *task
+)
+{
+    if(!lf_ring_pop(pool->ring, task))
+    {
+        return false;
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if(unlikely(atomic_load_explicit(&pool->ring_full, memory_order_relaxed)) &&
+       atomic_exchange(&pool->ring_full, false))
+    {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->not_full);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return true;
+}
+
+// 无锁模式下查找任务。高优先级和低优先级任务在加锁的共享队列中，高优先级队列非空时先取共享队列
+static bool lf_find_task(
+    IN thread_pool_t *pool,
+    OUT task_t *task
+)
+{
+    bool high = 0 != atomic_load_explicit(&pool->lanes[THREAD_POOL_PRIO_HIGH].count, memory_order_relaxed);
+    bool found = false;
+
+    if(!high && lf_pop_task(pool, task))
+    {
+        return true;
+    }
+
+    if(atomic_load_explicit(&pool->task_count, memory_order_relaxed))
+    {
+        pthread_mutex_lock(&pool->lock);
+        if(pool->task_count)
+        {
+            task_queue_pop(pool, task);
+            found = true;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if(found)
+        {
+            return true;
+        }
+    }
+
+    return high && lf_pop_task(pool, task);
+}
+
+// 空闲线程futex等待的超时时间，弹性线程池中多于最少数量时超时退出
+static inline int lf_idle_timeout(IN thread_pool_t *pool)
+{
+    if(atomic_load_explicit(&pool->thread_count, memory_order_relaxed) <= pool->thread_min)
+    {
+        return THREAD_POOL_WAIT_FOREVER;
+    }
+
+    return (int)pool->idle_timeout_ms;
+}
+
+// 无锁模式的线程工作函数，取任务不加锁，队列为空时在eventcount上futex等待
+static void* thread_worker_lf(void *param)
+{
+    thread_worker_t *self = (thread_worker_t*)param;
+    thread_pool_t *pool = self->pool;
+    lf_ring *ring = pool->ring;
+    task_t task = {0};
+    unsigned int key = 0;
+    bool retired = false;
+    bool woken = false;
+    int rc = 0;
+
+    tp_self = self;
+
+    while(1)
+    {
+        if(lf_find_task(pool, &task))
+        {
+            // 提交线程只唤醒一次，被唤醒后还有任务时再唤醒一个线程，逐个接力
+            if(woken && atomic_load_explicit(&pool->idle, memory_order_relaxed) &&
+               (lf_ring_busy(ring) || atomic_load_explicit(&pool->task_count, memory_order_relaxed)))
+            {
+                lf_wake(pool, 1);
+            }
+            woken = false;
+            task.func(task.args);
+            continue;
+        }
+
+        // 先登记为空闲并置位准备休眠，再检查队列：提交线程先放入任务再读idle和eventcount，
+        // 要么这里看到新任务，要么对方看到准备休眠并递增序号，futex等待立即返回
+        atomic_fetch_add(&pool->idle, 1);
+        key = atomic_fetch_or(&ring->ec_seq, 1) | 1;
+
+        if(atomic_load(&pool->shutdown_flag))
+        {
+            atomic_fetch_sub(&pool->idle, 1);
+            break;
+        }
+
+        if(lf_ring_busy(ring) || atomic_load(&pool->task_count))
+        {
+            // 入队位置已经前移但任务可能还没写完，让出CPU给写入的线程
+            atomic_fetch_sub(&pool->idle, 1);
+            sched_yield();
+            continue;
+        }
+
+        if(atomic_load(&pool->drain_waiters))
+        {
+            pthread_mutex_lock(&pool->lock);
+            thread_pool_notify_drained(pool);
+            pthread_mutex_unlock(&pool->lock);
+        }
+
+        rc = lf_futex_wait(&ring->ec_seq, key, lf_idle_timeout(pool));
+        atomic_fetch_sub(&pool->idle, 1);
+        woken = (0 == rc);
+
+        // 弹性线程池中多余的线程空闲超时后退出
+        if(ETIMEDOUT == rc)
+        {
+            pthread_mutex_lock(&pool->lock);
+            retired = thread_pool_retire(pool, self);
+            pthread_mutex_unlock(&pool->lock);
+            if(retired)
+            {
+                break;
+            }
+        }
+    }
+
+    tp_self = NULL;
+
+    return NULL;
+}
+
+// 线程工作函数
+static void* thread_worker(void *param)
+{
+    thread_pool_t *thread_pool = ((thread_worker_t*)param)->pool;
+    task_t task = {0};
+    int rc = 0;
+
+    tp_self = (thread_worker_t*)param;
+
+    while(1)
+    {
+        pthread_mutex_lock(&thread_pool->lock); // 上锁
+
+        // 等待任务或者关闭
+        while(0 == thread_pool->task_count && false == thread_pool->shutdown_flag)
+        {
+            atomic_fetch_add(&thread_pool->idle, 1);
+            thread_pool_notify_drained(thread_pool);
+            rc = thread_pool_idle_wait(thread_pool);    // 必须使用while，防止异常唤醒
+            atomic_fetch_sub(&thread_pool->idle, 1);
+
+            // 弹性线程池中多余的线程空闲超时后退出
+            if(ETIMEDOUT == rc && thread_pool_retire(thread_pool, (thread_worker_t*)param))
+            {
+                pthread_mutex_unlock(&thread_pool->lock);
+                tp_self = NULL;
+                return NULL;
+            }
+        }
+
+        // 处理关闭请求
+        if(true == thread_pool->shutdown_flag)
+        {
+            pthread_mutex_unlock(&thread_pool->lock);
+            pthread_exit(NULL);
+        }
+
+        // 执行到这里，应从队列中取出任务执行
+        task_queue_pop(thread_pool, &task);
+
+        pthread_mutex_unlock(&thread_pool->lock);
+
+        // 执行任务
+        task.func(task.args);
+    }
+
+    return NULL;
+}
+
+static STATUS tp_latch_init(
+    IN tp_latch *latch,
+    IN unsigned int count
+)
+{
+    atomic_init(&latch->count, count);
+    if(unlikely(0 != pthread_mutex_init(&latch->lock, NULL)))
+    {
+        return ERR_API_ERROR;
+    }
+    if(unlikely(OK != thread_pool_cond_init_monotonic(&latch->cond)))
+    {
+        pthread_mutex_destroy(&latch->lock);
+        return ERR_API_ERROR;
+    }
+
+    return OK;
+}
+
+static void tp_latch_destroy(IN tp_latch *latch)
+{
+    pthread_mutex_destroy(&latch->lock);
+    pthread_cond_destroy(&latch->cond);
+}
+
+static inline void tp_latch_add(
+    IN tp_latch *latch,
+    IN unsigned int n
+)
+{
+    atomic_fetch_add_explicit(&latch->count, n, memory_order_relaxed);
+}
+
+// 计数减少n，n不超过当前计数
+static void tp_latch_count_down_n(
+    IN tp_latch *latch,
+    IN unsigned int n
+)
+{
+    unsigned int count = atomic_load_explicit(&latch->count, memory_order_relaxed);
+
+    while(count > n)
+    {
+        if(atomic_compare_exchange_weak_explicit(&latch->count, &count, count - n, memory_order_release, memory_order_relaxed))
+        {
+            return;
+        }
+    }
+
+    // 可能是最后一次递减，在锁内完成，之后不再访问latch
+    pthread_mutex_lock(&latch->lock);
+    if(n == atomic_fetch_sub(&latch->count, n))
+    {
+        pthread_cond_broadcast(&latch->cond);
+    }
+    pthread_mutex_unlock(&latch->lock);
+}
+
+static inline void tp_latch_count_down(IN tp_latch *latch)
+{
+    tp_latch_count_down_n(latch, 1);
+}
+
+// 等待计数归零，timeout_ms为0时只检查，THREAD_POOL_WAIT_FOREVER一直等待
+static STATUS tp_latch_wait(
+    IN tp_latch *latch,
+    IN int timeout_ms
+)
+{
+    struct timespec deadline;
+    STATUS ret = OK;
+    int rc = 0;
+
+    if(timeout_ms > 0)
+    {
+        thread_pool_deadline(&deadline, timeout_ms);
+    }
+
+    pthread_mutex_lock(&latch->lock);
+    while(atomic_load(&latch->count) && 0 != timeout_ms && ETIMEDOUT != rc)
+    {
+        rc = (timeout_ms < 0) ? pthread_cond_wait(&latch->cond, &latch->lock) :
+                                pthread_cond_timedwait(&latch->cond, &latch->lock, &deadline);
+    }
+    ret = atomic_load(&latch->count) ? ERR_THREAD_POOL_TIMEOUT : OK;
+    pthread_mutex_unlock(&latch->lock);
+
+    return ret;
+}
+
+// 各调度模式的线程工作函数
+static void* (*thread_pool_worker_func(IN THREAD_POOL_MODE mode))(void*)
+{
+    if(THREAD_POOL_WORK_STEALING == mode)
+    {
+        return thread_worker_ws;
+    }
+    if(THREAD_POOL_LOCK_FREE == mode)
+    {
+        return thread_worker_lf;
+    }
+
+    return thread_worker;
+}
+
+// 在空闲的槽上启动一个工作线程，调用者持有锁。已退出线程的槽先回收，
+// 该线程登记退出后不再需要锁，这里join不会死锁
+static STATUS thread_pool_spawn(IN thread_pool_t *pool)
+{
+    thread_worker_t *worker = NULL;
+    pthread_attr_t tattr;
+    char name[16];
+    unsigned int i = 0;
+    int rc = 0;
+
+    for(i = 0; i < pool->thread_max; ++ i)
+    {
+        worker = &pool->workers[i];
+        if(WORKER_RUNNING == worker->state)
+        {
+            continue;
+        }
+        if(WORKER_EXITED == worker->state)
+        {
+            pthread_join(worker->tid, NULL);
+            worker->state = WORKER_FREE;
+        }
+
+        // 栈大小和CPU绑定在创建前设置，线程从一开始就在绑定的CPU上运行，栈也在那里分配
+        if(unlikely(0 != pthread_attr_init(&tattr)))
+        {
+            return ERR_API_ERROR;
+        }
+        if(pool->stack_size)
+        {
+            rc = pthread_attr_setstacksize(&tattr, pool->stack_size);
+        }
+        if(0 == rc && worker->pinned)
+        {
+            rc = pthread_attr_setaffinity_np(&tattr, sizeof(cpu_set_t), &worker->cpus);
+        }
+        if(0 == rc)
+        {
+            rc = pthread_create(&worker->tid, &tattr, thread_pool_worker_func(pool->mode), (void*)worker);
+        }
+        pthread_attr_destroy(&tattr);
+        if(unlikely(0 != rc))
+        {
+            DBG("create thread %u fail, %d", i, rc);
+            return ERR_API_ERROR;
+        }
+
+        // 线程名只用于调试，设置失败不影响运行
+        if(pool->name[0])
+        {
+            snprintf(name, sizeof(name), "%s-%u", pool->name, i % 100);   // 下标不超过THREAD_COUNT_MAX
+            pthread_setname_np(worker->tid, name);
+        }
+
+        worker->state = WORKER_RUNNING;
+        atomic_fetch_add(&pool->thread_count, 1);
+        return OK;
+    }
+
+    return ERR_API_ERROR;
+}
+
+// 共享队列和环形队列中排队的任务数量
+static inline unsigned int thread_pool_backlog(IN thread_pool_t *pool)
+{
+    unsigned int ret = atomic_load_explicit(&pool->task_count, memory_order_relaxed);
+
+    if(THREAD_POOL_LOCK_FREE == pool->mode)
+    {
+        ret += (unsigned int)(atomic_load_explicit(&pool->ring->enqueue_pos, memory_order_relaxed) -
+                              atomic_load_explicit(&pool->ring->dequeue_pos, memory_order_relaxed));
+    }
+
+    return ret;
+}
+
+// 弹性线程池中积压的任务多于空闲线程时增加线程，backlog为刚放入的任务数量，调用者持有锁。
+// 已被唤醒但还没取到任务的线程仍计入空闲，因此同时按排队的任务总数计算
+static void thread_pool_grow(
+    IN thread_pool_t *pool,
+    IN unsigned int backlog
+)
+{
+    unsigned int idle = atomic_load_explicit(&pool->idle, memory_order_relaxed);
+    unsigned int queued = thread_pool_backlog(pool);
+
+    if(backlog < queued)
+    {
+        backlog = queued;
+    }
+
+    while(backlog > idle && atomic_load_explicit(&pool->thread_count, memory_order_relaxed) < pool->thread_max &&
+          !pool->shutdown_flag && OK == thread_pool_spawn(pool))
+    {
+        -- backlog;
+    }
+}
+
+// 按属性计算每个槽绑定的CPU集合
+static STATUS thread_pool_pin_init(
+    IN thread_pool_t *pool,
+    IN const thread_pool_attr *attr
+)
+{
+    const thread_pool_cpuset *set = NULL;
+    thread_worker_t *worker = NULL;
+    cpu_set_t allowed;
+    unsigned int cpus[THREAD_POOL_CPU_MAX];
+    unsigned int cpu_count = 0;
+    unsigned int i = 0;
+    unsigned int cpu = 0;
+
+    if(THREAD_POOL_PIN_ROUND_ROBIN == attr->pin)
+    {
+        // 只在进程允许的CPU上轮流绑定，容器或taskset限制的CPU不会被用到
+        CPU_ZERO(&allowed);
+        if(0 != sched_getaffinity(0, sizeof(allowed), &allowed))
+        {
+            return ERR_API_ERROR;
+        }
+        for(cpu = 0; cpu < CPU_SETSIZE && cpu < THREAD_POOL_CPU_MAX; ++ cpu)
+        {
+            if(CPU_ISSET(cpu, &allowed))
+            {
+                cpus[cpu_count ++] = cpu;
+            }
+        }
+        if(0 == cpu_count)
+        {
+            return ERR_API_ERROR;
+        }
+    }
+
+    for(i = 0; i < pool->thread_max; ++ i)
+    {
+        worker = &pool->workers[i];
+        CPU_ZERO(&worker->cpus);
+        if(THREAD_POOL_PIN_ROUND_ROBIN == attr->pin)
+        {
+            CPU_SET(cpus[i % cpu_count], &worker->cpus);
+            worker->pinned = true;
+        }
+        else if(THREAD_POOL_PIN_CPUSET == attr->pin)
+        {
+            set = &attr->cpusets[i % attr->cpuset_count];
+            for(cpu = 0; cpu < CPU_SETSIZE && cpu < THREAD_POOL_CPU_MAX; ++ cpu)
+            {
+                if(set->bits[cpu / 64] & (1ull << (cpu % 64)))
+                {
+                    CPU_SET(cpu, &worker->cpus);
+                }
+            }
+            if(0 == CPU_COUNT(&worker->cpus))
+            {
+                return ERR_BAD_PARAM;
+            }
+            worker->pinned = true;
+        }
+    }
+
+    return OK;
+}
+
+// 设置关闭标志后唤醒所有空闲线程，调用者持有锁
+static void thread_pool_wake_all(IN thread_pool_t *pool)
+{
+    pthread_cond_broadcast(&pool->notify);
+    if(THREAD_POOL_LOCK_FREE == pool->mode)
+    {
+        lf_wake(pool, INT_MAX);
+    }
+}
+
+// 回收所有线程，调用者不持有锁且已设置关闭标志
+static void thread_pool_join_all(IN thread_pool_t *pool)
+{
+    unsigned int i = 0;
+
+    for(i = 0; i < pool->thread_max; ++ i)
+    {
+        if(WORKER_FREE != pool->workers[i].state)
+        {
+            pthread_join(pool->workers[i].tid, NULL);
+            pool->workers[i].state = WORKER_FREE;
+        }
+    }
+}
+
+// 按属性创建线程池，线程池结构和工作线程数组一次申请
+static thread_pool_t* _thread_pool_create_ex(
+    IN const thread_pool_attr *attr
+)
+{
+    thread_pool_t *ret = NULL;
+    thread_worker_t *worker = NULL;
+    const unsigned int weight[THREAD_POOL_PRIO_COUNT] = THREAD_POOL_PRIO_WEIGHT;
+    unsigned int thread_max = 0;
+    unsigned int i = 0;
+    size_t size = 0;
+
+    // 参数检查，thread_max为0时线程数量固定
+    thread_max = (attr && attr->thread_max) ? attr->thread_max : (attr ? attr->thread_count : 0);
+    if(unlikely(!attr || thread_max > THREAD_COUNT_MAX || attr->queue_size > THREAD_QUEUE_SIZE_MAX ||
+                thread_max <= 0 || attr->thread_count > thread_max || attr->queue_size <= 0 ||
+                (attr->queue_max && attr->queue_max < attr->queue_size) ||
+                (attr->mode != THREAD_POOL_SHARED_QUEUE && attr->mode != THREAD_POOL_WORK_STEALING &&
+                 attr->mode != THREAD_POOL_LOCK_FREE) ||
+                (attr->pin != THREAD_POOL_PIN_NONE && attr->pin != THREAD_POOL_PIN_ROUND_ROBIN &&
+                 attr->pin != THREAD_POOL_PIN_CPUSET) ||
+                (THREAD_POOL_PIN_CPUSET == attr->pin && (!attr->cpusets || 0 == attr->cpuset_count))))
+    {
+        DBG("invalid param");
+        return NULL;
+    }
+
+    // 申请线程池变量空间，多申请一个缓存行用于工作线程数组对齐
+    size = sizeof(thread_pool_t) + THREAD_POOL_CACHE_LINE + sizeof(thread_worker_t) * thread_max;
+    ret = (thread_pool_t*)malloc(size);
+    if(unlikely(!ret))
+    {
+        DBG("malloc space of thread_pool fail");
+        return NULL;
+    }
+    memset(ret, 0, size);
+
+    ret->workers = (thread_worker_t*)(((uintptr_t)(ret + 1) + THREAD_POOL_CACHE_LINE - 1) &
+                                      ~(uintptr_t)(THREAD_POOL_CACHE_LINE - 1));
+    atomic_init(&ret->thread_count, 0);
+    ret->thread_min = attr->thread_count;
+    ret->thread_max = thread_max;
+    ret->idle_timeout_ms = attr->idle_timeout_ms ? attr->idle_timeout_ms : THREAD_POOL_IDLE_TIMEOUT;
+    ret->stack_size = attr->stack_size;
+    if(attr->name)
+    {
+        snprintf(ret->name, sizeof(ret->name), "%s", attr->name);
+    }
+    ret->mode = attr->mode;
+    atomic_init(&ret->idle, 0);
+
+    // 各优先级的任务队列在第一次放入任务时申请
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        ret->lanes[i].tasks = NULL;
+        ret->lanes[i].size = 0;
+        atomic_init(&ret->lanes[i].count, 0);
+        ret->lanes[i].weight = attr->prio_weight[i] ? attr->prio_weight[i] : weight[i];
+        ret->lanes[i].credit = ret->lanes[i].weight;
+    }
+    atomic_init(&ret->task_count, 0);
+    ret->queue_size = attr->queue_size;
+    ret->queue_max = attr->queue_max ? attr->queue_max : attr->queue_size;
+    ret->full_waiters = 0;
+    atomic_init(&ret->ring_full, false);
+
+    // 无锁模式下普通优先级任务放入固定容量的环形队列
+    if(THREAD_POOL_LOCK_FREE == attr->mode)
+    {
+        ret->ring = lf_ring_create(attr->queue_size, &ret->ring_mem);
+        if(unlikely(!ret->ring))
+        {
+            DBG("malloc space of ring fail");
+            goto error;
+        }
+    }
+
+    // 工作窃取模式下每个槽一个双端队列
+    for(i = 0; i < thread_max; ++ i)
+    {
+        worker = &ret->workers[i];
+        worker->pool = ret;
+        worker->index = i;
+        worker->rand = 0x9E3779B9u * (i + 1);
+        worker->state = WORKER_FREE;
+        if(THREAD_POOL_WORK_STEALING == attr->mode && unlikely(OK != ws_deque_init(&worker->deque)))
+        {
+            DBG("malloc space of deque fail");
+            goto error;
+        }
+    }
+    if(unlikely(OK != thread_pool_pin_init(ret, attr)))
+    {
+        DBG("invalid cpu set");
+        goto error;
+    }
+
+    // 初始化同步机制，notify在弹性线程池中用于空闲超时，使用单调时钟
+    if(unlikely(0 != pthread_mutex_init(&ret->lock, NULL)))
+    {
+        DBG("init mutex fail");
+        goto error;
+    }
+    if(unlikely(OK != thread_pool_cond_init_monotonic(&ret->notify)))
+    {
+        DBG("init cond fail");
+        pthread_mutex_destroy(&ret->lock);
+        goto error;
+    }
+    if(unlikely(OK != thread_pool_cond_init_monotonic(&ret->not_full)))
+    {
+        DBG("init cond fail");
+        pthread_cond_destroy(&ret->notify);
+        pthread_mutex_destroy(&ret->lock);
+        goto error;
+    }
+    if(unlikely(0 != pthread_cond_init(&ret->drained, NULL)))
+    {
+        DBG("init cond fail");
+        pthread_cond_destroy(&ret->not_full);
+        pthread_cond_destroy(&ret->notify);
+        pthread_mutex_destroy(&ret->lock);
+        goto error;
+    }
+
+    ret->shutdown_flag = 0;
+
+    // 创建最少数量的线程，进入工作函数
+    pthread_mutex_lock(&ret->lock);
+    for(i = 0; i < ret->thread_min; ++ i)
+    {
+        if(unlikely(OK != thread_pool_spawn(ret)))
+        {
+            // 终止已经创建的线程
+            ret->shutdown_flag = true;
+            thread_pool_wake_all(ret);
+            pthread_mutex_unlock(&ret->lock);
+            thread_pool_join_all(ret);
+
+            pthread_mutex_destroy(&ret->lock);
+            pthread_cond_destroy(&ret->notify);
+            pthread_cond_destroy(&ret->not_full);
+            pthread_cond_destroy(&ret->drained);
+            goto error;
+        }
+    }
+    pthread_mutex_unlock(&ret->lock);
+
+    return ret;
+
+error:
+
+    for(i = 0; i < ret->thread_max; ++ i)
+    {
+        ws_deque_destroy(&ret->workers[i].deque);
+    }
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        if(ret->lanes[i].tasks) free(ret->lanes[i].tasks);
+    }
+    if(ret->ring_mem) free(ret->ring_mem);
+    free(ret);
+
+    return NULL;
+}
+
+// 创建线程池，使用共享任务队列
+static thread_pool_t* _thread_pool_create(
+    IN unsigned int thread_count,
+    IN unsigned int queue_size
+)
+{
+    thread_pool_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = thread_count;
+    attr.queue_size = queue_size;
+    attr.queue_max = 0;
+    attr.mode = THREAD_POOL_SHARED_QUEUE;
+
+    return _thread_pool_create_ex(&attr);
+}
+
+// 唤醒min(n, 空闲线程数)个线程，调用者持有锁。被唤醒的线程在取得锁之前仍计入空闲，
+// 这里可能少唤醒，但线程只在共享队列为空时休眠，已唤醒的线程会继续取完剩余任务
+static void thread_pool_wake(
+    IN thread_pool_t *pool,
+    IN unsigned int n
+)
+{
+    unsigned int idle = atomic_load_explicit(&pool->idle, memory_order_relaxed);
+
+    // 无锁模式下空闲线程在eventcount上等待
+    if(THREAD_POOL_LOCK_FREE == pool->mode)
+    {
+        if(n)
+        {
+            lf_notify(pool, n);
+        }
+        return;
+    }
+
+    if(n >= idle)
+    {
+        if(idle)
+        {
+            pthread_cond_broadcast(&pool->notify);
+        }
+        return;
+    }
+    while(n --)
+    {
+        pthread_cond_signal(&pool->notify);
+    }
+}
+
+// 批量添加任务，整批在一次加锁内放入prio对应的队列。队列满时按timeout_ms等待：0不等待，THREAD_POOL_WAIT_FOREVER一直等待；
+// added返回已放入的任务数量，可为NULL
+static STATUS _thread_pool_submit_tasks(
+    IN thread_pool_t *pool,
+    IN const thread_pool_task *tasks,
+    IN unsigned int n,
+    OUT unsigned int *added,
+    IN THREAD_POOL_PRIO prio,
+    IN int timeout_ms
+)
+{
+    struct timespec deadline;
+    task_lane *lane = NULL;
+    STATUS ret = OK;
+    unsigned int done = 0;
+    unsigned int woken = 0;
+    unsigned int i = 0;
+    bool grow = false;
+    int rc = 0;
+
+    if(added)
+    {
+        *added = 0;
+    }
+    if(unlikely(!pool || (!tasks && n) || (unsigned int)prio >= THREAD_POOL_PRIO_COUNT))
+    {
+        return ERR_BAD_PARAM;
+    }
+    for(i = 0; i < n; ++ i)
+    {
+        if(unlikely(!tasks[i].func))
+        {
+            return ERR_BAD_PARAM;
+        }
+    }
+
+    // 工作窃取模式下任务中提交的普通优先级任务放入本线程的队列，不加锁；有线程在休眠时才去唤醒
+    if(THREAD_POOL_PRIO_NORMAL == prio && THREAD_POOL_WORK_STEALING == pool->mode && tp_self && tp_self->pool == pool)
+    {
+        while(done < n && OK == (ret = ws_deque_push(&tp_self->deque, tasks[done].func, tasks[done].args)))
+        {
+            ++ done;
+        }
+        atomic_thread_fence(memory_order_seq_cst);
+        if(done && atomic_load_explicit(&pool->idle, memory_order_relaxed))
+        {
+            pthread_mutex_lock(&pool->lock);
+            thread_pool_wake(pool, done);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        else if(done && atomic_load_explicit(&pool->thread_count, memory_order_relaxed) < pool->thread_max)
+        {
+            // 没有空闲线程，弹性线程池增加线程窃取本地队列中的任务
+            pthread_mutex_lock(&pool->lock);
+            thread_pool_grow(pool, done);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        if(added)
+        {
+            *added = done;
+        }
+        return ret;
+    }
+
+    // 无锁模式下普通优先级任务不加锁放入环形队列，有线程在休眠时才去唤醒；队列满且需要等待时再加锁
+    if(THREAD_POOL_PRIO_NORMAL == prio && THREAD_POOL_LOCK_FREE == pool->mode)
+    {
+        while(done < n && lf_ring_push(pool->ring, tasks[done].func, tasks[done].args))
+        {
+            ++ done;
+        }
+        // 弹性线程池中没有空闲线程，或者排队的任务多于空闲线程时增加线程
+        grow = done && !lf_notify(pool, done);
+        if(done && atomic_load_explicit(&pool->thread_count, memory_order_relaxed) < pool->thread_max &&
+           (grow || thread_pool_backlog(pool) > atomic_load_explicit(&pool->idle, memory_order_relaxed)))
+        {
+            pthread_mutex_lock(&pool->lock);
+            thread_pool_grow(pool, done);
+            pthread_mutex_unlock(&pool->lock);
+        }
+        if(done == n || 0 == timeout_ms)
+        {
+            if(added)
+            {
+                *added = done;
+            }
+            return (done == n) ? OK : ERR_THREAD_POOL_TASK_QUEUE_FULL;
+        }
+        woken = done;
+    }
+    else
+    {
+        lane = &pool->lanes[prio];
+    }
+
+    if(timeout_ms > 0)
+    {
+        thread_pool_deadline(&deadline, timeout_ms);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    // 队列满时在not_full上休眠，工作线程取走任务后唤醒
+    while(done < n)
+    {
+        ret = lane ? task_queue_push(pool, lane, tasks[done].func, tasks[done].args) :
+                     (lf_ring_push(pool->ring, tasks[done].func, tasks[done].args) ? OK : ERR_THREAD_POOL_TASK_QUEUE_FULL);
+        if(OK == ret)
+        {
+            ++ done;
+            continue;
+        }
+        if(pool->shutdown_flag)
+        {
+            ret = ERR_THREAD_POOL_SHUTDOWN;
+            break;
+        }
+        if(0 == timeout_ms || ETIMEDOUT == rc)
+        {
+            break;
+        }
+
+        // 休眠前唤醒线程处理已放入的任务
+        thread_pool_wake(pool, done - woken);
+        thread_pool_grow(pool, done - woken);
+        woken = done;
+
+        ++ pool->full_waiters;
+        if(lane)
+        {
+            ++ lane->full_waiters;
+        }
+        else
+        {
+            // 无锁队列的消费者取出任务后不加锁读取ring_full，登记后再试一次，避免错过唤醒
+            atomic_store(&pool->ring_full, true);
+            atomic_thread_fence(memory_order_seq_cst);
+        }
+        if(!lane && lf_ring_push(pool->ring, tasks[done].func, tasks[done].args))
+        {
+            ret = OK;
+            ++ done;
+        }
+        else
+        {
+            rc = (timeout_ms < 0) ? pthread_cond_wait(&pool->not_full, &pool->lock) :
+                                    pthread_cond_timedwait(&pool->not_full, &pool->lock, &deadline);
+        }
+        if(lane)
+        {
+            -- lane->full_waiters;
+        }
+        -- pool->full_waiters;
+
+        // 销毁线程池时等待所有提交线程离开
+        if(pool->shutdown_flag && 0 == pool->full_waiters)
+        {
+            pthread_cond_broadcast(&pool->not_full);
+        }
+    }
+
+    thread_pool_wake(pool, done - woken);
+    thread_pool_grow(pool, done - woken);
+    pthread_mutex_unlock(&pool->lock);
+
+    if(added)
+    {
+        *added = done;
+    }
+
+    return ret;
+}
+
+// 按优先级添加任务，队列满时按timeout_ms等待：0不等待，THREAD_POOL_WAIT_FOREVER一直等待
+static STATUS _thread_pool_submit(
+    IN thread_pool_t *pool,
+    IN task_func func,
+    IN void *args,
+    IN THREAD_POOL_PRIO prio,
+    IN int timeout_ms
+)
+{
+    thread_pool_task task;
+
+    if(unlikely(!func))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    task.func = func;
+    task.args = args;
+
+    return _thread_pool_submit_tasks(pool, &task, 1, NULL, prio, timeout_ms);
+}
+
+// 往线程池添加任务，队列满时直接返回错误
+static STATUS _thread_pool_add_task(
+    IN thread_pool_t *pool,
+    IN task_func func,
+    IN void *args
+)
+{
+    return _thread_pool_submit(pool, func, args, THREAD_POOL_PRIO_NORMAL, 0);
+}
+
+// 等待所有线程空闲且共享队列为空，调用者持有锁
+static void thread_pool_wait_quiescent(IN thread_pool_t *pool)
+{
+    // 先登记再检查，无锁模式下线程不加锁读取drain_waiters
+    ++ pool->drain_waiters;
+    while(!thread_pool_quiescent(pool))
+    {
+        pthread_cond_wait(&pool->drained, &pool->lock);
+    }
+    -- pool->drain_waiters;
+}
+
+// 等待已提交的任务全部完成
+static STATUS _thread_pool_drain(
+    IN thread_pool_t *pool
+)
+{
+    // 在自己的任务中等待，当前线程永远不会空闲
+    if(unlikely(!pool || (tp_self && tp_self->pool == pool)))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    thread_pool_wait_quiescent(pool);
+    pthread_mutex_unlock(&pool->lock);
+
+    return OK;
+}
+
+// 获取当前工作线程数量
+static STATUS _thread_pool_get_thread_count(
+    IN thread_pool_t *pool,
+    OUT unsigned int *count
+)
+{
+    if(unlikely(!pool || !count))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    *count = atomic_load(&pool->thread_count);
+
+    return OK;
+}
+
+// 获取各优先级队列的统计
+static STATUS _thread_pool_get_stats(
+    IN thread_pool_t *pool,
+    OUT thread_pool_stats *stats
+)
+{
+    unsigned int i = 0;
+
+    if(unlikely(!pool || !stats))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        stats->depth[i] = pool->lanes[i].count;
+        stats->peak_depth[i] = pool->lanes[i].peak;
+        stats->enqueued[i] = pool->lanes[i].enqueued;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // 无锁模式下普通优先级任务在环形队列中，入队位置就是累计放入的数量
+    if(THREAD_POOL_LOCK_FREE == pool->mode)
+    {
+        stats->enqueued[THREAD_POOL_PRIO_NORMAL] = atomic_load(&pool->ring->enqueue_pos);
+        stats->depth[THREAD_POOL_PRIO_NORMAL] =
+            (unsigned int)(stats->enqueued[THREAD_POOL_PRIO_NORMAL] - atomic_load(&pool->ring->dequeue_pos));
+    }
+
+    return OK;
+}
+
+// 销毁线程池
+static STATUS _thread_pool_destroy(
+    IN thread_pool_t *pool
+)
+{
+    unsigned int i = 0;
+
+    if(unlikely(!pool))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    // 先执行完队列中的任务，再通知线程退出
+    pthread_mutex_lock(&pool->lock);
+    thread_pool_wait_quiescent(pool);
+    pool->shutdown_flag = true;
+
+    // 唤醒所有线程，以及等待队列空位的提交线程，等它们离开后才能释放
+    thread_pool_wake_all(pool);
+    pthread_cond_broadcast(&pool->not_full);
+    while(pool->full_waiters)
+    {
+        pthread_cond_wait(&pool->not_full, &pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    // 等待所有线程退出，包括已经退出还没有回收的线程
+    thread_pool_join_all(pool);
+
+    for(i = 0; i < pool->thread_max; ++ i)
+    {
+        ws_deque_destroy(&pool->workers[i].deque);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->notify);
+    pthread_cond_destroy(&pool->not_full);
+    pthread_cond_destroy(&pool->drained);
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        free(pool->lanes[i].tasks);
+    }
+    free(pool->ring_mem);
+    free(pool);
+
+    return OK;
+}
+
+static void thread_pool_future_release(IN thread_pool_future *future)
+{
+    if(1 == atomic_fetch_sub(&future->refs, 1))
+    {
+        tp_latch_destroy(&future->done);
+        free(future);
+    }
+}
+
+// future任务的包装，保存返回值后唤醒等待者
+static void thread_pool_future_run(IN void *arg)
+{
+    thread_pool_future *future = (thread_pool_future*)arg;
+
+    future->result = future->func(future->args);
+    tp_latch_count_down(&future->done);
+    thread_pool_future_release(future);
+}
+
+// 提交有返回值的任务
+static STATUS _thread_pool_submit_future(
+    IN thread_pool_t *pool,
+    IN task_result_func func,
+    IN void *args,
+    OUT thread_pool_future **future
+)
+{
+    thread_pool_future *ret = NULL;
+    STATUS status = OK;
+    int timeout_ms = THREAD_POOL_WAIT_FOREVER;
+
+    if(unlikely(!pool || !func || !future))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    ret = (thread_pool_future*)malloc(sizeof(thread_pool_future));
+    if(unlikely(!ret))
+    {
+        DBG("malloc space of future fail");
+        return ERR_NO_MEMORY;
+    }
+    if(unlikely(OK != tp_latch_init(&ret->done, 1)))
+    {
+        free(ret);
+        return ERR_API_ERROR;
+    }
+    ret->func = func;
+    ret->args = args;
+    ret->result = NULL;
+    atomic_init(&ret->refs, 2);
+
+    // 在该线程池的任务中提交时不等待队列空位，队列满时在调用线程执行，避免所有工作线程都在等待空位
+    if(tp_self && tp_self->pool == pool)
+    {
+        timeout_ms = 0;
+    }
+    status = _thread_pool_submit(pool, thread_pool_future_run, ret, THREAD_POOL_PRIO_NORMAL, timeout_ms);
+    if(ERR_THREAD_POOL_TASK_QUEUE_FULL == status && 0 == timeout_ms)
+    {
+        thread_pool_future_run(ret);
+        status = OK;
+    }
+    if(unlikely(OK != status))
+    {
+        tp_latch_destroy(&ret->done);
+        free(ret);
+        return status;
+    }
+
+    *future = ret;
+
+    return OK;
+}
+
+// 等待future完成
+static STATUS _thread_pool_future_wait(
+    IN thread_pool_future *future,
+    IN int timeout_ms,
+    OUT void **result
+)
+{
+    STATUS ret = OK;
+
+    if(unlikely(!future))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    ret = tp_latch_wait(&future->done, timeout_ms);
+    if(OK == ret && result)
+    {
+        *result = future->result;
+    }
+
+    return ret;
+}
+
+// future是否已完成
+static bool _thread_pool_future_done(
+    IN thread_pool_future *future
+)
+{
+    return future && 0 == atomic_load(&future->done.count);
+}
+
+// 释放future
+static STATUS _thread_pool_future_destroy(
+    IN thread_pool_future *future
+)
+{
+    if(unlikely(!future))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    thread_pool_future_release(future);
+
+    return OK;
+}
+
+// 创建任务组
+static thread_pool_group* _thread_pool_group_create(
+    IN thread_pool_t *pool
+)
+{
+    thread_pool_group *ret = NULL;
+
+    if(unlikely(!pool))
+    {
+        DBG("invalid param");
+        return NULL;
+    }
+
+    ret = (thread_pool_group*)malloc(sizeof(thread_pool_group));
+    if(unlikely(!ret))
+    {
+        DBG("malloc space of group fail");
+        return NULL;
+    }
+    if(unlikely(OK != tp_latch_init(&ret->pending, 0)))
+    {
+        free(ret);
+        return NULL;
+    }
+    ret->pool = pool;
+
+    return ret;
+}
+
+// 任务组中任务的包装，执行完后减少组的计数
+static void thread_pool_group_run(IN void *arg)
+{
+    tp_group_task *task = (tp_group_task*)arg;
+    thread_pool_group *group = task->group;
+
+    task->func(task->args);
+    free(task);
+    tp_latch_count_down(&group->pending);
+}
+
+// 往任务组添加任务
+static STATUS _thread_pool_group_add(
+    IN thread_pool_group *group,
+    IN task_func func,
+    IN void *args
+)
+{
+    tp_group_task *task = NULL;
+    STATUS ret = OK;
+    int timeout_ms = THREAD_POOL_WAIT_FOREVER;
+
+    if(unlikely(!group || !func))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    task = (tp_group_task*)malloc(sizeof(tp_group_task));
+    if(unlikely(!task))
+    {
+        DBG("malloc space of group task fail");
+        return ERR_NO_MEMORY;
+    }
+    task->group = group;
+    task->func = func;
+    task->args = args;
+
+    // 先计数再提交，任务可能在提交返回前就执行完。在该线程池的任务中添加时同thread_pool_submit_future，
+    // 队列满时在调用线程执行
+    tp_latch_add(&group->pending, 1);
+    if(tp_self && tp_self->pool == group->pool)
+    {
+        timeout_ms = 0;
+    }
+    ret = _thread_pool_submit(group->pool, thread_pool_group_run, task, THREAD_POOL_PRIO_NORMAL, timeout_ms);
+    if(ERR_THREAD_POOL_TASK_QUEUE_FULL == ret && 0 == timeout_ms)
+    {
+        thread_pool_group_run(task);
+        return OK;
+    }
+    if(unlikely(OK != ret))
+    {
+        free(task);
+        tp_latch_count_down(&group->pending);
+    }
+
+    return ret;
+}
+
+// 等待任务组的任务全部完成
+static STATUS _thread_pool_group_wait(
+    IN thread_pool_group *group,
+    IN int timeout_ms
+)
+{
+    if(unlikely(!group))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return tp_latch_wait(&group->pending, timeout_ms);
+}
+
+// 销毁任务组
+static STATUS _thread_pool_group_destroy(
+    IN thread_pool_group *group
+)
+{
+    if(unlikely(!group))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    tp_latch_wait(&group->pending, THREAD_POOL_WAIT_FOREVER);
+    tp_latch_destroy(&group->pending);
+    free(group);
+
+    return OK;
+}
+
+// 创建任务图
+static thread_pool_graph* _thread_pool_graph_create(void)
+{
+    thread_pool_graph *ret = NULL;
+
+    ret = (thread_pool_graph*)malloc(sizeof(thread_pool_graph));
+    if(unlikely(!ret))
+    {
+        DBG("malloc space of graph fail");
+        return NULL;
+    }
+    if(unlikely(OK != tp_latch_init(&ret->done, 0)))
+    {
+        free(ret);
+        return NULL;
+    }
+    ret->pool = NULL;
+    ret->nodes = NULL;
+    ret->node_count = 0;
+
+    return ret;
+}
+
+// 添加节点
+static thread_pool_graph_node* _thread_pool_graph_add_node(
+    IN thread_pool_graph *graph,
+    IN task_func func,
+    IN void *args
+)
+{
+    thread_pool_graph_node *ret = NULL;
+
+    if(unlikely(!graph || !func))
+    {
+        DBG("invalid param");
+        return NULL;
+    }
+    if(unlikely(atomic_load(&graph->done.count)))
+    {
+        DBG("graph is running");
+        return NULL;
+    }
+
+    ret = (thread_pool_graph_node*)malloc(sizeof(thread_pool_graph_node));
+    if(unlikely(!ret))
+    {
+        DBG("malloc space of graph node fail");
+        return NULL;
+    }
+    ret->graph = graph;
+    ret->func = func;
+    ret->args = args;
+    ret->succ = NULL;
+    ret->succ_count = 0;
+    ret->succ_size = 0;
+    ret->deps = 0;
+    atomic_init(&ret->pending, 0);
+    ret->ready = NULL;
+
+    ret->next = graph->nodes;
+    graph->nodes = ret;
+    ++ graph->node_count;
+
+    return ret;
+}
+
+// 添加依赖，from执行完后才执行to
+static STATUS _thread_pool_graph_add_edge(
+    IN thread_pool_graph *graph,
+    IN thread_pool_graph_node *from,
+    IN thread_pool_graph_node *to
+)
+{
+    thread_pool_graph_node **succ = NULL;
+    unsigned int size = 0;
+
+    if(unlikely(!graph || !from || !to || from->graph != graph || to->graph != graph || from == to))
+    {
+        return ERR_BAD_PARAM;
+    }
+    if(unlikely(atomic_load(&graph->done.count)))
+    {
+        return ERR_THREAD_POOL_GRAPH_RUNNING;
+    }
+
+    if(from->succ_count == from->succ_size)
+    {
+        size = from->succ_size ? from->succ_size * 2 : 4;
+        succ = (thread_pool_graph_node**)malloc(sizeof(thread_pool_graph_node*) * size);
+        if(unlikely(!succ))
+        {
+            DBG("malloc space of graph edge fail");
+            return ERR_NO_MEMORY;
+        }
+        if(from->succ)
+        {
+            memcpy(succ, from->succ, sizeof(thread_pool_graph_node*) * from->succ_count);
+            free(from->succ);
+        }
+        from->succ = succ;
+        from->succ_size = size;
+    }
+
+    from->succ[from->succ_count ++] = to;
+    ++ to->deps;
+
+    return OK;
+}
+
+// 执行一个节点，以及执行过程中就绪的后继节点。第一个就绪的后继在本线程接着执行，数据还在缓存中；
+// 其余的提交到线程池，队列满时也留在本线程执行
+static void thread_pool_graph_node_run(IN void *arg)
+{
+    thread_pool_graph_node *stack = (thread_pool_graph_node*)arg;
+    thread_pool_graph_node *node = NULL;
+    thread_pool_graph_node *succ = NULL;
+    thread_pool_graph *graph = stack->graph;
+    bool inline_taken = false;
+    unsigned int i = 0;
+
+    stack->ready = NULL;
+    while(stack)
+    {
+        node = stack;
+        stack = node->ready;
+
+        node->func(node->args);
+
+        inline_taken = false;
+        for(i = 0; i < node->succ_count; ++ i)
+        {
+            succ = node->succ[i];
+            if(1 != atomic_fetch_sub(&succ->pending, 1))
+            {
+                continue;
+            }
+            if(inline_taken &&
+               OK == _thread_pool_submit(graph->pool, thread_pool_graph_node_run, succ, THREAD_POOL_PRIO_NORMAL, 0))
+            {
+                continue;
+            }
+            inline_taken = true;
+            succ->ready = stack;
+            stack = succ;
+        }
+
+        // 栈非空时还有节点没完成，计数不会归零；栈为空时这可能是最后一次递减，之后不再访问任务图
+        tp_latch_count_down(&graph->done);
+    }
+}
+
+// 运行任务图：检查是否有环，重置各节点的依赖计数，提交没有依赖的节点
+static STATUS _thread_pool_graph_run(
+    IN thread_pool_graph *graph,
+    IN thread_pool_t *pool
+)
+{
+    thread_pool_graph_node *stack = NULL;
+    thread_pool_graph_node *inline_stack = NULL;
+    thread_pool_graph_node *node = NULL;
+    unsigned int visited = 0;
+    unsigned int i = 0;
+    int timeout_ms = THREAD_POOL_WAIT_FOREVER;
+
+    if(unlikely(!graph || !pool))
+    {
+        return ERR_BAD_PARAM;
+    }
+    if(unlikely(atomic_load(&graph->done.count)))
+    {
+        return ERR_THREAD_POOL_GRAPH_RUNNING;
+    }
+    if(0 == graph->node_count)
+    {
+        return OK;
+    }
+
+    // 拓扑排序检查是否有环，ready和pending作为临时空间
+    for(node = graph->nodes; node; node = node->next)
+    {
+        atomic_store_explicit(&node->pending, node->deps, memory_order_relaxed);
+        if(0 == node->deps)
+        {
+            node->ready = stack;
+            stack = node;
+        }
+    }
+    while(stack)
+    {
+        node = stack;
+        stack = node->ready;
+        ++ visited;
+        for(i = 0; i < node->succ_count; ++ i)
+        {
+            if(1 == atomic_fetch_sub_explicit(&node->succ[i]->pending, 1, memory_order_relaxed))
+            {
+                node->succ[i]->ready = stack;
+                stack = node->succ[i];
+            }
+        }
+    }
+    if(visited != graph->node_count)
+    {
+        return ERR_THREAD_POOL_GRAPH_CYCLE;
+    }
+
+    for(node = graph->nodes; node; node = node->next)
+    {
+        atomic_store_explicit(&node->pending, node->deps, memory_order_relaxed);
+    }
+    graph->pool = pool;
+
+    // 先计数再提交，节点可能在提交返回前就执行完。在该线程池的任务中运行时不等待队列空位，
+    // 提交失败的节点在调用线程执行，保证计数最终归零
+    tp_latch_add(&graph->done, graph->node_count);
+    if(tp_self && tp_self->pool == pool)
+    {
+        timeout_ms = 0;
+    }
+    for(node = graph->nodes; node; node = node->next)
+    {
+        if(0 == node->deps &&
+           OK != _thread_pool_submit(pool, thread_pool_graph_node_run, node, THREAD_POOL_PRIO_NORMAL, timeout_ms))
+        {
+            node->ready = inline_stack;
+            inline_stack = node;
+        }
+    }
+    while(inline_stack)
+    {
+        node = inline_stack;
+        inline_stack = node->ready;
+        thread_pool_graph_node_run(node);
+    }
+
+    return OK;
+}
+
+// 等待任务图运行完成
+static STATUS _thread_pool_graph_wait(
+    IN thread_pool_graph *graph,
+    IN int timeout_ms
+)
+{
+    if(unlikely(!graph))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    return tp_latch_wait(&graph->done, timeout_ms);
+}
+
+// 销毁任务图
+static STATUS _thread_pool_graph_destroy(
+    IN thread_pool_graph *graph
+)
+{
+    thread_pool_graph_node *node = NULL;
+
+    if(unlikely(!graph))
+    {
+        return ERR_BAD_PARAM;
+    }
+
+    tp_latch_wait(&graph->done, THREAD_POOL_WAIT_FOREVER);
+    while(graph->nodes)
+    {
+        node = graph->nodes;
+        graph->nodes = node->next;
+        if(node->succ) free(node->succ);
+        free(node);
+    }
+    tp_latch_destroy(&graph->done);
+    free(graph);
+
+    return OK;
+}
+
+// 释放一个引用，最后一个引用回收共享状态
+static void tp_range_release(IN tp_range *range)
+{
+    if(1 == atomic_fetch_sub(&range->refs, 1))
+    {
+        tp_latch_destroy(&range->done);
+        free(range);
+    }
+}
+
+// 领取连续的若干块：剩余块数的1/(2*参与者数量)，至少一块。开始时块大，减少领取次数；
+// 接近结束时块小，各线程差不多同时完成
+static bool tp_range_claim(
+    IN tp_range *range,
+    OUT unsigned int *first,
+    OUT unsigned int *count
+)
+{
+    unsigned int cur = atomic_load_explicit(&range->next, memory_order_relaxed);
+    unsigned int take = 0;
+
+    do
+    {
+        if(cur >= range->blocks)
+        {
+            return false;
+        }
+        take = (range->blocks - cur) / (2 * range->participants);
+        if(0 == take)
+        {
+            take = 1;
+        }
+    }while(!atomic_compare_exchange_weak_explicit(&range->next, &cur, cur + take,
+                                                  memory_order_relaxed, memory_order_relaxed));
+
+    *first = cur;
+    *count = take;
+
+    return true;
+}
+
+// 参与者循环领取并处理块，直到全部领完
+static void tp_range_work(
+    IN tp_range *range,
+    IN unsigned int id
+)
+{
+    unsigned int first = 0;
+    unsigned int count = 0;
+    size_t b = 0;
+    size_t e = 0;
+
+    while(tp_range_claim(range, &first, &count))
+    {
+        b = range->begin + (size_t)first * range->grain;
+        e = (first + count == range->blocks) ? range->end : range->begin + (size_t)(first + count) * range->grain;
+
+        if(range->reduce)
+        {
+            range->used[id] = true;
+            range->reduce(b, e, range->partials + range->stride * id, range->ctx);
+        }
+        else
+        {
+            range->body(b, e, range->ctx);
+        }
+
+        tp_latch_count_down_n(&range->done, count);
+    }
+}
+
+// 辅助任务，开始时可能已经全部领完
+static void tp_range_helper(IN void *arg)
+{
+    tp_range *range = (tp_range*)arg;
+
+    tp_range_work(range, atomic_fetch_add(&range->next_id, 1));
+    tp_range_release(range);
+}
+
+// parallel_for和parallel_reduce的公共部分：分块，提交辅助任务，调用者参与处理并等待完成，
+// 需要时合并部分结果
+static STATUS thread_pool_range_run(
+    IN thread_pool_t *pool,
+    IN size_t begin,
+    IN size_t end,
+    IN size_t grain,
+    IN thread_pool_range_func body,
+    IN thread_pool_reduce_func reduce,
+    IN thread_pool_join_func join,
+    IN OUT void *result,
+    IN size_t result_size,
+    IN void *ctx
+)
+{
+    thread_pool_task tasks[THREAD_COUNT_MAX];
+    tp_range *range = NULL;
+    size_t n = end - begin;
+    size_t blocks = 0;
+    size_t stride = 0;
+    unsigned int participants = 0;
+    unsigned int added = 0;
+    unsigned int i = 0;
+
+    participants = pool->thread_max + 1;
+
+    // 块数不超过TP_RANGE_BLOCKS_MAX，grain不超过元素数量，下标计算不会溢出
+    if(0 == grain)
+    {
+        grain = n / ((size_t)participants * TP_RANGE_AUTO_BLOCKS);
+    }
+    if(grain < n / TP_RANGE_BLOCKS_MAX + 1)
+    {
+        grain = n / TP_RANGE_BLOCKS_MAX + 1;
+    }
+    if(grain > n)
+    {
+        grain = n;
+    }
+    blocks = n / grain + ((n % grain) ? 1 : 0);
+    if(participants > blocks)
+    {
+        participants = (unsigned int)blocks;
+    }
+
+    // 只有一块时不需要线程池
+    if(1 == participants)
+    {
+        if(reduce)
+        {
+            reduce(begin, end, result, ctx);
+        }
+        else
+        {
+            body(begin, end, ctx);
+        }
+        return OK;
+    }
+
+    // 部分结果跟在结构后面，多申请一个缓存行用于对齐，每个参与者占整数个缓存行
+    if(reduce)
+    {
+        stride = (result_size + THREAD_POOL_CACHE_LINE - 1) & ~(size_t)(THREAD_POOL_CACHE_LINE - 1);
+    }
+    range = (tp_range*)malloc(sizeof(tp_range) + THREAD_POOL_CACHE_LINE + stride * participants);
+    if(unlikely(!range))
+    {
+        DBG("malloc space of range fail");
+        return ERR_NO_MEMORY;
+    }
+    if(unlikely(OK != tp_latch_init(&range->done, (unsigned int)blocks)))
+    {
+        free(range);
+        return ERR_API_ERROR;
+    }
+    atomic_init(&range->next, 0);
+    atomic_init(&range->next_id, 1);
+    atomic_init(&range->refs, participants);
+    range->blocks = (unsigned int)blocks;
+    range->participants = participants;
+    range->begin = begin;
+    range->end = end;
+    range->grain = grain;
+    range->body = body;
+    range->reduce = reduce;
+    range->ctx = ctx;
+    range->stride = stride;
+    range->partials = (unsigned char*)(((uintptr_t)(range + 1) + THREAD_POOL_CACHE_LINE - 1) &
+                                       ~(uintptr_t)(THREAD_POOL_CACHE_LINE - 1));
+    for(i = 0; i < participants; ++ i)
+    {
+        range->used[i] = false;
+        if(reduce)
+        {
+            memcpy(range->partials + stride * i, result, result_size);
+        }
+    }
+
+    // 辅助任务一次加锁提交，队列满时不等待，少提交的部分由调用者完成
+    for(i = 0; i < participants - 1; ++ i)
+    {
+        tasks[i].func = tp_range_helper;
+        tasks[i].args = range;
+    }
+    _thread_pool_submit_tasks(pool, tasks, participants - 1, &added, THREAD_POOL_PRIO_NORMAL, 0);
+    if(added < participants - 1)
+    {
+        atomic_fetch_sub(&range->refs, participants - 1 - added);
+    }
+
+    // 调用者处理到全部领完，再等待其他线程正在处理的块
+    tp_range_work(range, 0);
+    tp_latch_wait(&range->done, THREAD_POOL_WAIT_FOREVER);
+
+    if(reduce)
+    {
+        memcpy(result, range->partials, result_size);
+        for(i = 1; i < participants; ++ i)
+        {
+            if(range->used[i])
+            {
+                join(result, range->partials + stride * i, ctx);
+            }
+        }
+    }
+
+    tp_range_release(range);
+
+    return OK;
+}
+
+// 并行执行循环
+static STATUS _thread_pool_parallel_for(
+    IN thread_pool_t *pool,
+    IN size_t begin,
+    IN size_t end,
+    IN size_t grain,
+    IN thread_pool_range_func body,
+    IN void *ctx
+)
+{
+    if(unlikely(!pool || !body || begin > end))
+    {
+        return ERR_BAD_PARAM;
+    }
+    if(begin == end)
+    {
+        return OK;
+    }
+
+    return thread_pool_range_run(pool, begin, end, grain, body, NULL, NULL, NULL, 0, ctx);
+}
+
+// 并行归约
+static STATUS _thread_pool_parallel_reduce(
+    IN thread_pool_t *pool,
+    IN size_t begin,
+    IN size_t end,
+    IN size_t grain,
+    IN OUT void *result,
+    IN size_t result_size,
+    IN thread_pool_reduce_func body,
+    IN thread_pool_join_func join,
+    IN void *ctx
+)
+{
+    if(unlikely(!pool || !result || 0 == result_size || !body || !join || begin > end))
+    {
+        return ERR_BAD_PARAM;
+    }
+    if(begin == end)
+    {
+        return OK;
+    }
+
+    return thread_pool_range_run(pool, begin, end, grain, NULL, body, join, result, result_size, ctx);
+}
+
+/*
+    Variables
+*/
+
+thread_pool_ops thread_pool_operations = {
+    .thread_pool_add_task = _thread_pool_add_task,
+    .thread_pool_submit = _thread_pool_submit,
+    .thread_pool_submit_tasks = _thread_pool_submit_tasks,
+    .thread_pool_create = _thread_pool_create,
+    .thread_pool_create_ex = _thread_pool_create_ex,
+    .thread_pool_drain = _thread_pool_drain,
+    .thread_pool_get_thread_count = _thread_pool_get_thread_count,
+    .thread_pool_get_stats = _thread_pool_get_stats,
+    .thread_pool_destroy = _thread_pool_destroy,
+    .thread_pool_submit_future = _thread_pool_submit_future,
+    .thread_pool_future_wait = _thread_pool_future_wait,
+    .thread_pool_future_done = _thread_pool_future_done,
+    .thread_pool_future_destroy = _thread_pool_future_destroy,
+    .thread_pool_group_create = _thread_pool_group_create,
+    .thread_pool_group_add = _thread_pool_group_add,
+    .thread_pool_group_wait = _thread_pool_group_wait,
+    .thread_pool_group_destroy = _thread_pool_group_destroy,
+    .thread_pool_graph_create = _thread_pool_graph_create,
+    .thread_pool_graph_add_node = _thread_pool_graph_add_node,
+    .thread_pool_graph_add_edge = _thread_pool_graph_add_edge,
+    .thread_pool_graph_run = _thread_pool_graph_run,
+    .thread_pool_graph_wait = _thread_pool_graph_wait,
+    .thread_pool_graph_destroy = _thread_pool_graph_destroy,
+    .thread_pool_parallel_for = _thread_pool_parallel_for,
+    .thread_pool_parallel_reduce = _thread_pool_parallel_reduce
+};
+
+#if THREAD_POOL_TEST
+// 示例任务函数
+void sample_task(void *arg)
+{
+    int num = *(int *)arg;
+    printf("Task %d processed by thread %lu\n", num, (unsigned long)pthread_self());
+    free(arg); // 清理动态分配的参数
+}
+
+// 工作窃取测试：每个任务在线程内继续拆分，叶子任务计数
+typedef struct
+{
+    thread_pool_t *pool;
+    atomic_uint leaves;         // 已完成的叶子任务
+    atomic_uint nodes;          // 已执行的任务
+}ws_test_ctx;
+
+typedef struct
+{
+    ws_test_ctx *ctx;
+    unsigned int depth;
+}ws_test_arg;
+
+static void ws_test_task(void *arg)
+{
+    ws_test_arg *a = (ws_test_arg*)arg;
+    ws_test_arg *child = NULL;
+    int i = 0;
+
+    atomic_fetch_add(&a->ctx->nodes, 1);
+    if(0 == a->depth)
+    {
+        atomic_fetch_add(&a->ctx->leaves, 1);
+        free(a);
+        return;
+    }
+
+    for(i = 0; i < 4; ++ i)
+    {
+        child = (ws_test_arg*)malloc(sizeof(ws_test_arg));
+        child->ctx = a->ctx;
+        child->depth = a->depth - 1;
+        assert_int_equal(OK, thread_pool_add_task(a->ctx->pool, ws_test_task, child));
+    }
+    free(a);
+}
+
+// 背压测试：任务在闸门打开前一直等待
+static atomic_bool tp_test_gate;
+static atomic_uint tp_test_started;
+static atomic_uint tp_test_done;
+
+static void tp_test_gated_task(void *arg)
+{
+    (void)arg;
+    atomic_fetch_add(&tp_test_started, 1);
+    while(!atomic_load(&tp_test_gate))
+    {
+        sched_yield();
+    }
+    atomic_fetch_add(&tp_test_done, 1);
+}
+
+// 100ms后打开闸门
+static void* tp_test_open_gate(void *arg)
+{
+    struct timespec ts = {0, 100 * 1000000};
+
+    (void)arg;
+    nanosleep(&ts, NULL);
+    atomic_store(&tp_test_gate, true);
+
+    return NULL;
+}
+
+// future测试：返回参数的平方
+static void* tp_test_square(void *arg)
+{
+    uintptr_t n = (uintptr_t)arg;
+
+    return (void*)(n * n);
+}
+
+static void* tp_test_gated_result(void *arg)
+{
+    tp_test_gated_task(NULL);
+    return arg;
+}
+
+// 任务组测试：每个任务在线程内再提交一个future并等待，工作窃取模式下子任务放入本地队列
+static atomic_uint tp_test_count;
+
+static void tp_test_count_task(void *arg)
+{
+    (void)arg;
+    atomic_fetch_add(&tp_test_count, 1);
+}
+
+// 在线程内批量提交64个计数任务
+static void tp_test_fanout_task(void *arg)
+{
+    thread_pool_task tasks[64];
+    unsigned int added = 0;
+    int i = 0;
+
+    for(i = 0; i < 64; ++ i)
+    {
+        tasks[i].func = tp_test_count_task;
+        tasks[i].args = NULL;
+    }
+    assert_int_equal(OK, thread_pool_add_tasks((thread_pool_t*)arg, tasks, 64, &added));
+    assert_int_equal(64, added);
+}
+
+static void tp_test_nested_task(void *arg)
+{
+    thread_pool_future *future = NULL;
+    void *result = NULL;
+
+    assert_int_equal(OK, thread_pool_submit_future((thread_pool_t*)arg, tp_test_square, (void*)(uintptr_t)3, &future));
+    // 只检查不等待，避免工作线程互相等待
+    if(OK == thread_pool_future_wait_timed(future, 0, &result))
+    {
+        assert_ptr_equal((void*)(uintptr_t)9, result);
+    }
+    thread_pool_future_destroy(future);
+    atomic_fetch_add(&tp_test_count, 1);
+}
+
+static void* tp_test_count_result(void *arg)
+{
+    atomic_fetch_add(&tp_test_count, 1);
+    return arg;
+}
+
+// 在线程内往同一个线程池提交16个future和16个组任务，队列放不下的在本线程执行；不等待future，避免唯一的工作线程等待自己
+static void tp_test_self_submit_task(void *arg)
+{
+    thread_pool_group *group = (thread_pool_group*)arg;
+    thread_pool_future *future = NULL;
+    int i = 0;
+
+    for(i = 0; i < 16; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_submit_future(group->pool, tp_test_count_result, NULL, &future));
+        thread_pool_future_destroy(future);
+        assert_int_equal(OK, thread_pool_group_add(group, tp_test_count_task, NULL));
+    }
+}
+
+static long tp_test_elapsed_ms(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+// 优先级测试：按执行顺序记录任务的优先级
+static char tp_test_order[64];
+static atomic_uint tp_test_order_len;
+
+static void tp_test_record_task(void *arg)
+{
+    tp_test_order[atomic_fetch_add(&tp_test_order_len, 1)] = *(const char*)arg;
+}
+
+// 在线程内提交高优先级任务，工作窃取模式下放入共享队列，队列满时等待其他线程取走
+static void tp_test_high_fanout_task(void *arg)
+{
+    int i = 0;
+
+    for(i = 0; i < 16; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_submit_prio((thread_pool_t*)arg, tp_test_count_task, NULL,
+                                                     THREAD_POOL_PRIO_HIGH, THREAD_POOL_WAIT_FOREVER));
+    }
+}
+
+// 线程属性测试：在任务中读取当前线程的CPU绑定、线程名和栈大小
+typedef struct
+{
+    cpu_set_t cpus;
+    char name[16];
+    size_t stack_size;
+}tp_test_probe_t;
+
+static void* tp_test_probe(void *arg)
+{
+    tp_test_probe_t *probe = (tp_test_probe_t*)arg;
+    pthread_attr_t tattr;
+
+    assert_int_equal(0, pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &probe->cpus));
+    assert_int_equal(0, pthread_getname_np(pthread_self(), probe->name, sizeof(probe->name)));
+    assert_int_equal(0, pthread_getattr_np(pthread_self(), &tattr));
+    assert_int_equal(0, pthread_attr_getstacksize(&tattr, &probe->stack_size));
+    pthread_attr_destroy(&tattr);
+
+    return probe;
+}
+
+// 等待弹性线程池的线程数量降到expect，最多等待2秒
+static unsigned int tp_test_wait_shrink(thread_pool_t *pool, unsigned int expect)
+{
+    struct timespec start;
+    struct timespec ts = {0, 10 * 1000000};
+    unsigned int count = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do
+    {
+        nanosleep(&ts, NULL);
+        assert_int_equal(OK, thread_pool_get_thread_count(pool, &count));
+    }while(count > expect && tp_test_elapsed_ms(&start) < 2000);
+
+    return count;
+}
+
+static unsigned char tp_test_marks[10000];
+
+static void tp_test_mark_range(size_t begin, size_t end, void *ctx)
+{
+    (void)ctx;
+    for(; begin < end; ++ begin)
+    {
+        ++ tp_test_marks[begin];
+    }
+}
+
+static void tp_test_sum_range(size_t begin, size_t end, void *partial, void *ctx)
+{
+    (void)ctx;
+    for(; begin < end; ++ begin)
+    {
+        *(unsigned long long*)partial += begin;
+    }
+}
+
+static void tp_test_sum_join(void *dst, const void *src, void *ctx)
+{
+    (void)ctx;
+    *(unsigned long long*)dst += *(const unsigned long long*)src;
+}
+
+// 在任务中对同一线程池调用parallel_reduce
+static void* tp_test_nested_reduce(void *arg)
+{
+    unsigned long long sum = 0;
+
+    assert_int_equal(OK, thread_pool_parallel_reduce((thread_pool_t*)arg, 0, 1000, 10, &sum, sizeof(sum),
+                                                     tp_test_sum_range, tp_test_sum_join, NULL));
+
+    return (void*)(uintptr_t)sum;
+}
+
+void thread_pool_test()
+{
+#if CMOCKA_TEST
+    int i = 0;
+    thread_pool_attr attr;
+    ws_test_ctx ctx;
+    ws_test_arg *root = NULL;
+    struct timespec start;
+    pthread_t opener;
+    thread_pool_future *futures[16] = {NULL};
+    thread_pool_task tasks[1000];
+    unsigned int added = 0;
+    thread_pool_cpuset cpusets[2];
+    tp_test_probe_t probe;
+    thread_pool_stats stats;
+    thread_pool_t *prio_pool = NULL;
+    cpu_set_t allowed;
+    unsigned int cpu = 0;
+    thread_pool_group *group = NULL;
+    thread_pool_graph *graph = NULL;
+    thread_pool_graph_node *nodes[8] = {NULL};
+    unsigned long long sum = 0;
+    void *result = NULL;
+
+    // 创建4线程+10容量的线程池
+    thread_pool_t *pool = thread_pool_create(4, 10);
+    if (!pool)
+    {
+        fprintf(stderr, "Create threadpool failed\n");
+        return;
+    }
+
+    // 添加20个任务
+    for (; i < 20; i++)
+    {
+        int *arg = malloc(sizeof(int));
+        *arg = i;
+        assert_int_equal(OK, thread_pool_submit_blocking(pool, sample_task, arg));   // 队列满时休眠等待
+    }
+
+    assert_return_code(OK, thread_pool_drain(pool)); // 等待任务完成
+    thread_pool_destroy(pool); // 关闭
+
+    // 工作窃取：根任务从外部提交，之后的任务都在线程内提交，4叉树深度6共4096个叶子
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 4;
+    attr.queue_size = 4;
+    attr.mode = THREAD_POOL_WORK_STEALING;
+    assert_null(thread_pool_create_ex(NULL));
+    attr.queue_size = 0;
+    assert_null(thread_pool_create_ex(&attr));
+    attr.queue_size = 4;
+
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+
+    ctx.pool = pool;
+    atomic_init(&ctx.leaves, 0);
+    atomic_init(&ctx.nodes, 0);
+    for(i = 0; i < 2; ++ i)
+    {
+        root = (ws_test_arg*)malloc(sizeof(ws_test_arg));
+        root->ctx = &ctx;
+        root->depth = 6;
+        assert_int_equal(OK, thread_pool_add_task(pool, ws_test_task, root));
+    }
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(2 * 4096, atomic_load(&ctx.leaves));
+    assert_int_equal(2 * (1 + 4 + 16 + 64 + 256 + 1024 + 4096), atomic_load(&ctx.nodes));
+
+    // 任务组：外部提交的任务在线程内再提交future，等待组完成后再drain等待线程内提交的任务
+    group = thread_pool_group_create(pool);
+    assert_non_null(group);
+    atomic_init(&tp_test_count, 0);
+    for(i = 0; i < 100; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_group_add(group, tp_test_nested_task, pool));
+    }
+    assert_int_equal(OK, thread_pool_group_wait(group));
+    assert_int_equal(100, atomic_load(&tp_test_count));
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_return_code(OK, thread_pool_group_destroy(group));
+
+    // 批量提交：外部批量提交到共享队列，任务内批量提交到本地队列
+    atomic_store(&tp_test_count, 0);
+    for(i = 0; i < 10; ++ i)
+    {
+        tasks[i].func = tp_test_fanout_task;
+        tasks[i].args = pool;
+    }
+    assert_int_equal(OK, thread_pool_submit_tasks_blocking(pool, tasks, 10));
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(640, atomic_load(&tp_test_count));
+
+    atomic_store(&tp_test_count, 0);
+    for(i = 0; i < 2; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_add_task(pool, tp_test_high_fanout_task, pool));
+    }
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(32, atomic_load(&tp_test_count));
+
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 固定容量：1个线程卡在闸门上，队列放满后提交失败或超时，打开闸门后阻塞提交成功
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 1;
+    attr.queue_size = 2;
+    attr.queue_max = 1;
+    assert_null(thread_pool_create_ex(&attr));
+    attr.queue_max = 0;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+
+    atomic_init(&tp_test_gate, false);
+    atomic_init(&tp_test_started, 0);
+    atomic_init(&tp_test_done, 0);
+    assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    while(0 == atomic_load(&tp_test_started))
+    {
+        sched_yield();
+    }
+    assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    tasks[0].func = tp_test_gated_task;
+    tasks[0].args = NULL;
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_add_tasks(pool, tasks, 1, &added));
+    assert_int_equal(0, added);
+    // 每个优先级的队列容量分别计算
+    assert_int_equal(OK, thread_pool_add_task_prio(pool, tp_test_gated_task, NULL, THREAD_POOL_PRIO_HIGH));
+    assert_int_equal(OK, thread_pool_add_task_prio(pool, tp_test_gated_task, NULL, THREAD_POOL_PRIO_HIGH));
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_add_task_prio(pool, tp_test_gated_task, NULL, THREAD_POOL_PRIO_HIGH));
+    assert_int_equal(ERR_BAD_PARAM, thread_pool_add_task_prio(pool, tp_test_gated_task, NULL, THREAD_POOL_PRIO_COUNT));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_submit_timed(pool, tp_test_gated_task, NULL, 50));
+    assert_true(tp_test_elapsed_ms(&start) >= 45);
+
+    assert_int_equal(0, pthread_create(&opener, NULL, tp_test_open_gate, NULL));
+    assert_int_equal(OK, thread_pool_submit_blocking(pool, tp_test_gated_task, NULL));
+    assert_true(atomic_load(&tp_test_gate));
+    pthread_join(opener, NULL);
+    while(atomic_load(&tp_test_done) < 6)
+    {
+        sched_yield();
+    }
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // future：1个线程的线程池，闸门关闭时超时，打开后取得返回值；没有等待就释放的future由任务回收
+    pool = thread_pool_create(1, 4);
+    assert_non_null(pool);
+    atomic_store(&tp_test_gate, false);
+    assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_gated_result, (void*)(uintptr_t)7, &futures[0]));
+    assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_square, (void*)(uintptr_t)5, &futures[1]));
+    assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_square, (void*)(uintptr_t)6, &futures[2]));
+    assert_int_equal(ERR_THREAD_POOL_TIMEOUT, thread_pool_future_wait_timed(futures[0], 0, &result));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert_int_equal(ERR_THREAD_POOL_TIMEOUT, thread_pool_future_wait_timed(futures[1], 30, &result));
+    assert_true(tp_test_elapsed_ms(&start) >= 25);
+    assert_false(thread_pool_future_done(futures[1]));
+    assert_return_code(OK, thread_pool_future_destroy(futures[2]));
+    atomic_store(&tp_test_gate, true);
+    assert_int_equal(OK, thread_pool_future_wait(futures[1], &result));
+    assert_ptr_equal((void*)(uintptr_t)25, result);
+    assert_true(thread_pool_future_done(futures[0]));
+    assert_int_equal(OK, thread_pool_future_wait_timed(futures[0], 0, &result));
+    assert_ptr_equal((void*)(uintptr_t)7, result);
+    assert_return_code(OK, thread_pool_future_destroy(futures[0]));
+    assert_return_code(OK, thread_pool_future_destroy(futures[1]));
+
+    for(i = 0; i < 16; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_square, (void*)(uintptr_t)i, &futures[i]));
+    }
+    for(i = 0; i < 16; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_future_wait(futures[i], &result));
+        assert_ptr_equal((void*)(uintptr_t)(i * i), result);
+        thread_pool_future_destroy(futures[i]);
+    }
+
+    // 在线程池自己的任务中提交future和组任务：队列满时在调用线程执行，不会一直等待空位
+    atomic_store(&tp_test_count, 0);
+    group = thread_pool_group_create(pool);
+    assert_non_null(group);
+    assert_int_equal(OK, thread_pool_add_task(pool, tp_test_self_submit_task, group));
+    assert_int_equal(OK, thread_pool_drain(pool));
+    assert_int_equal(OK, thread_pool_group_wait(group));
+    assert_int_equal(32, atomic_load(&tp_test_count));
+    assert_return_code(OK, thread_pool_group_destroy(group));
+
+    // 批量提交：队列只剩部分空位时放入能放下的部分，阻塞提交放入全部；数组中有空函数时整批拒绝
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_started, 0);
+    atomic_store(&tp_test_count, 0);
+    assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    while(0 == atomic_load(&tp_test_started))
+    {
+        sched_yield();
+    }
+    for(i = 0; i < 1000; ++ i)
+    {
+        tasks[i].func = tp_test_count_task;
+        tasks[i].args = NULL;
+    }
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_add_tasks(pool, tasks, 10, &added));
+    assert_int_equal(4, added);
+    tasks[5].func = NULL;
+    assert_int_equal(ERR_BAD_PARAM, thread_pool_add_tasks(pool, tasks, 10, &added));
+    assert_int_equal(0, added);
+    tasks[5].func = tp_test_count_task;
+    atomic_store(&tp_test_gate, true);
+    assert_int_equal(OK, thread_pool_submit_tasks_blocking(pool, tasks, 1000));
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(1004, atomic_load(&tp_test_count));
+
+    // 优先级：1个线程卡在闸门上时三个优先级各放入8个任务，按4:2:1的权重轮流取出，
+    // 高优先级先执行，低优先级每轮至少执行一个；闸门任务本身用掉普通优先级的一个额度
+    prio_pool = thread_pool_create(1, 8);
+    assert_non_null(prio_pool);
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_started, 0);
+    atomic_init(&tp_test_order_len, 0);
+    assert_int_equal(OK, thread_pool_add_task(prio_pool, tp_test_gated_task, NULL));
+    while(0 == atomic_load(&tp_test_started))
+    {
+        sched_yield();
+    }
+    for(i = 0; i < 8; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_submit_prio(prio_pool, tp_test_record_task, "L", THREAD_POOL_PRIO_LOW, THREAD_POOL_WAIT_FOREVER));
+        assert_int_equal(OK, thread_pool_submit_prio(prio_pool, tp_test_record_task, "N", THREAD_POOL_PRIO_NORMAL, THREAD_POOL_WAIT_FOREVER));
+        assert_int_equal(OK, thread_pool_submit_prio(prio_pool, tp_test_record_task, "H", THREAD_POOL_PRIO_HIGH, THREAD_POOL_WAIT_FOREVER));
+    }
+    assert_int_equal(OK, thread_pool_get_stats(prio_pool, &stats));
+    assert_int_equal(8, stats.depth[THREAD_POOL_PRIO_HIGH]);
+    assert_int_equal(8, stats.depth[THREAD_POOL_PRIO_NORMAL]);
+    assert_int_equal(8, stats.depth[THREAD_POOL_PRIO_LOW]);
+    atomic_store(&tp_test_gate, true);
+    assert_return_code(OK, thread_pool_drain(prio_pool));
+    assert_int_equal(24, atomic_load(&tp_test_order_len));
+    assert_int_equal(0, memcmp("HHHHNL" "HHHHNNL" "NNL" "NNL" "NL" "L" "L" "L", tp_test_order, 24));
+    assert_int_equal(OK, thread_pool_get_stats(prio_pool, &stats));
+    for(i = 0; i < THREAD_POOL_PRIO_COUNT; ++ i)
+    {
+        assert_int_equal(0, stats.depth[i]);
+        assert_int_equal(8, stats.peak_depth[i]);
+    }
+    assert_int_equal(8, stats.enqueued[THREAD_POOL_PRIO_HIGH]);
+    assert_int_equal(8, stats.enqueued[THREAD_POOL_PRIO_LOW]);
+    assert_int_equal(ERR_BAD_PARAM, thread_pool_get_stats(prio_pool, NULL));
+    assert_return_code(OK, thread_pool_destroy(prio_pool));
+
+    // 任务组超时，销毁线程池时先执行完队列中的任务
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_count, 0);
+    group = thread_pool_group_create(pool);
+    assert_non_null(group);
+    assert_int_equal(OK, thread_pool_group_add(group, tp_test_gated_task, NULL));
+    assert_int_equal(ERR_THREAD_POOL_TIMEOUT, thread_pool_group_wait_timed(group, 10));
+    atomic_store(&tp_test_gate, true);
+    assert_int_equal(OK, thread_pool_group_wait(group));
+    assert_return_code(OK, thread_pool_group_destroy(group));
+    for(i = 0; i < 50; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_submit_blocking(pool, tp_test_count_task, NULL));
+    }
+    assert_return_code(OK, thread_pool_destroy(pool));
+    assert_int_equal(50, atomic_load(&tp_test_count));
+
+    // 弹性线程池：最少1个最多4个线程，积压时增加，空闲50ms后退出到最少数量
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 3;
+    attr.thread_max = 2;
+    attr.queue_size = 8;
+    assert_null(thread_pool_create_ex(&attr));
+    attr.thread_count = 1;
+    attr.thread_max = 4;
+    attr.idle_timeout_ms = 50;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    assert_int_equal(OK, thread_pool_get_thread_count(pool, &added));
+    assert_int_equal(1, added);
+
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_started, 0);
+    atomic_store(&tp_test_done, 0);
+    for(i = 0; i < 6; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    }
+    while(atomic_load(&tp_test_started) < 4)
+    {
+        sched_yield();
+    }
+    assert_int_equal(OK, thread_pool_get_thread_count(pool, &added));
+    assert_int_equal(4, added);
+    atomic_store(&tp_test_gate, true);
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(6, atomic_load(&tp_test_done));
+    assert_int_equal(1, tp_test_wait_shrink(pool, 1));
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 弹性工作窃取：最少0个线程，任务内拆分的任务积压时增加线程，全部退出后再次提交时复用槽
+    attr.thread_count = 0;
+    attr.thread_max = 3;
+    attr.mode = THREAD_POOL_WORK_STEALING;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    assert_return_code(OK, thread_pool_drain(pool));
+    for(i = 0; i < 2; ++ i)
+    {
+        atomic_store(&tp_test_count, 0);
+        tasks[0].func = tp_test_fanout_task;
+        tasks[0].args = pool;
+        tasks[1] = tasks[0];
+        assert_int_equal(OK, thread_pool_add_tasks(pool, tasks, 2, NULL));
+        assert_return_code(OK, thread_pool_drain(pool));
+        assert_int_equal(128, atomic_load(&tp_test_count));
+        assert_int_equal(0, tp_test_wait_shrink(pool, 0));
+    }
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 线程属性：轮流绑定到进程可用的CPU，栈大小和线程名前缀（超长时截断）
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 2;
+    attr.queue_size = 4;
+    attr.pin = THREAD_POOL_PIN_ROUND_ROBIN;
+    attr.stack_size = 256 * 1024;
+    attr.name = "tp-test-long-prefix";
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_probe, &probe, &futures[0]));
+    assert_int_equal(OK, thread_pool_future_wait(futures[0], &result));
+    assert_ptr_equal(&probe, result);
+    thread_pool_future_destroy(futures[0]);
+    assert_int_equal(1, CPU_COUNT(&probe.cpus));
+    assert_true(probe.stack_size >= 256 * 1024);
+    assert_int_equal(0, strncmp(probe.name, "tp-test-long-", 13));
+    assert_true(strlen(probe.name) <= 15);
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 按CPU集合绑定：绑定到当前进程可用的第一个CPU；集合为空或栈太小时创建失败
+    CPU_ZERO(&allowed);
+    assert_int_equal(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+    while(!CPU_ISSET(cpu, &allowed))
+    {
+        ++ cpu;
+    }
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 2;
+    attr.queue_size = 4;
+    attr.pin = THREAD_POOL_PIN_CPUSET;
+    assert_null(thread_pool_create_ex(&attr));
+    thread_pool_cpuset_zero(&cpusets[0]);
+    thread_pool_cpuset_zero(&cpusets[1]);
+    attr.cpusets = cpusets;
+    attr.cpuset_count = 2;
+    assert_null(thread_pool_create_ex(&attr));
+    thread_pool_cpuset_add(&cpusets[0], cpu);
+    thread_pool_cpuset_add(&cpusets[1], cpu);
+    attr.stack_size = 1;
+    assert_null(thread_pool_create_ex(&attr));
+    attr.stack_size = 0;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_probe, &probe, &futures[0]));
+    assert_int_equal(OK, thread_pool_future_wait(futures[0], NULL));
+    thread_pool_future_destroy(futures[0]);
+    assert_int_equal(1, CPU_COUNT(&probe.cpus));
+    assert_true(CPU_ISSET(cpu, &probe.cpus));
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 可扩容队列：初始容量2，闸门关闭时提交1000个任务都成功
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 1;
+    attr.queue_size = 2;
+    attr.queue_max = THREAD_QUEUE_UNBOUNDED;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_done, 0);
+    for(i = 0; i < 1000; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    }
+    atomic_store(&tp_test_gate, true);
+    while(atomic_load(&tp_test_done) < 1000)
+    {
+        sched_yield();
+    }
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 无锁队列：容量3向上取整为4，1个线程卡在闸门上，放满后提交失败或超时，打开闸门后阻塞提交成功；
+    // 高优先级任务仍放入加锁的共享队列
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 1;
+    attr.queue_size = 3;
+    attr.mode = THREAD_POOL_LOCK_FREE;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_started, 0);
+    atomic_store(&tp_test_done, 0);
+    assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    while(0 == atomic_load(&tp_test_started))
+    {
+        sched_yield();
+    }
+    for(i = 0; i < 4; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    }
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    tasks[0].func = tp_test_gated_task;
+    tasks[0].args = NULL;
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_add_tasks(pool, tasks, 1, &added));
+    assert_int_equal(0, added);
+    assert_int_equal(OK, thread_pool_add_task_prio(pool, tp_test_gated_task, NULL, THREAD_POOL_PRIO_HIGH));
+    assert_int_equal(OK, thread_pool_get_stats(pool, &stats));
+    assert_int_equal(4, stats.depth[THREAD_POOL_PRIO_NORMAL]);
+    assert_int_equal(5, stats.enqueued[THREAD_POOL_PRIO_NORMAL]);
+    assert_int_equal(1, stats.depth[THREAD_POOL_PRIO_HIGH]);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert_int_equal(ERR_THREAD_POOL_TASK_QUEUE_FULL, thread_pool_submit_timed(pool, tp_test_gated_task, NULL, 50));
+    assert_true(tp_test_elapsed_ms(&start) >= 45);
+
+    assert_int_equal(0, pthread_create(&opener, NULL, tp_test_open_gate, NULL));
+    assert_int_equal(OK, thread_pool_submit_blocking(pool, tp_test_gated_task, NULL));
+    assert_true(atomic_load(&tp_test_gate));
+    pthread_join(opener, NULL);
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(7, atomic_load(&tp_test_done));
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 无锁队列多线程：每批100个任务大于队列容量，提交时等待空位；任务组和future同样可用
+    attr.thread_count = 4;
+    attr.queue_size = 64;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    atomic_store(&tp_test_count, 0);
+    for(i = 0; i < 100; ++ i)
+    {
+        tasks[i].func = tp_test_count_task;
+        tasks[i].args = NULL;
+    }
+    for(i = 0; i < 100; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_submit_tasks_blocking(pool, tasks, 100));
+    }
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(10000, atomic_load(&tp_test_count));
+
+    group = thread_pool_group_create(pool);
+    assert_non_null(group);
+    for(i = 0; i < 100; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_group_add(group, tp_test_count_task, NULL));
+    }
+    assert_int_equal(OK, thread_pool_group_wait(group));
+    assert_int_equal(10100, atomic_load(&tp_test_count));
+    assert_int_equal(OK, thread_pool_group_destroy(group));
+    assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_square, (void*)(uintptr_t)9, &futures[0]));
+    assert_int_equal(OK, thread_pool_future_wait(futures[0], &result));
+    assert_int_equal(81, (uintptr_t)result);
+    thread_pool_future_destroy(futures[0]);
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 弹性无锁队列：最少0个线程，任务积压时增加到3个，空闲超时后全部退出，再次提交时重新创建
+    attr.thread_count = 0;
+    attr.thread_max = 3;
+    attr.idle_timeout_ms = 50;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_started, 0);
+    atomic_store(&tp_test_done, 0);
+    for(i = 0; i < 5; ++ i)
+    {
+        assert_int_equal(OK, thread_pool_add_task(pool, tp_test_gated_task, NULL));
+    }
+    while(atomic_load(&tp_test_started) < 3)
+    {
+        sched_yield();
+    }
+    assert_int_equal(OK, thread_pool_get_thread_count(pool, &added));
+    assert_int_equal(3, added);
+    atomic_store(&tp_test_gate, true);
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(5, atomic_load(&tp_test_done));
+    assert_int_equal(0, tp_test_wait_shrink(pool, 0));
+    atomic_store(&tp_test_count, 0);
+    assert_int_equal(OK, thread_pool_add_task(pool, tp_test_count_task, NULL));
+    assert_return_code(OK, thread_pool_drain(pool));
+    assert_int_equal(1, atomic_load(&tp_test_count));
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 任务图：A在B、C之前，B、C在D之前，D在E之前；可以重复运行
+    pool = thread_pool_create(2, 4);
+    assert_non_null(pool);
+    graph = thread_pool_graph_create();
+    assert_non_null(graph);
+    assert_int_equal(OK, thread_pool_graph_run_wait(graph, pool));
+    for(i = 0; i < 5; ++ i)
+    {
+        nodes[i] = thread_pool_graph_add_node(graph, tp_test_record_task, (void*)&"ABCDE"[i]);
+        assert_non_null(nodes[i]);
+    }
+    assert_null(thread_pool_graph_add_node(graph, NULL, NULL));
+    assert_int_equal(ERR_BAD_PARAM, thread_pool_graph_add_edge(graph, nodes[0], nodes[0]));
+    assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[0], nodes[1]));
+    assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[0], nodes[2]));
+    assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[1], nodes[3]));
+    assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[2], nodes[3]));
+    assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[3], nodes[4]));
+    for(i = 0; i < 2; ++ i)
+    {
+        atomic_store(&tp_test_order_len, 0);
+        assert_int_equal(OK, thread_pool_graph_run_wait(graph, pool));
+        assert_int_equal(5, atomic_load(&tp_test_order_len));
+        assert_int_equal('A', tp_test_order[0]);
+        assert_true(('B' == tp_test_order[1] && 'C' == tp_test_order[2]) ||
+                    ('C' == tp_test_order[1] && 'B' == tp_test_order[2]));
+        assert_int_equal(0, memcmp("DE", tp_test_order + 3, 2));
+    }
+
+    // 有环时不运行；正在运行时不能修改或再次运行
+    assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[4], nodes[0]));
+    assert_int_equal(ERR_THREAD_POOL_GRAPH_CYCLE, thread_pool_graph_run(graph, pool));
+    assert_int_equal(OK, thread_pool_graph_wait_timed(graph, 0));
+    assert_int_equal(OK, thread_pool_graph_destroy(graph));
+
+    graph = thread_pool_graph_create();
+    assert_non_null(graph);
+    atomic_store(&tp_test_gate, false);
+    atomic_store(&tp_test_done, 0);
+    nodes[0] = thread_pool_graph_add_node(graph, tp_test_gated_task, NULL);
+    nodes[1] = thread_pool_graph_add_node(graph, tp_test_gated_task, NULL);
+    assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[0], nodes[1]));
+    assert_int_equal(OK, thread_pool_graph_run(graph, pool));
+    assert_int_equal(ERR_THREAD_POOL_GRAPH_RUNNING, thread_pool_graph_run(graph, pool));
+    assert_null(thread_pool_graph_add_node(graph, tp_test_gated_task, NULL));
+    assert_int_equal(ERR_THREAD_POOL_GRAPH_RUNNING, thread_pool_graph_add_edge(graph, nodes[1], nodes[0]));
+    assert_int_equal(ERR_THREAD_POOL_TIMEOUT, thread_pool_graph_wait_timed(graph, 0));
+    atomic_store(&tp_test_gate, true);
+    assert_int_equal(OK, thread_pool_graph_wait(graph));
+    assert_int_equal(2, atomic_load(&tp_test_done));
+    assert_int_equal(OK, thread_pool_graph_destroy(graph));
+
+    // 宽任务图：1个起点、200个中间节点、1个终点。队列容量4，放不下的就绪节点在本线程执行
+    graph = thread_pool_graph_create();
+    assert_non_null(graph);
+    nodes[0] = thread_pool_graph_add_node(graph, tp_test_count_task, NULL);
+    nodes[1] = thread_pool_graph_add_node(graph, tp_test_count_task, NULL);
+    for(i = 0; i < 200; ++ i)
+    {
+        nodes[2] = thread_pool_graph_add_node(graph, tp_test_count_task, NULL);
+        assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[0], nodes[2]));
+        assert_int_equal(OK, thread_pool_graph_add_edge(graph, nodes[2], nodes[1]));
+    }
+    atomic_store(&tp_test_count, 0);
+    assert_int_equal(OK, thread_pool_graph_run_wait(graph, pool));
+    assert_int_equal(202, atomic_load(&tp_test_count));
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // 同一个任务图在工作窃取和无锁队列模式下运行
+    memset(&attr, 0, sizeof(attr));
+    attr.thread_count = 4;
+    attr.queue_size = 16;
+    attr.mode = THREAD_POOL_WORK_STEALING;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    assert_int_equal(OK, thread_pool_graph_run_wait(graph, pool));
+    assert_int_equal(404, atomic_load(&tp_test_count));
+    assert_return_code(OK, thread_pool_destroy(pool));
+    attr.mode = THREAD_POOL_LOCK_FREE;
+    pool = thread_pool_create_ex(&attr);
+    assert_non_null(pool);
+    assert_int_equal(OK, thread_pool_graph_run_wait(graph, pool));
+    assert_int_equal(606, atomic_load(&tp_test_count));
+    assert_int_equal(OK, thread_pool_graph_destroy(graph));
+    assert_return_code(OK, thread_pool_destroy(pool));
+
+    // parallel_for：每个下标恰好处理一次，自动和指定grain，三种调度模式
+    for(i = 0; i < 3; ++ i)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.thread_count = 3;
+        attr.queue_size = 4;
+        attr.mode = (THREAD_POOL_MODE)i;
+        pool = thread_pool_create_ex(&attr);
+        assert_non_null(pool);
+
+        memset(tp_test_marks, 0, sizeof(tp_test_marks));
+        assert_int_equal(OK, thread_pool_parallel_for(pool, 0, 10000, 0, tp_test_mark_range, NULL));
+        assert_int_equal(OK, thread_pool_parallel_for(pool, 100, 10000, 7, tp_test_mark_range, NULL));
+        assert_int_equal(OK, thread_pool_parallel_for(pool, 0, 100, 1000, tp_test_mark_range, NULL));
+        assert_int_equal(OK, thread_pool_parallel_for(pool, 5, 5, 1, tp_test_mark_range, NULL));
+        for(added = 0; added < 10000; ++ added)
+        {
+            assert_int_equal(2, tp_test_marks[added]);
+        }
+
+        // parallel_reduce：result输入单位元，输出总和
+        sum = 0;
+        assert_int_equal(OK, thread_pool_parallel_reduce(pool, 0, 100000, 0, &sum, sizeof(sum),
+                                                         tp_test_sum_range, tp_test_sum_join, NULL));
+        assert_true(99999ull * 100000 / 2 == sum);
+        sum = 10;
+        assert_int_equal(OK, thread_pool_parallel_reduce(pool, 1, 2, 0, &sum, sizeof(sum),
+                                                         tp_test_sum_range, tp_test_sum_join, NULL));
+        assert_true(11 == sum);
+
+        // 在任务中调用，调用线程处理完剩余的块，不会等待排在自己后面的辅助任务
+        assert_int_equal(OK, thread_pool_submit_future(pool, tp_test_nested_reduce, pool, &futures[0]));
+        assert_int_equal(OK, thread_pool_future_wait(futures[0], &result));
+        assert_int_equal(999 * 1000 / 2, (uintptr_t)result);
+        thread_pool_future_destroy(futures[0]);
+        assert_return_code(OK, thread_pool_destroy(pool));
+    }
+    assert_int_equal(ERR_BAD_PARAM, thread_pool_parallel_for(NULL, 0, 1, 1, tp_test_mark_range, NULL));
+#endif
+}
+
+#endif
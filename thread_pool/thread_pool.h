@@ -13,7 +13,13 @@
 */
 
 #define THREAD_COUNT_MAX    (50)
-#define THREAD_QUEUE_SIZE_MAX   (50)
+#define THREAD_QUEUE_SIZE_MAX   (1u << 20)      // 共享任务队列初始容量的上限
+#define THREAD_QUEUE_UNBOUNDED  (0xFFFFFFFFu)   // queue_max取该值时共享任务队列不设上限
+#define THREAD_POOL_WAIT_FOREVER    (-1)        // 提交任务时一直等待
+#define THREAD_POOL_IDLE_TIMEOUT    (1000)      // 弹性线程池中多于最少数量的线程空闲多久后退出，单位毫秒
+#define THREAD_POOL_CPU_MAX     (1024)          // CPU集合能表示的CPU数量
+#define THREAD_POOL_NAME_MAX    (12)            // 线程名前缀的最大长度，线程名为"前缀-下标"，不超过系统限制的15个字符
+#define THREAD_POOL_PRIO_WEIGHT {4, 2, 1}       // 各优先级每轮最多取出的任务数量的默认值
 
 /*
     typedef
@@ -22,15 +28,145 @@
 typedef struct thread_pool_t thread_pool_t;
 
 typedef void (*task_func)(void*);
+// 有返回值的任务函数，返回值通过future取得
+typedef void* (*task_result_func)(void*);
+
+// future，隐藏成员，等待单个任务完成并取得返回值
+typedef struct thread_pool_future thread_pool_future;
+// 任务组，隐藏成员，等待一组任务全部完成
+typedef struct thread_pool_group thread_pool_group;
+// 任务图，隐藏成员，按依赖关系执行一组任务
+typedef struct thread_pool_graph thread_pool_graph;
+// 任务图的节点，隐藏成员，随任务图一起释放
+typedef struct thread_pool_graph_node thread_pool_graph_node;
+// parallel_for的循环体，处理下标[begin, end)
+typedef void (*thread_pool_range_func)(size_t begin, size_t end, void *ctx);
+// parallel_reduce的循环体，把下标[begin, end)的结果累加到partial
+typedef void (*thread_pool_reduce_func)(size_t begin, size_t end, void *partial, void *ctx);
+// parallel_reduce的合并函数，把部分结果src合并到dst
+typedef void (*thread_pool_join_func)(void *dst, const void *src, void *ctx);
+
+// 批量提交的任务
+typedef struct
+{
+    task_func func;             // 任务函数
+    void *args;                 // 输入参数
+}thread_pool_task;
+
+// 调度模式
+typedef enum
+{
+    THREAD_POOL_SHARED_QUEUE,   // 所有线程共用一个任务队列，互斥锁+条件变量（默认）
+    THREAD_POOL_WORK_STEALING,  // 每个线程一个双端队列，任务中提交的任务放入本线程队列，空闲线程窃取其他线程的任务
+    THREAD_POOL_LOCK_FREE,      // 普通优先级任务放入有界无锁环形队列，提交和取任务不加锁，队列空时线程在futex上休眠
+}THREAD_POOL_MODE;
+
+// 任务优先级，每个优先级一个共享队列
+typedef enum
+{
+    THREAD_POOL_PRIO_HIGH,      // 延迟敏感的任务
+    THREAD_POOL_PRIO_NORMAL,    // 默认
+    THREAD_POOL_PRIO_LOW,       // 后台批量任务
+    THREAD_POOL_PRIO_COUNT,
+}THREAD_POOL_PRIO;
+
+// 各优先级队列的统计
+typedef struct
+{
+    unsigned int depth[THREAD_POOL_PRIO_COUNT];         // 当前排队的任务数量
+    unsigned int peak_depth[THREAD_POOL_PRIO_COUNT];    // 排队任务数量的最大值，无锁模式下普通优先级不统计
+    unsigned long long enqueued[THREAD_POOL_PRIO_COUNT];    // 累计放入的任务数量
+}thread_pool_stats;
+
+// 绑定CPU的方式
+typedef enum
+{
+    THREAD_POOL_PIN_NONE,           // 不绑定，由系统调度（默认）
+    THREAD_POOL_PIN_ROUND_ROBIN,    // 第i个线程绑定到进程可用CPU中的第(i % 可用CPU数量)个
+    THREAD_POOL_PIN_CPUSET,         // 第i个线程绑定到cpusets[i % cpuset_count]
+}THREAD_POOL_PIN;
+
+// CPU集合，不依赖_GNU_SOURCE，创建线程时转换为cpu_set_t
+typedef struct
+{
+    unsigned long long bits[THREAD_POOL_CPU_MAX / 64];
+}thread_pool_cpuset;
+
+// 创建属性
+typedef struct
+{
+    unsigned int thread_count;  // 工作线程数量，不超过THREAD_COUNT_MAX；弹性线程池中为最少数量，可以为0
+    unsigned int thread_max;    // 大于thread_count时为弹性线程池，任务积压时增加线程直到该数量；0表示线程数量固定
+    unsigned int idle_timeout_ms;   // 弹性线程池中多余线程空闲多久后退出，0表示THREAD_POOL_IDLE_TIMEOUT
+    unsigned int queue_size;    // 共享任务队列初始容量，不超过THREAD_QUEUE_SIZE_MAX；工作窃取模式下只存放外部提交的任务；
+                                // 无锁模式下同时是环形队列的容量，向上取2的幂
+    unsigned int queue_max;     // 共享任务队列满时翻倍扩容的上限，0表示不扩容，THREAD_QUEUE_UNBOUNDED表示不设上限；无锁模式的环形队列不扩容
+    THREAD_POOL_MODE mode;      // 调度模式
+    THREAD_POOL_PIN pin;        // 绑定CPU的方式
+    const thread_pool_cpuset *cpusets;  // THREAD_POOL_PIN_CPUSET时每个线程的CPU集合，创建时复制
+    unsigned int cpuset_count;  // cpusets的数量，少于线程数量时循环使用
+    size_t stack_size;          // 线程栈大小，0表示系统默认
+    const char *name;           // 线程名前缀，超过THREAD_POOL_NAME_MAX时截断，NULL表示不设置
+    unsigned int prio_weight[THREAD_POOL_PRIO_COUNT];   // 各优先级每轮最多取出的任务数量，0表示THREAD_POOL_PRIO_WEIGHT中的默认值
+}thread_pool_attr;
 
 typedef struct thread_pool_ops
 {
     // 创建
     thread_pool_t* (*thread_pool_create)(unsigned int, unsigned int);
+    // 按属性创建
+    thread_pool_t* (*thread_pool_create_ex)(const thread_pool_attr*);
     // 添加任务
     STATUS (*thread_pool_add_task)(thread_pool_t*, task_func, void*);
+    // 添加任务，队列满时等待
+    STATUS (*thread_pool_submit)(thread_pool_t*, task_func, void*, THREAD_POOL_PRIO, int);
+    // 批量添加任务
+    STATUS (*thread_pool_submit_tasks)(thread_pool_t*, const thread_pool_task*, unsigned int, unsigned int*, THREAD_POOL_PRIO, int);
+    // 等待已提交的任务全部完成
+    STATUS (*thread_pool_drain)(thread_pool_t*);
+    // 获取当前工作线程数量
+    STATUS (*thread_pool_get_thread_count)(thread_pool_t*, unsigned int*);
+    // 获取各优先级队列的统计
+    STATUS (*thread_pool_get_stats)(thread_pool_t*, thread_pool_stats*);
     // 销毁
     STATUS (*thread_pool_destroy)(thread_pool_t*);
+
+    // 提交有返回值的任务，返回future
+    STATUS (*thread_pool_submit_future)(thread_pool_t*, task_result_func, void*, thread_pool_future**);
+    // 等待future完成
+    STATUS (*thread_pool_future_wait)(thread_pool_future*, int, void**);
+    // future是否已完成
+    bool (*thread_pool_future_done)(thread_pool_future*);
+    // 释放future
+    STATUS (*thread_pool_future_destroy)(thread_pool_future*);
+
+    // 创建任务组
+    thread_pool_group* (*thread_pool_group_create)(thread_pool_t*);
+    // 往任务组添加任务
+    STATUS (*thread_pool_group_add)(thread_pool_group*, task_func, void*);
+    // 等待任务组的任务全部完成
+    STATUS (*thread_pool_group_wait)(thread_pool_group*, int);
+    // 销毁任务组
+    STATUS (*thread_pool_group_destroy)(thread_pool_group*);
+
+    // 创建任务图
+    thread_pool_graph* (*thread_pool_graph_create)(void);
+    // 添加节点
+    thread_pool_graph_node* (*thread_pool_graph_add_node)(thread_pool_graph*, task_func, void*);
+    // 添加依赖
+    STATUS (*thread_pool_graph_add_edge)(thread_pool_graph*, thread_pool_graph_node*, thread_pool_graph_node*);
+    // 在线程池上运行任务图
+    STATUS (*thread_pool_graph_run)(thread_pool_graph*, thread_pool_t*);
+    // 等待任务图运行完成
+    STATUS (*thread_pool_graph_wait)(thread_pool_graph*, int);
+    // 销毁任务图
+    STATUS (*thread_pool_graph_destroy)(thread_pool_graph*);
+
+    // 并行执行循环
+    STATUS (*thread_pool_parallel_for)(thread_pool_t*, size_t, size_t, size_t, thread_pool_range_func, void*);
+    // 并行归约
+    STATUS (*thread_pool_parallel_reduce)(thread_pool_t*, size_t, size_t, size_t, void*, size_t,
+                                          thread_pool_reduce_func, thread_pool_join_func, void*);
 }thread_pool_ops;
 
 /*
@@ -43,6 +179,31 @@ extern thread_pool_ops thread_pool_operations;
     functions
 */
 
+// 清空CPU集合
+static inline void thread_pool_cpuset_zero(
+    OUT thread_pool_cpuset *set
+)
+{
+    unsigned int i = 0;
+
+    for(i = 0; i < THREAD_POOL_CPU_MAX / 64; ++ i)
+    {
+        set->bits[i] = 0;
+    }
+}
+
+// 往CPU集合添加CPU，超过THREAD_POOL_CPU_MAX时忽略
+static inline void thread_pool_cpuset_add(
+    IN thread_pool_cpuset *set,
+    IN unsigned int cpu
+)
+{
+    if(cpu < THREAD_POOL_CPU_MAX)
+    {
+        set->bits[cpu / 64] |= 1ull << (cpu % 64);
+    }
+}
+
 // 创建线程池
 static inline thread_pool_t* thread_pool_create(
     IN unsigned int thread_count,
@@ -52,7 +213,15 @@ static inline thread_pool_t* thread_pool_create(
     return thread_pool_operations.thread_pool_create(thread_count, queue_size);
 }
 
-// 往线程池添加任务
+// 按属性创建线程池
+static inline thread_pool_t* thread_pool_create_ex(
+    IN const thread_pool_attr *attr
+)
+{
+    return thread_pool_operations.thread_pool_create_ex(attr);
+}
+
+// 往线程池添加任务。工作窃取模式下，在该线程池的任务中调用时放入当前线程的本地队列，不会返回队列满
 static inline STATUS thread_pool_add_task(
     IN thread_pool_t *pool,
     IN task_func func,
@@ -62,7 +231,102 @@ static inline STATUS thread_pool_add_task(
     return thread_pool_operations.thread_pool_add_task(pool, func, args);
 }
 
-// 销毁线程池
+// 按优先级添加任务，队列满时直接返回错误。工作窃取模式下在任务中调用时，只有普通优先级放入本地队列，
+// 其他优先级放入对应的共享队列
+static inline STATUS thread_pool_add_task_prio(
+    IN thread_pool_t *pool,
+    IN task_func func,
+    IN void *args,
+    IN THREAD_POOL_PRIO prio
+)
+{
+    return thread_pool_operations.thread_pool_submit(pool, func, args, prio, 0);
+}
+
+// 按优先级添加任务，队列满时最多等待timeout_ms毫秒，THREAD_POOL_WAIT_FOREVER表示一直等待
+static inline STATUS thread_pool_submit_prio(
+    IN thread_pool_t *pool,
+    IN task_func func,
+    IN void *args,
+    IN THREAD_POOL_PRIO prio,
+    IN int timeout_ms
+)
+{
+    return thread_pool_operations.thread_pool_submit(pool, func, args, prio, timeout_ms);
+}
+
+// 添加任务，队列满时休眠等待工作线程取走任务，直到成功。不能在共享队列模式线程池自己的任务中调用，
+// 所有线程都在等待队列空位时会死锁
+static inline STATUS thread_pool_submit_blocking(
+    IN thread_pool_t *pool,
+    IN task_func func,
+    IN void *args
+)
+{
+    return thread_pool_operations.thread_pool_submit(pool, func, args, THREAD_POOL_PRIO_NORMAL, THREAD_POOL_WAIT_FOREVER);
+}
+
+// 添加任务，队列满时最多等待timeout_ms毫秒，超时返回ERR_THREAD_POOL_TASK_QUEUE_FULL
+static inline STATUS thread_pool_submit_timed(
+    IN thread_pool_t *pool,
+    IN task_func func,
+    IN void *args,
+    IN int timeout_ms
+)
+{
+    return thread_pool_operations.thread_pool_submit(pool, func, args, THREAD_POOL_PRIO_NORMAL, timeout_ms);
+}
+
+// 批量添加任务，整批只加锁一次，唤醒min(n, 空闲线程数)个线程。队列放不下时放入能放下的部分，
+// 返回ERR_THREAD_POOL_TASK_QUEUE_FULL，added返回已放入的数量（按数组顺序），可为NULL
+static inline STATUS thread_pool_add_tasks(
+    IN thread_pool_t *pool,
+    IN const thread_pool_task *tasks,
+    IN unsigned int n,
+    OUT unsigned int *added
+)
+{
+    return thread_pool_operations.thread_pool_submit_tasks(pool, tasks, n, added, THREAD_POOL_PRIO_NORMAL, 0);
+}
+
+// 批量添加任务，队列满时休眠等待，直到全部放入。限制与thread_pool_submit_blocking相同
+static inline STATUS thread_pool_submit_tasks_blocking(
+    IN thread_pool_t *pool,
+    IN const thread_pool_task *tasks,
+    IN unsigned int n
+)
+{
+    return thread_pool_operations.thread_pool_submit_tasks(pool, tasks, n, NULL, THREAD_POOL_PRIO_NORMAL, THREAD_POOL_WAIT_FOREVER);
+}
+
+// 等待已提交的任务（包括任务中继续提交的任务）全部执行完，线程池可以继续使用。
+// 不能在该线程池自己的任务中调用
+static inline STATUS thread_pool_drain(
+    IN thread_pool_t *pool
+)
+{
+    return thread_pool_operations.thread_pool_drain(pool);
+}
+
+// 获取当前存活的工作线程数量，弹性线程池中随负载变化
+static inline STATUS thread_pool_get_thread_count(
+    IN thread_pool_t *pool,
+    OUT unsigned int *count
+)
+{
+    return thread_pool_operations.thread_pool_get_thread_count(pool, count);
+}
+
+// 获取各优先级共享队列的当前深度、最大深度和累计放入数量
+static inline STATUS thread_pool_get_stats(
+    IN thread_pool_t *pool,
+    OUT thread_pool_stats *stats
+)
+{
+    return thread_pool_operations.thread_pool_get_stats(pool, stats);
+}
+
+// 销毁线程池，先执行完队列中的任务
 static inline STATUS thread_pool_destroy(
     IN thread_pool_t *pool
 )
@@ -70,6 +334,206 @@ static inline STATUS thread_pool_destroy(
     return thread_pool_operations.thread_pool_destroy(pool);
 }
 
+// 提交有返回值的任务，队列满时等待；在该线程池的任务中调用时不等待，队列满时在调用线程执行。
+// 成功时future返回句柄，使用后调用thread_pool_future_destroy释放
+static inline STATUS thread_pool_submit_future(
+    IN thread_pool_t *pool,
+    IN task_result_func func,
+    IN void *args,
+    OUT thread_pool_future **future
+)
+{
+    return thread_pool_operations.thread_pool_submit_future(pool, func, args, future);
+}
+
+// 等待任务完成，result返回任务函数的返回值，可为NULL
+static inline STATUS thread_pool_future_wait(
+    IN thread_pool_future *future,
+    OUT void **result
+)
+{
+    return thread_pool_operations.thread_pool_future_wait(future, THREAD_POOL_WAIT_FOREVER, result);
+}
+
+// 最多等待timeout_ms毫秒，超时返回ERR_THREAD_POOL_TIMEOUT，0表示只检查不等待
+static inline STATUS thread_pool_future_wait_timed(
+    IN thread_pool_future *future,
+    IN int timeout_ms,
+    OUT void **result
+)
+{
+    return thread_pool_operations.thread_pool_future_wait(future, timeout_ms, result);
+}
+
+// 任务是否已完成
+static inline bool thread_pool_future_done(
+    IN thread_pool_future *future
+)
+{
+    return thread_pool_operations.thread_pool_future_done(future);
+}
+
+// 释放future，任务还没完成时也可以释放，任务完成后自动回收
+static inline STATUS thread_pool_future_destroy(
+    IN thread_pool_future *future
+)
+{
+    return thread_pool_operations.thread_pool_future_destroy(future);
+}
+
+// 创建任务组，组内任务提交到pool执行
+static inline thread_pool_group* thread_pool_group_create(
+    IN thread_pool_t *pool
+)
+{
+    return thread_pool_operations.thread_pool_group_create(pool);
+}
+
+// 往任务组添加任务，队列满时等待；在该线程池的任务中调用时不等待，队列满时在调用线程执行
+static inline STATUS thread_pool_group_add(
+    IN thread_pool_group *group,
+    IN task_func func,
+    IN void *args
+)
+{
+    return thread_pool_operations.thread_pool_group_add(group, func, args);
+}
+
+// 等待组内已添加的任务全部完成，之后可以继续添加任务
+static inline STATUS thread_pool_group_wait(
+    IN thread_pool_group *group
+)
+{
+    return thread_pool_operations.thread_pool_group_wait(group, THREAD_POOL_WAIT_FOREVER);
+}
+
+// 最多等待timeout_ms毫秒，超时返回ERR_THREAD_POOL_TIMEOUT
+static inline STATUS thread_pool_group_wait_timed(
+    IN thread_pool_group *group,
+    IN int timeout_ms
+)
+{
+    return thread_pool_operations.thread_pool_group_wait(group, timeout_ms);
+}
+
+// 销毁任务组，先等待组内任务完成
+static inline STATUS thread_pool_group_destroy(
+    IN thread_pool_group *group
+)
+{
+    return thread_pool_operations.thread_pool_group_destroy(group);
+}
+
+// 创建空的任务图，可以多次运行
+static inline thread_pool_graph* thread_pool_graph_create(void)
+{
+    return thread_pool_operations.thread_pool_graph_create();
+}
+
+// 添加节点，运行时执行func(args)；失败返回NULL
+static inline thread_pool_graph_node* thread_pool_graph_add_node(
+    IN thread_pool_graph *graph,
+    IN task_func func,
+    IN void *args
+)
+{
+    return thread_pool_operations.thread_pool_graph_add_node(graph, func, args);
+}
+
+// 添加依赖，from执行完后才执行to。是否有环在运行时检查
+static inline STATUS thread_pool_graph_add_edge(
+    IN thread_pool_graph *graph,
+    IN thread_pool_graph_node *from,
+    IN thread_pool_graph_node *to
+)
+{
+    return thread_pool_operations.thread_pool_graph_add_edge(graph, from, to);
+}
+
+// 在pool上运行任务图，提交没有依赖的节点后返回。有环时返回ERR_THREAD_POOL_GRAPH_CYCLE，
+// 上次运行还没完成时返回ERR_THREAD_POOL_GRAPH_RUNNING
+static inline STATUS thread_pool_graph_run(
+    IN thread_pool_graph *graph,
+    IN thread_pool_t *pool
+)
+{
+    return thread_pool_operations.thread_pool_graph_run(graph, pool);
+}
+
+// 等待任务图运行完成，之后可以修改或再次运行
+static inline STATUS thread_pool_graph_wait(
+    IN thread_pool_graph *graph
+)
+{
+    return thread_pool_operations.thread_pool_graph_wait(graph, THREAD_POOL_WAIT_FOREVER);
+}
+
+// 最多等待timeout_ms毫秒，超时返回ERR_THREAD_POOL_TIMEOUT
+static inline STATUS thread_pool_graph_wait_timed(
+    IN thread_pool_graph *graph,
+    IN int timeout_ms
+)
+{
+    return thread_pool_operations.thread_pool_graph_wait(graph, timeout_ms);
+}
+
+// 运行任务图并等待完成
+static inline STATUS thread_pool_graph_run_wait(
+    IN thread_pool_graph *graph,
+    IN thread_pool_t *pool
+)
+{
+    STATUS ret = thread_pool_operations.thread_pool_graph_run(graph, pool);
+
+    if(OK != ret)
+    {
+        return ret;
+    }
+
+    return thread_pool_operations.thread_pool_graph_wait(graph, THREAD_POOL_WAIT_FOREVER);
+}
+
+// 销毁任务图和所有节点，先等待运行完成
+static inline STATUS thread_pool_graph_destroy(
+    IN thread_pool_graph *graph
+)
+{
+    return thread_pool_operations.thread_pool_graph_destroy(graph);
+}
+
+// 把下标[begin, end)分块并行执行body，调用线程也参与，全部完成后返回。grain为每块的最少元素数量，
+// 0表示自动选择；剩余越多每次领取的块越大，接近结束时按grain领取。线程池队列满时少提交辅助任务，
+// 不等待空位；调用线程只等待其他线程正在执行的块，可以在同一线程池的任务中调用
+static inline STATUS thread_pool_parallel_for(
+    IN thread_pool_t *pool,
+    IN size_t begin,
+    IN size_t end,
+    IN size_t grain,
+    IN thread_pool_range_func body,
+    IN void *ctx
+)
+{
+    return thread_pool_operations.thread_pool_parallel_for(pool, begin, end, grain, body, ctx);
+}
+
+// 并行归约：分块方式同thread_pool_parallel_for，每个参与的线程从result的副本开始，用body把领取的块
+// 累加到自己的部分结果，最后由调用线程用join合并到result。result输入时为单位元（如求和的0），
+// 大小为result_size；join必须满足结合律和交换律，部分结果的合并顺序不确定
+static inline STATUS thread_pool_parallel_reduce(
+    IN thread_pool_t *pool,
+    IN size_t begin,
+    IN size_t end,
+    IN size_t grain,
+    IN OUT void *result,
+    IN size_t result_size,
+    IN thread_pool_reduce_func body,
+    IN thread_pool_join_func join,
+    IN void *ctx
+)
+{
+    return thread_pool_operations.thread_pool_parallel_reduce(pool, begin, end, grain, result, result_size, body, join, ctx);
+}
+
 // 测试接口
 #if THREAD_POOL_TEST
 void thread_pool_test();